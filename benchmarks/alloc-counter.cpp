@@ -0,0 +1,2 @@
+// The counting operator new is shared with the tests
+#include "../tests/helpers/alloc-counter.cpp"
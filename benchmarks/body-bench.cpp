@@ -0,0 +1,80 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nhope/async/thread-executor.h"
+
+#include "royalbed/common/body.h"
+#include "royalbed/common/uri.h"
+#include "royalbed/server/param.h"
+#include "royalbed/server/request-context.h"
+#include "royalbed/server/router.h"
+
+namespace {
+
+using namespace std::literals;
+using namespace royalbed::server;
+using namespace royalbed::common;
+
+struct Point
+{
+    int x;
+    int y;
+    std::string label;
+};
+
+void from_json(const nlohmann::json& json, Point& p)
+{
+    json.at("x").get_to(p.x);
+    json.at("y").get_to(p.y);
+    json.at("label").get_to(p.label);
+}
+
+void benchParseJsonBody(benchmark::State& state)
+{
+    Headers headers;
+    headers.emplace("Content-Type", "application/json");
+    const auto json = R"({"x": 12, "y": -7, "label": "some point"})"s;
+    const std::vector<std::uint8_t> rawBody(json.begin(), json.end());
+
+    for ([[maybe_unused]] auto _ : state) {
+        auto body = parseBody<Point>(headers, rawBody);
+        benchmark::DoNotOptimize(body.get().x);
+    }
+}
+
+void benchExtractParams(benchmark::State& state)
+{
+    nhope::ThreadExecutor executor;
+    nhope::AOContext aoCtx(executor);
+    Router router;
+    router.get("/users/:id", [](RequestContext& /*ctx*/) {
+        return nhope::makeReadyFuture();
+    });
+
+    RequestContext ctx{
+      .num = 1,
+      .router = router,
+      .request = {.uri = Uri::parseRelative("/users/42?limit=10&sort=name")},
+      .aoCtx = nhope::AOContext(aoCtx),
+    };
+    ctx.rawPathParams = router.route("GET", ctx.request.uri.path).rawPathParams;
+
+    for ([[maybe_unused]] auto _ : state) {
+        const PathParam<int, "id"> id(ctx);
+        const QueryParam<int, "limit", Max<100>> limit(ctx);
+        const QueryParam<std::string, "sort"> sort(ctx);
+        benchmark::DoNotOptimize(id.get() + limit.get());
+        benchmark::DoNotOptimize(sort.get().data());
+    }
+}
+
+}   // namespace
+
+BENCHMARK(benchParseJsonBody)->Name("Body/parseJson");
+BENCHMARK(benchExtractParams)->Name("Param/extract");
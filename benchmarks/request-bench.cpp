@@ -0,0 +1,83 @@
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include <benchmark/benchmark.h>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/thread-executor.h"
+#include "nhope/io/pushback-reader.h"
+#include "nhope/io/string-reader.h"
+#include "nhope/io/string-writter.h"
+
+#include "royalbed/common/detail/write-headers.h"
+#include "royalbed/server/detail/receive-request.h"
+#include "royalbed/server/detail/send-response.h"
+#include "royalbed/server/http-status.h"
+
+namespace {
+
+using namespace std::literals;
+using namespace royalbed::server;
+
+const auto request = "GET /api/v1/users/42?sort=name&limit=10 HTTP/1.1\r\n"
+                     "Host: localhost:8080\r\n"
+                     "User-Agent: royalbed-bench\r\n"
+                     "Accept: application/json\r\n"
+                     "Accept-Encoding: gzip, deflate\r\n"
+                     "Connection: keep-alive\r\n"
+                     "\r\n"s;
+
+royalbed::common::Headers responseHeaders()
+{
+    royalbed::common::Headers headers;
+    headers.emplace("Content-Type", "application/json");
+    headers.emplace("Content-Length", "0");
+    headers.emplace("Server", "royalbed");
+    headers.emplace("Cache-Control", "no-cache");
+    return headers;
+}
+
+// The futures are completed in the executor thread, the time includes the handoff
+void benchReceiveRequest(benchmark::State& state)
+{
+    nhope::ThreadExecutor executor;
+    nhope::AOContext aoCtx(executor);
+
+    for ([[maybe_unused]] auto _ : state) {
+        auto in = nhope::PushbackReader::create(aoCtx, nhope::StringReader::create(aoCtx, request));
+        auto req = detail::receiveRequest(aoCtx, *in).get();
+        benchmark::DoNotOptimize(req.uri.path);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(request.size()));
+}
+
+void benchWriteHeaders(benchmark::State& state)
+{
+    const auto headers = responseHeaders();
+    std::string out;
+    for ([[maybe_unused]] auto _ : state) {
+        out.clear();
+        royalbed::common::detail::writeHeaders(headers, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+
+void benchSendResponse(benchmark::State& state)
+{
+    nhope::ThreadExecutor executor;
+    nhope::AOContext aoCtx(executor);
+    const auto headers = responseHeaders();
+
+    for ([[maybe_unused]] auto _ : state) {
+        auto out = nhope::StringWritter::create(aoCtx);
+        Response response{.status = HttpStatus::Ok, .headers = headers};
+        benchmark::DoNotOptimize(detail::sendResponse(aoCtx, std::move(response), *out).get());
+    }
+}
+
+}   // namespace
+
+BENCHMARK(benchReceiveRequest)->Name("Request/receive");
+BENCHMARK(benchWriteHeaders)->Name("Response/writeHeaders");
+BENCHMARK(benchSendResponse)->Name("Response/sendHead");
@@ -0,0 +1,53 @@
+#include <cstdint>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "fmt/core.h"
+#include "nhope/async/future.h"
+
+#include "royalbed/server/request-context.h"
+#include "royalbed/server/router.h"
+
+namespace {
+
+using namespace royalbed::server;
+
+Router makeRouter(std::int64_t routeCount)
+{
+    Router router;
+    for (std::int64_t i = 0; i < routeCount; ++i) {
+        router.get(fmt::format("/api/v1/resource{}/:id", i), [](RequestContext& /*ctx*/) {
+            return nhope::makeReadyFuture();
+        });
+    }
+    return router;
+}
+
+void benchRoute(benchmark::State& state)
+{
+    const auto routeCount = state.range(0);
+    const auto router = makeRouter(routeCount);
+    const auto path = fmt::format("/api/v1/resource{}/42", routeCount / 2);
+
+    for ([[maybe_unused]] auto _ : state) {
+        auto result = router.route("GET", path);
+        benchmark::DoNotOptimize(result.handler);
+    }
+}
+
+void benchRouteNotFound(benchmark::State& state)
+{
+    const auto router = makeRouter(state.range(0));
+    const std::string path = "/api/v2/missing/42";
+
+    for ([[maybe_unused]] auto _ : state) {
+        auto result = router.route("GET", path);
+        benchmark::DoNotOptimize(result.handler);
+    }
+}
+
+}   // namespace
+
+BENCHMARK(benchRoute)->Name("Router/route")->Arg(10)->Arg(1000)->Arg(10000);
+BENCHMARK(benchRouteNotFound)->Name("Router/routeNotFound")->Arg(10)->Arg(1000)->Arg(10000);
@@ -0,0 +1,75 @@
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <benchmark/benchmark.h>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nhope/async/thread-executor.h"
+#include "nhope/io/io-device.h"
+#include "nhope/io/pushback-reader.h"
+#include "spdlog/sinks/null_sink.h"
+#include "spdlog/spdlog.h"
+
+#include "royalbed/client/detail/send-request.h"
+#include "royalbed/server/http-status.h"
+#include "royalbed/server/listener.h"
+#include "royalbed/server/request-context.h"
+#include "royalbed/server/router.h"
+#include "royalbed/server/server.h"
+
+namespace {
+
+using namespace royalbed;
+using namespace royalbed::server;
+
+// Keep-alive GETs through the whole server and client stacks over the memory transport:
+// the time is the library overhead without the kernel
+void benchMemoryGet(benchmark::State& state)
+{
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    auto router = Router();
+    router.get("/ping", [](RequestContext& ctx) {
+        ctx.response.status = HttpStatus::Ok;
+        return nhope::makeReadyFuture();
+    });
+
+    auto listener = MemoryListener::create(serverCtx);
+    auto srv = Server::start(serverCtx, {
+                                          .router = std::move(router),
+                                          .log = std::make_shared<spdlog::logger>(
+                                            "server-bench", std::make_shared<spdlog::sinks::null_sink_mt>()),
+                                          .listener = listener,
+                                        });
+
+    auto sock = listener->connect(clientCtx);
+    auto reader = nhope::PushbackReader::create(clientCtx, *sock);
+    for ([[maybe_unused]] auto _ : state) {
+        auto resp = client::detail::makeRequest(clientCtx,
+                                                {
+                                                  .method = "GET",
+                                                  .uri = {.path = "/ping"},
+                                                  .headers = {{"Host", "memory"}},
+                                                },
+                                                *sock, *reader)
+                      .get();
+        if (resp.body != nullptr) {
+            nhope::readAll(*resp.body).get();
+        }
+        // the server closes the connection after KeepAliveParams::requestsCount requests
+        if (const auto it = resp.headers.find("Connection"); it != resp.headers.end() && it->second == "close") {
+            reader.reset();
+            sock = listener->connect(clientCtx);
+            reader = nhope::PushbackReader::create(clientCtx, *sock);
+        }
+    }
+}
+
+}   // namespace
+
+BENCHMARK(benchMemoryGet)->Name("Server/memoryGet");
@@ -0,0 +1,128 @@
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nhope/async/thread-executor.h"
+#include "nhope/io/pushback-reader.h"
+#include "nhope/io/string-reader.h"
+#include "nhope/io/string-writter.h"
+#include "spdlog/sinks/null_sink.h"
+#include "spdlog/spdlog.h"
+
+#include "royalbed/server/detail/session.h"
+#include "royalbed/server/http-status.h"
+#include "royalbed/server/request-context.h"
+#include "royalbed/server/router.h"
+
+#include "../tests/helpers/alloc-counter.h"
+
+namespace {
+
+using namespace std::literals;
+using namespace royalbed::server;
+using namespace royalbed::server::detail;
+
+class BenchSessionCtx final : public SessionCtx
+{
+public:
+    explicit BenchSessionCtx(Router&& router)
+      : m_router(std::move(router))
+    {}
+
+    [[nodiscard]] const Router& router() const noexcept override
+    {
+        return m_router;
+    }
+
+    void sessionReceivedRequest(std::uint32_t /*sessionNum*/) noexcept override
+    {}
+
+    void sessionFinished(std::uint32_t /*sessionNum*/, bool /*keepAlive*/) noexcept override
+    {
+        m_finished = true;
+        m_finished.notify_one();
+    }
+
+    bool sessionNeedClose() noexcept override
+    {
+        return false;
+    }
+
+    gsl::span<std::uint8_t> drainBuffer() override
+    {
+        return m_drainBuf;
+    }
+
+    void wait()
+    {
+        m_finished.wait(false);
+        m_finished = false;
+    }
+
+private:
+    Router m_router;
+    std::array<std::uint8_t, 4096> m_drainBuf{};
+    std::atomic<bool> m_finished{false};
+};
+
+Router trivialRouter()
+{
+    Router router;
+    router.addMiddleware([](RequestContext& /*ctx*/) {
+        return true;
+    });
+    router.get("/ping", [](RequestContext& ctx) {
+        ctx.response.status = HttpStatus::Ok;
+        return nhope::makeReadyFuture();
+    });
+    return router;
+}
+
+// One keep-alive GET through the whole session: receive, route, middleware, handler, send
+void benchTrivialGet(benchmark::State& state)
+{
+    const auto request = "GET /ping HTTP/1.1\r\nHost: localhost\r\n\r\n"s;
+    auto log = spdlog::null_logger_mt("session-bench");
+
+    nhope::ThreadExecutor executor;
+    nhope::AOContext aoCtx(executor);
+    BenchSessionCtx sessionCtx(trivialRouter());
+    const auto framePool = std::make_shared<royalbed::common::FramePool>();
+
+    std::uint64_t allocations = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto in = nhope::PushbackReader::create(aoCtx, nhope::StringReader::create(aoCtx, request));
+        auto out = nhope::StringWritter::create(aoCtx);
+        state.ResumeTiming();
+
+        const auto before = allocationCount();
+        startSession(aoCtx, SessionParams{
+                              .ctx = sessionCtx,
+                              .in = *in,
+                              .out = *out,
+                              .log = log,
+                              .framePool = framePool,
+                            });
+        sessionCtx.wait();
+        allocations += allocationCount() - before;
+
+        state.PauseTiming();
+        in.reset();
+        out.reset();
+        state.ResumeTiming();
+    }
+
+    state.counters["allocs"] = benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+    spdlog::drop("session-bench");
+}
+
+}   // namespace
+
+BENCHMARK(benchTrivialGet)->Name("Session/trivialGet");
@@ -0,0 +1,215 @@
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "royalbed/common/uri.h"
+
+namespace {
+
+using namespace std::literals;
+using namespace royalbed::common;
+
+// The byte-by-byte implementation the table-driven one is compared against
+namespace legacy {
+
+bool isAllowedSymbol(char ch, UriEscapeMode mode)
+{
+    if (ch >= '0' && ch <= '9') {
+        return true;
+    }
+    if (ch >= 'A' && ch <= 'Z') {
+        return true;
+    }
+    if (ch >= 'a' && ch <= 'z') {
+        return true;
+    }
+    if (ch == '-' || ch == '_' || ch == '.' || ch == '~') {
+        return true;
+    }
+    if (ch == '/' && mode == UriEscapeMode::Path) {
+        return true;
+    }
+    return false;
+}
+
+int hexDigit(char ch)
+{
+    if (ch >= '0' && ch <= '9') {
+        return ch - '0';
+    }
+    if (ch >= 'a' && ch <= 'f') {
+        return ch - 'a' + 10;
+    }
+    if (ch >= 'A' && ch <= 'F') {
+        return ch - 'A' + 10;
+    }
+    throw UriParseError("Invalid escape sequence");
+}
+
+void uriEscape(std::string& out, std::string_view in, UriEscapeMode mode)
+{
+    out.reserve(out.size() + in.size() + 3 * in.size() / 4);
+    for (const char ch : in) {
+        if (isAllowedSymbol(ch, mode)) {
+            out += ch;
+        } else if (ch == ' ' && mode == UriEscapeMode::Query) {
+            out.push_back('+');
+        } else {
+            constexpr auto hex = "0123456789abcdef"sv;
+            const auto b = static_cast<std::uint8_t>(ch);
+            const auto esc = std::array{'%', hex[b >> 4], hex[b & 0x0f]};
+            out.append(esc.data(), esc.size());
+        }
+    }
+}
+
+void uriUnescape(std::string& out, std::string_view in, UriEscapeMode mode)
+{
+    out.reserve(out.size() + in.size());
+    for (auto it = in.begin(); it != in.end(); ++it) {
+        if (*it == '%') {
+            if (std::distance(it, in.end()) < 3) {
+                throw UriParseError("Incomplete hex escape sequence");
+            }
+            const auto hi = hexDigit(*++it);
+            const auto lo = hexDigit(*++it);
+            out += static_cast<char>((hi << 4) | lo);
+            continue;
+        }
+        if (*it == '+' && mode == UriEscapeMode::Query) {
+            out += ' ';
+            continue;
+        }
+        if (isAllowedSymbol(*it, mode)) {
+            out += *it;
+            continue;
+        }
+        throw UriParseError("Invalid symbol");
+    }
+}
+
+}   // namespace legacy
+
+struct Sample
+{
+    std::string_view str;
+    UriEscapeMode mode;
+};
+
+// Decoded paths and query values as they come from the clients
+const std::vector<Sample>& decodedSamples()
+{
+    static const std::vector<Sample> samples{
+      {"/api/v1/users/1234567/profile"sv, UriEscapeMode::Path},
+      {"/static/js/vendors~main.3f2a9c1d.chunk.js"sv, UriEscapeMode::Path},
+      {"/files/Отчёт за квартал/итоги 2024.pdf"sv, UriEscapeMode::Path},
+      {"2024-05-17T10:15:30.123+03:00"sv, UriEscapeMode::Query},
+      {"select name, value from settings where id = 42"sv, UriEscapeMode::Query},
+      {"eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9.eyJzdWIiOiIxMjM0NTY3ODkwIn0"sv, UriEscapeMode::Query},
+    };
+    return samples;
+}
+
+std::vector<std::pair<std::string, UriEscapeMode>> encodedSamples()
+{
+    std::vector<std::pair<std::string, UriEscapeMode>> samples;
+    for (const auto& [str, mode] : decodedSamples()) {
+        samples.emplace_back(uriEscape(str, mode), mode);
+    }
+    return samples;
+}
+
+template<auto escape>
+void benchEscape(benchmark::State& state)
+{
+    const auto& samples = decodedSamples();
+    std::string out;
+    std::size_t bytes = 0;
+    for ([[maybe_unused]] auto _ : state) {
+        for (const auto& [str, mode] : samples) {
+            out.clear();
+            escape(out, str, mode);
+            benchmark::DoNotOptimize(out.data());
+            bytes += str.size();
+        }
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+}
+
+template<auto unescape>
+void benchUnescape(benchmark::State& state)
+{
+    const auto samples = encodedSamples();
+    std::string out;
+    std::size_t bytes = 0;
+    for ([[maybe_unused]] auto _ : state) {
+        for (const auto& [str, mode] : samples) {
+            out.clear();
+            unescape(out, str, mode);
+            benchmark::DoNotOptimize(out.data());
+            bytes += str.size();
+        }
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+}
+
+void legacyEscape(std::string& out, std::string_view in, UriEscapeMode mode)
+{
+    legacy::uriEscape(out, in, mode);
+}
+
+void currentEscape(std::string& out, std::string_view in, UriEscapeMode mode)
+{
+    uriEscape(out, in, mode);
+}
+
+void legacyUnescape(std::string& out, std::string_view in, UriEscapeMode mode)
+{
+    legacy::uriUnescape(out, in, mode);
+}
+
+void currentUnescape(std::string& out, std::string_view in, UriEscapeMode mode)
+{
+    uriUnescape(out, in, mode);
+}
+
+void benchParseRelative(benchmark::State& state)
+{
+    const std::array uris{
+      "/"sv,
+      "/api/v1/users/42"sv,
+      "/api/v1/search?q=royal%20bed&page=2&size=50&sort=name#top"sv,
+      "/static/css/main.3f2a9c.css?v=17"sv,
+    };
+    std::size_t bytes = 0;
+    for ([[maybe_unused]] auto _ : state) {
+        for (const auto uri : uris) {
+            auto parsed = Uri::parseRelative(uri);
+            benchmark::DoNotOptimize(parsed.path.data());
+            bytes += uri.size();
+        }
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+}
+
+void benchQueryFind(benchmark::State& state)
+{
+    const auto uri = Uri::parseRelative("/search?q=royal%20bed&page=2&size=50&sort=name&lang=en");
+    for ([[maybe_unused]] auto _ : state) {
+        auto query = uri.query;
+        benchmark::DoNotOptimize(query.find("sort"));
+    }
+}
+
+BENCHMARK(benchParseRelative)->Name("Uri/parseRelative");
+BENCHMARK(benchQueryFind)->Name("Uri/queryFind");
+BENCHMARK(benchEscape<legacyEscape>)->Name("UriEscape/legacy");
+BENCHMARK(benchEscape<currentEscape>)->Name("UriEscape/current");
+BENCHMARK(benchUnescape<legacyUnescape>)->Name("UriUnescape/legacy");
+BENCHMARK(benchUnescape<currentUnescape>)->Name("UriUnescape/current");
+
+}   // namespace
@@ -0,0 +1,50 @@
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "royalbed/server/detail/web-socket-frame.h"
+#include "royalbed/server/web-socket.h"
+
+namespace {
+
+using namespace royalbed::server;
+using royalbed::server::detail::WebSocketFrameParser;
+
+constexpr std::uint32_t maskingKey = 0x37fa213d;
+
+std::vector<std::uint8_t> makePayload(std::int64_t size)
+{
+    std::vector<std::uint8_t> payload(static_cast<std::size_t>(size));
+    for (std::size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = static_cast<std::uint8_t>('a' + i % 26);
+    }
+    return payload;
+}
+
+void benchCreateFrame(benchmark::State& state)
+{
+    const auto payload = makePayload(state.range(0));
+    for ([[maybe_unused]] auto _ : state) {
+        auto frame = WebSocketFrameParser::createFrame(true, WebSocketFrame::TEXT, false, 0, payload);
+        benchmark::DoNotOptimize(frame.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) * state.range(0));
+}
+
+void benchParse(benchmark::State& state)
+{
+    // client frames are masked
+    const auto frame =
+      WebSocketFrameParser::createFrame(true, WebSocketFrame::BINARY, true, maskingKey, makePayload(state.range(0)));
+    for ([[maybe_unused]] auto _ : state) {
+        auto parsed = WebSocketFrameParser::parse(frame);
+        benchmark::DoNotOptimize(parsed.payload.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) * state.range(0));
+}
+
+}   // namespace
+
+BENCHMARK(benchCreateFrame)->Name("WebSocketFrame/create")->Arg(16)->Arg(1024)->Arg(64 * 1024);
+BENCHMARK(benchParse)->Name("WebSocketFrame/parse")->Arg(16)->Arg(1024)->Arg(64 * 1024);
@@ -0,0 +1,187 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "fmt/core.h"
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/thread-executor.h"
+
+#include "royalbed/server/listener.h"
+#include "royalbed/server/router.h"
+#include "royalbed/server/server.h"
+
+#include "spdlog/sinks/null_sink.h"
+#include "spdlog/spdlog.h"
+
+#include "endpoints/all.h"
+#include "load/load-runner.h"
+#include "load/replay.h"
+
+/**
+ * Loopback load test of the vru-srv endpoints.
+ *
+ *     vru-load [--threads M] [--connections K] [--duration SECONDS] [--rate RPS] [--port PORT]
+ *              [--in-process] [--replay LOG] [--speed X]
+ *
+ * Starts the server in-process on 127.0.0.1 and runs the request mix twice: in the closed loop
+ * to find the throughput, then in the open loop at --rate (70% of the closed loop throughput by default).
+ * With --replay the captured traffic (vru-srv --capture) is replayed at --speed instead of the mix.
+ * With --in-process the connections go over the memory transport instead of the loopback.
+ */
+
+namespace {
+
+using namespace std::literals;
+using namespace royalbed;
+
+constexpr std::uint16_t defaultPort = 8081;
+constexpr double defaultRateShare = 0.7;
+
+struct Options
+{
+    std::size_t threads{2};
+    std::size_t connections{16};
+    std::chrono::seconds duration{10s};
+    double rate{};
+    std::uint16_t port{defaultPort};
+    bool inProcess{false};
+    std::string replay;
+    double speed{1};
+};
+
+Options parseOptions(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view name = argv[i];
+        if (name == "--in-process") {
+            options.inProcess = true;
+            continue;
+        }
+        if (i + 1 == argc) {
+            throw std::invalid_argument(fmt::format("no value for {}", name));
+        }
+        const std::string value = argv[++i];
+        if (name == "--threads") {
+            options.threads = std::stoul(value);
+        } else if (name == "--connections") {
+            options.connections = std::stoul(value);
+        } else if (name == "--duration") {
+            options.duration = std::chrono::seconds(std::stoul(value));
+        } else if (name == "--rate") {
+            options.rate = std::stod(value);
+        } else if (name == "--port") {
+            options.port = static_cast<std::uint16_t>(std::stoul(value));
+        } else if (name == "--replay") {
+            options.replay = value;
+        } else if (name == "--speed") {
+            options.speed = std::stod(value);
+        } else {
+            throw std::invalid_argument(fmt::format("unknown option {}", name));
+        }
+    }
+    return options;
+}
+
+// Mostly reads with some writes, spread over all the VRUs of the storage
+std::vector<load::RequestTemplate> requestMix()
+{
+    constexpr int vruCount = 10;
+
+    std::vector<load::RequestTemplate> requests;
+    for (int i = 0; i < vruCount; ++i) {
+        const auto vru = fmt::format("/api/vru/vru_{}", i);
+        requests.push_back({.method = "GET", .target = vru});
+        requests.push_back({.method = "GET", .target = vru + "/status"});
+        requests.push_back({.method = "GET", .target = vru + "/status"});
+        requests.push_back({.method = "GET", .target = vru + "/sample-rate"});
+        requests.push_back({
+          .method = "PUT",
+          .target = vru + "/sample-rate",
+          .headers = {{"Content-Type", "application/json"}},
+          .body = R"({"sampleRate": 16000})",
+        });
+        if (i % 2 == 0) {
+            requests.push_back({.method = "GET", .target = "/api/vru"});
+        }
+    }
+    return requests;
+}
+
+}   // namespace
+
+int main(int argc, char** argv)
+{
+    try {
+        const auto options = parseOptions(argc, argv);
+
+        nhope::ThreadExecutor executor;
+        nhope::AOContext aoCtx(executor);
+
+        auto router = server::Router();
+        vru_srv::endpoints::publicEndpoints(router);
+
+        server::MemoryListenerPtr listener;
+        if (options.inProcess) {
+            listener = server::MemoryListener::create(aoCtx);
+        }
+        auto srv = server::Server::start(
+          aoCtx, {
+                   .bindAddress = "127.0.0.1",
+                   .port = options.port,
+                   .router = std::move(router),
+                   .log = std::make_shared<spdlog::logger>("httpsrv", std::make_shared<spdlog::sinks::null_sink_mt>()),
+                   .listener = listener,
+                 });
+
+        if (!options.replay.empty()) {
+            const auto requests = load::readTrafficLog(options.replay);
+            fmt::print("replay: {} requests at x{}\n", requests.size(), options.speed);
+            load::printReport(load::replayTraffic(
+              {
+                .host = "127.0.0.1",
+                .port = options.port,
+                .listener = listener,
+                .threadCount = options.threads,
+                .connectionCount = options.connections,
+                .speed = options.speed,
+              },
+              requests));
+            return EXIT_SUCCESS;
+        }
+
+        load::LoadParams params{
+          .host = "127.0.0.1",
+          .port = options.port,
+          .listener = listener,
+          .threadCount = options.threads,
+          .connectionCount = options.connections,
+          .duration = options.duration,
+          .requests = requestMix(),
+        };
+
+        fmt::print("closed loop: {} threads, {} connections, {} s\n", options.threads, options.connections,
+                   options.duration.count());
+        const auto closed = load::runLoad(params);
+        load::printReport(closed);
+
+        params.rate = options.rate > 0 ? options.rate : closed.throughput() * defaultRateShare;
+        if (params.rate <= 0) {
+            throw std::runtime_error("the server has not answered any request");
+        }
+        fmt::print("\nopen loop: {:.1f} req/s\n", params.rate);
+        load::printReport(load::runLoad(params));
+
+        return EXIT_SUCCESS;
+    } catch (const std::exception& e) {
+        spdlog::error("{0}", e.what());
+        return EXIT_FAILURE;
+    }
+}
@@ -1,4 +1,6 @@
 #include <cstdlib>
+#include <memory>
+#include <string_view>
 
 #include "asio/io_context.hpp"
 
@@ -12,6 +14,7 @@
 #include "royalbed/server/server.h"
 #include "royalbed/server/router.h"
 #include "royalbed/server/swagger.h"
+#include "royalbed/server/traffic-capture.h"
 
 #include "spdlog/sinks/null_sink.h"
 #include "spdlog/spdlog.h"
@@ -27,7 +30,8 @@ constexpr auto portSrv = 8080;
 
 CMRC_DECLARE(vru_srv);
 
-int main()
+// vru-srv [--capture FILE] - records the incoming requests for royalbed-replay
+int main(int argc, char** argv)
 {
     try {
         auto ioCtx = asio::io_context();
@@ -35,6 +39,11 @@ int main()
         auto aoCtx = nhope::AOContext(executor);
 
         auto router = Router();
+        if (argc == 3 && std::string_view(argv[1]) == "--capture") {
+            router.addMiddleware(captureTraffic({
+              .log = std::make_shared<royalbed::common::TrafficLogWriter>(argv[2]),
+            }));
+        }
         vru_srv::endpoints::publicEndpoints(router);
 
         auto openApiFS = cmrc::vru_srv::get_filesystem();
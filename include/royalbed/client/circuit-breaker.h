@@ -0,0 +1,120 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace royalbed::client {
+
+// The call is rejected without being sent, the circuit breaker is open
+class CircuitOpenError final : public std::runtime_error
+{
+public:
+    CircuitOpenError();
+};
+
+enum class CircuitState
+{
+    Closed,
+    Open,
+    HalfOpen,
+};
+
+struct CircuitBreakerParams
+{
+    // Доли ошибок и медленных вызовов считаются по последним windowSize вызовам,
+    // но не раньше, чем их наберётся minimumCalls
+    std::size_t windowSize{20};
+    std::size_t minimumCalls{10};
+
+    // Цепь размыкается, если доля ошибок или медленных вызовов достигла порога
+    double failureRateThreshold{0.5};
+    double slowCallRateThreshold{1.0};
+
+    // Вызов, длившийся не меньше заданного времени, считается медленным
+    std::chrono::nanoseconds slowCallDuration{std::chrono::seconds(5)};
+
+    // Сколько цепь остаётся разомкнутой, прежде чем пропустить пробные вызовы
+    std::chrono::nanoseconds openDuration{std::chrono::seconds(30)};
+
+    // Число пробных вызовов в полуразомкнутом состоянии. Цепь замыкается, если все они успешны и быстры,
+    // и снова размыкается при первой ошибке или медленном вызове
+    std::size_t halfOpenCalls{3};
+};
+
+struct CircuitBreakerMetrics
+{
+    CircuitState state{CircuitState::Closed};
+
+    // In the window
+    std::size_t calls{};
+    std::size_t failedCalls{};
+    std::size_t slowCalls{};
+
+    // Since the creation
+    std::uint64_t rejectedCalls{};
+    std::uint64_t openCount{};
+};
+
+/**
+ * Stops the calls to a dependency that fails or is too slow, so they fail at once instead of waiting
+ * for the connection and the timeout.
+ *
+ * Closed: the calls pass, their results are counted in a sliding window. Open: the calls are rejected
+ * with CircuitOpenError for CircuitBreakerParams::openDuration. Half-open: a few trial calls decide
+ * whether the circuit is closed or opened again.
+ *
+ * Not thread-safe.
+ */
+class CircuitBreaker final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Permit
+    {
+        std::uint64_t generation;
+        Clock::time_point started;
+    };
+
+    explicit CircuitBreaker(CircuitBreakerParams params = {});
+
+    // Throws CircuitOpenError if the call is not permitted now
+    [[nodiscard]] Permit acquire();
+
+    // The result of the permitted call, the results of the calls started in the previous state are ignored
+    void release(const Permit& permit, bool failed);
+
+    [[nodiscard]] CircuitBreakerMetrics metrics() const;
+
+private:
+    struct Outcome
+    {
+        bool failed;
+        bool slow;
+    };
+
+    void record(Outcome outcome);
+    void transition(CircuitState state);
+
+    CircuitBreakerParams m_params;
+    CircuitState m_state{CircuitState::Closed};
+    std::uint64_t m_generation{};
+
+    // Ring buffer of the closed state outcomes
+    std::vector<Outcome> m_window;
+    std::size_t m_next{};
+    std::size_t m_failed{};
+    std::size_t m_slow{};
+
+    Clock::time_point m_openedAt{};
+    std::size_t m_trialsStarted{};
+    std::size_t m_trialsSucceeded{};
+
+    std::uint64_t m_rejected{};
+    std::uint64_t m_openCount{};
+};
+
+}   // namespace royalbed::client
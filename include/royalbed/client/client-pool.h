@@ -0,0 +1,104 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nhope/io/tcp.h"
+
+#include "royalbed/client/request.h"
+#include "royalbed/client/response.h"
+
+namespace royalbed::client {
+
+using Connector =
+  std::function<nhope::Future<nhope::TcpSocketPtr>(nhope::AOContext& aoCtx, const std::string& host, std::uint16_t port)>;
+
+struct ClientPoolParams
+{
+    // Максимальное число соединений с одним host:port (занятых и свободных).
+    // Запросы сверх него ждут, пока освободится одно из соединений
+    std::size_t maxConnectionsPerHost{8};
+
+    // Свободное соединение закрывается, если его не использовали дольше заданного времени
+    std::chrono::nanoseconds idleTimeout{std::chrono::seconds(30)};
+
+    // Сколько запросов можно отправить по одному соединению, не дожидаясь ответов (HTTP pipelining).
+    // Конвейеризуются только идемпотентные запросы без тела, остальные занимают соединение целиком
+    std::size_t pipelineDepth{1};
+
+    // Ограничение времени установки соединения, 0 - без ограничения.
+    // Запросы, ожидавшие соединения, завершаются ошибкой std::errc::timed_out
+    std::chrono::nanoseconds connectTimeout{};
+
+    // Ограничение времени от вызова до получения заголовков ответа, включая ожидание соединения,
+    // а для sendRequest - до получения всего тела ответа. 0 - без ограничения. По истечении запрос
+    // завершается ошибкой std::errc::timed_out, а соединение, по которому ожидается ответ, закрывается
+    std::chrono::nanoseconds requestTimeout{};
+
+    // Перцентиль времени ответа хоста (например, 95), по истечении которого копия идемпотентного
+    // запроса без тела отправляется по другому соединению. Используется первый из ответов. 0 - без копий
+    double hedgePercentile{0};
+
+    // Бюджет повторов (token bucket): каждый запрос добавляет хосту retryBudgetRatio токена,
+    // но не больше retryBudgetBurst. Повтор запроса и отправка копии тратят по токену, без токенов
+    // запрос не повторяется. Так повторы не умножают нагрузку на и без того перегруженный хост
+    double retryBudgetRatio{0.1};
+    double retryBudgetBurst{10};
+
+    // Установка соединения, по умолчанию nhope::TcpSocket::connect
+    Connector connect;
+};
+
+class ClientPool;
+using ClientPoolPtr = std::shared_ptr<ClientPool>;
+
+/**
+ * Keeps keep-alive connections to every host:port and sends the requests over them.
+ *
+ * A connection goes back to the pool after the response body is read to the end, unless the server asked
+ * to close it. A body dropped before the end closes the connection.
+ * The last released connection is reused first, so the rest of them expire under a light load.
+ *
+ * With pipelining an idempotent request without a body goes to an idle connection or, if there is none,
+ * to the least loaded one with a place in the pipeline. The requests queued on a connection are written
+ * at once and the responses are matched to them in order.
+ *
+ * A request without a body and with an idempotent method is sent once more over another connection
+ * if its connection fails or is closed before the response, e.g. an idle connection closed by the server.
+ * Such a request is also hedged: once it has waited for the response longer than the given percentile
+ * of the host latencies, a copy goes to another connection. Both are limited by the retry budget.
+ *
+ * The methods are called in the thread of the AOContext the pool is created in.
+ */
+class ClientPool
+{
+public:
+    virtual ~ClientPool() = default;
+
+    /**
+     * @brief Отправит запрос по свободному или новому соединению с request.uri.host:port
+     *
+     * Same as client::sendRequest(): the response body is read completely
+     */
+    virtual nhope::Future<Response> sendRequest(Request&& request) = 0;
+
+    /**
+     * @brief Отправит запрос и вернёт ответ, как только будут получены заголовки
+     *
+     * response.body reads the body from the connection as it arrives. The requests pipelined after this one
+     * wait until the body is read, so it should be read or dropped without a delay.
+     */
+    virtual nhope::Future<Response> openRequest(Request&& request) = 0;
+
+    [[nodiscard]] virtual std::size_t idleConnectionCount() const = 0;
+
+    static ClientPoolPtr create(nhope::AOContext& aoCtx, ClientPoolParams params = {});
+};
+
+}   // namespace royalbed::client
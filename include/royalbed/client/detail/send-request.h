@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <string>
 
 #include "nhope/async/ao-context.h"
 #include "nhope/async/future.h"
@@ -12,9 +13,18 @@
 
 namespace royalbed::client::detail {
 
+// Throws if request.uri has no host, sets the default port and the Host header
+void setRequestHost(Request& request);
+
+// Appends the start line and the headers
+void writeRequestHead(const Request& request, std::string& out);
+
 nhope::Future<std::size_t> sendRequest(nhope::AOContext& aoCtx, Request&& request, nhope::Writter& device);
 
 nhope::Future<common::Response> makeRequest(nhope::AOContext& aoCtx, Request&& request, nhope::Writter& device,
                                             nhope::PushbackReader& reader);
 
+// Reads the whole body, the response gets a reader over the received data
+nhope::Future<common::Response> readResponseBody(nhope::AOContext& aoCtx, common::Response&& response);
+
 }   // namespace royalbed::client::detail
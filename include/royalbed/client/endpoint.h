@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+
+#include "royalbed/client/circuit-breaker.h"
+#include "royalbed/client/client-pool.h"
+#include "royalbed/client/request.h"
+#include "royalbed/client/response.h"
+#include "royalbed/client/uri.h"
+
+namespace royalbed::client {
+
+struct EndpointParams
+{
+    // Реплики сервиса, используются host и port (по умолчанию 80)
+    std::vector<Uri> targets;
+
+    // Пул соединений со всеми репликами
+    ClientPoolParams pool;
+
+    // Вес нового времени ответа в скользящем среднем (EWMA) реплики
+    double latencyWeight{0.3};
+
+    // Реплика исключается из балансировки на ejectionTime после стольких ошибок подряд.
+    // Ошибка - исключение или ответ со статусом 5xx
+    std::size_t ejectAfterFailures{5};
+    std::chrono::nanoseconds ejectionTime{std::chrono::seconds(30)};
+
+    // Автоматический выключатель всего сервиса, без параметров выключен.
+    // Ошибки считаются так же, как для исключения реплик
+    std::optional<CircuitBreakerParams> circuitBreaker;
+};
+
+struct ReplicaState
+{
+    Uri target;
+    std::size_t inFlight{};
+    std::chrono::nanoseconds latency{};
+    bool ejected{false};
+};
+
+class Endpoint;
+using EndpointPtr = std::shared_ptr<Endpoint>;
+
+/**
+ * Service with several replicas behind a pooled client.
+ *
+ * Every request goes to the better of two random replicas (power of two choices): the one with the lower
+ * latency EWMA multiplied by the number of its requests in flight. A replica failing several times in a row
+ * is ejected for a while; if all of them are ejected, the ejection is ignored.
+ *
+ * With the circuit breaker the calls to the service that fails as a whole are rejected with CircuitOpenError
+ * at once.
+ *
+ * request.uri.host and port are replaced by the replica ones. The methods are called in the thread
+ * of the AOContext the endpoint is created in.
+ */
+class Endpoint
+{
+public:
+    virtual ~Endpoint() = default;
+
+    // Same as ClientPool::sendRequest()
+    virtual nhope::Future<Response> sendRequest(Request&& request) = 0;
+
+    // Same as ClientPool::openRequest()
+    virtual nhope::Future<Response> openRequest(Request&& request) = 0;
+
+    [[nodiscard]] virtual std::vector<ReplicaState> replicas() const = 0;
+
+    // Nothing without the circuit breaker
+    [[nodiscard]] virtual std::optional<CircuitBreakerMetrics> circuitBreakerMetrics() const = 0;
+
+    static EndpointPtr create(nhope::AOContext& aoCtx, EndpointParams params);
+};
+
+}   // namespace royalbed::client
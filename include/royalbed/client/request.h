@@ -18,4 +18,12 @@ using common::Request;
  */
 nhope::Future<common::Response> sendRequest(nhope::AOContext& aoCtx, Request&& request);
 
+/**
+ * @brief Установит соединение с сервером и отправит запрос, не дожидаясь тела ответа
+ *
+ * The future is resolved once the response headers are received. response.body reads the rest
+ * from the socket as it arrives and keeps the connection open until it is destroyed.
+ */
+nhope::Future<common::Response> openRequest(nhope::AOContext& aoCtx, Request&& request);
+
 }   // namespace royalbed::client
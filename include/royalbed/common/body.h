@@ -18,6 +18,7 @@
 #include "royalbed/common/detail/traits.h"
 #include "royalbed/common/headers.h"
 #include "royalbed/common/http-error.h"
+#include "royalbed/common/http-result.h"
 #include "royalbed/common/http-status.h"
 
 namespace royalbed::common {
@@ -28,6 +29,7 @@ enum class BodyType
     Xml,
     Plain
 };
+HttpResult<BodyType> tryExtractBodyType(const Headers& headers);
 BodyType extractBodyType(const Headers& headers);
 
 template<typename T, BodyType B = BodyType::Json>
@@ -95,7 +97,7 @@ struct IsBodyType
 };
 
 template<typename T>
-Body<T> parseBody(const Headers& /*headers*/, const std::vector<std::uint8_t>& rawBody)
+HttpResult<Body<T>> tryParseBody(const Headers& /*headers*/, const std::vector<std::uint8_t>& rawBody)
 {
     if constexpr (!detail::canDeserializeJson<T>) {
         static_assert(!std::is_same_v<T, T>, "T cannot be retrived from json."
@@ -103,19 +105,31 @@ Body<T> parseBody(const Headers& /*headers*/, const std::vector<std::uint8_t>& r
                                              "See https://github.com/nlohmann/json#basic-usage");
     }
 
+    // TODO parse content
+    const auto jsonValue = nlohmann::json::parse(rawBody.begin(), rawBody.end(), nullptr, false);
+    if (jsonValue.is_discarded()) {
+        const auto message = fmt::format("Failed to parse request body for {0}: invalid json", typeid(T).name());
+        return HttpError(HttpStatus::BadRequest, message);
+    }
+
     try {
-        // TODO parse content
-        const auto jsonValue = nlohmann::json::parse(rawBody.begin(), rawBody.end());
-        return jsonValue.get<T>();
+        // from_json is the user code, it reports the mismatch by throwing
+        return Body<T>(jsonValue.get<T>());
     } catch (const std::exception& ex) {
         const auto message = fmt::format("Failed to parse request body for {0}: {1}", typeid(T).name(), ex.what());
-        throw HttpError(HttpStatus::BadRequest, message);
+        return HttpError(HttpStatus::BadRequest, message);
     } catch (...) {
         const auto message = fmt::format("Failed to parse request body for {0}", typeid(T).name());
-        throw HttpError(HttpStatus::BadRequest, message);
+        return HttpError(HttpStatus::BadRequest, message);
     }
 }
 
+template<typename T>
+Body<T> parseBody(const Headers& headers, const std::vector<std::uint8_t>& rawBody)
+{
+    return tryParseBody<T>(headers, rawBody).value();
+}
+
 }   // namespace royalbed::common
 
 template<typename T>
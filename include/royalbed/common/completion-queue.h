@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+
+namespace royalbed::common {
+
+class CompletionQueue;
+using CompletionQueuePtr = std::shared_ptr<CompletionQueue>;
+
+// Expires with the owner of the completions, see CompletionOwner
+using CompletionGuard = std::weak_ptr<const void>;
+
+/**
+ * Owner of the completions that may go away before they are run, e.g. a session sharing the queue
+ * of its IO context with the other sessions. The completions posted with its guard are dropped once it is gone.
+ * The owner must be destroyed in the AOContext of the queue.
+ */
+class CompletionOwner final
+{
+public:
+    [[nodiscard]] CompletionGuard guard() const noexcept
+    {
+        return m_token;
+    }
+
+private:
+    std::shared_ptr<const bool> m_token = std::make_shared<const bool>(true);
+};
+
+/**
+ * Delivers completions from other threads (e.g. worker pool results) into an AOContext.
+ *
+ * post() is lock-free and may be called from any thread. The completions are collected into a batch
+ * and the whole batch is run in one AOContext::exec: only the post that finds the queue empty
+ * schedules the drain, the following ones join the pending batch.
+ * If the AOContext is closed, the pending completions are dropped.
+ *
+ * The continuations of the futures settled by the completions are run with dispatch() (or continueWith()),
+ * so they are called right in the drain too instead of taking one more exec each.
+ * A completion that throws doesn't prevent the rest of the batch, the first exception is rethrown after it.
+ *
+ * One queue serves all the sessions of an IO context, so the results of different sessions share the wakeups.
+ * The completions of a session are posted with its guard and are not run after the session is gone.
+ */
+class CompletionQueue final : public std::enable_shared_from_this<CompletionQueue>
+{
+    struct Tag
+    {};
+
+public:
+    using Completion = std::function<void()>;
+
+    CompletionQueue(Tag /*tag*/, nhope::AOContext& aoCtx);
+    ~CompletionQueue();
+
+    CompletionQueue(const CompletionQueue&) = delete;
+    CompletionQueue& operator=(const CompletionQueue&) = delete;
+
+    static CompletionQueuePtr create(nhope::AOContext& aoCtx);
+
+    void post(Completion completion);
+    void post(const CompletionGuard& guard, Completion completion);
+
+    // Runs the work right away if it is called from a drain of this queue (i.e. in the AOContext already),
+    // otherwise schedules it into the AOContext
+    void dispatch(Completion work);
+    void dispatch(const CompletionGuard& guard, Completion work);
+
+    // future.then(aoCtx, fn) that calls fn with dispatch(). The errors are passed on the same way.
+    // With the guard neither fn nor the error is passed on after the owner is gone
+    nhope::Future<void> continueWith(nhope::Future<void>&& future, Completion fn);
+    nhope::Future<void> continueWith(const CompletionGuard& guard, nhope::Future<void>&& future, Completion fn);
+
+    // True inside a drain of this queue on the current thread
+    [[nodiscard]] bool draining() const noexcept;
+
+    // Number of completions posted and number of the AOContext wakeups they took
+    [[nodiscard]] std::uint64_t postedCount() const noexcept;
+    [[nodiscard]] std::uint64_t wakeupCount() const noexcept;
+
+private:
+    struct Node
+    {
+        Completion completion;
+        Node* next;
+    };
+
+    static Completion guarded(const std::optional<CompletionGuard>& guard, Completion completion);
+
+    nhope::Future<void> continueIn(std::optional<CompletionGuard> guard, nhope::Future<void>&& future, Completion fn);
+    void drain();
+
+    nhope::AOContextRef m_aoCtxRef;
+    std::atomic<Node*> m_head{nullptr};
+
+    std::atomic<std::uint64_t> m_posted{0};
+    std::atomic<std::uint64_t> m_wakeups{0};
+};
+
+}   // namespace royalbed::common
@@ -0,0 +1,386 @@
+#pragma once
+
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+
+#include "royalbed/common/completion-queue.h"
+
+/**
+ * C++20 coroutines on top of nhope::Future.
+ *
+ * Any function returning nhope::Future<T> can be a coroutine:
+ *
+ *     nhope::Future<int> handler(RequestContext& ctx)
+ *     {
+ *         const auto body = co_await nhope::readAll(*ctx.request.body);
+ *         co_return body.size();
+ *     }
+ *
+ * The coroutine is resumed in the AOContext found among its arguments: an nhope::AOContext&
+ * or an object with the `aoCtx` member (e.g. RequestContext). Without it the coroutine is resumed
+ * where the awaited future is resolved. If the AOContext is closed while the coroutine is suspended,
+ * the coroutine frame is destroyed without resuming. `co_await resumeFrom(queue, guard, future)` resumes it
+ * right in the drain of the completion queue that settles the future, the frame is destroyed instead
+ * if the owner of the guard is gone.
+ *
+ * The frame is allocated from the pool of the current FramePoolScope if any.
+ * Lambda coroutines must not rely on captures after the first suspension, the lambda may be gone.
+ */
+
+namespace royalbed::common {
+
+/**
+ * Cache of coroutine frames, so the same coroutine started many times (e.g. once per request
+ * on a connection) does not touch the global allocator. Other objects recreated per request
+ * (e.g. the server session) are allocated from it with detail::allocateFrame too. Not thread-safe:
+ * a frame allocated from the pool returns to it only if it is destroyed by the allocating thread.
+ */
+class FramePool final
+{
+public:
+    FramePool();
+    ~FramePool();
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    [[nodiscard]] void* allocate(std::size_t size);
+    void deallocate(void* ptr, std::size_t size) noexcept;
+
+private:
+    static constexpr std::size_t maxCachedFrames = 4;
+
+    struct Block
+    {
+        void* ptr;
+        std::size_t size;
+    };
+
+    std::vector<Block> m_free;
+};
+
+using FramePoolPtr = std::shared_ptr<FramePool>;
+
+/**
+ * Coroutines started on this thread while the scope is alive allocate their frames from the pool.
+ * The frames keep the pool alive, so it may be released before a suspended coroutine is destroyed.
+ */
+class FramePoolScope final
+{
+public:
+    explicit FramePoolScope(FramePoolPtr pool) noexcept;
+    ~FramePoolScope();
+
+    FramePoolScope(const FramePoolScope&) = delete;
+    FramePoolScope& operator=(const FramePoolScope&) = delete;
+
+private:
+    FramePoolPtr m_prev;
+};
+
+/**
+ * A future settled by a completion of the queue, see resumeFrom()
+ */
+template<typename T>
+struct QueuedFuture
+{
+    nhope::Future<T> future;
+    CompletionQueuePtr queue;
+    std::optional<CompletionGuard> guard;
+};
+
+// The queue must run in the thread of the coroutine. A null queue is the same as co_await future
+template<typename T>
+QueuedFuture<T> resumeFrom(CompletionQueuePtr queue, nhope::Future<T>&& future)
+{
+    return {std::move(future), std::move(queue), std::nullopt};
+}
+
+template<typename T>
+QueuedFuture<T> resumeFrom(CompletionQueuePtr queue, CompletionGuard guard, nhope::Future<T>&& future)
+{
+    return {std::move(future), std::move(queue), std::move(guard)};
+}
+
+namespace detail {
+
+template<typename T>
+concept HasAOContext = requires(T& v)
+{
+    {
+        v.aoCtx
+        } -> std::convertible_to<nhope::AOContext&>;
+};
+
+template<typename T>
+nhope::AOContext* findAOContext(T& arg) noexcept
+{
+    using U = std::remove_cvref_t<T>;
+    if constexpr (std::is_same_v<U, nhope::AOContext>) {
+        return &arg;
+    } else if constexpr (HasAOContext<U>) {
+        return &arg.aoCtx;
+    } else {
+        return nullptr;
+    }
+}
+
+template<typename... Args>
+nhope::AOContext* findAOContext(Args&... args) noexcept
+{
+    nhope::AOContext* aoCtx = nullptr;
+    ((aoCtx = aoCtx != nullptr ? aoCtx : findAOContext(args)), ...);
+    return aoCtx;
+}
+
+void* allocateFrame(std::size_t size);
+void deallocateFrame(void* ptr, std::size_t size) noexcept;
+
+/**
+ * Resumes the coroutine once. If nobody resumed it (the AOContext was closed and the callbacks were dropped),
+ * destroys the suspended frame.
+ */
+class Resumption final
+{
+public:
+    explicit Resumption(std::coroutine_handle<> handle) noexcept
+      : m_handle(handle)
+    {}
+
+    Resumption(const Resumption&) = delete;
+    Resumption& operator=(const Resumption&) = delete;
+
+    ~Resumption()
+    {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    void resume()
+    {
+        std::exchange(m_handle, nullptr).resume();
+    }
+
+private:
+    std::coroutine_handle<> m_handle;
+};
+
+template<typename T>
+class FutureAwaiter final
+{
+public:
+    FutureAwaiter(nhope::Future<T>&& future, nhope::AOContext* aoCtx, CompletionQueuePtr queue = nullptr,
+                  std::optional<CompletionGuard> guard = std::nullopt)
+      : m_future(std::move(future))
+      , m_aoCtx(aoCtx)
+      , m_queue(std::move(queue))
+      , m_guard(std::move(guard))
+    {}
+
+    // A ready future continues inline, nothing is subscribed and scheduled
+    [[nodiscard]] bool await_ready() const noexcept
+    {
+        return m_future.isReady();
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        m_subscribed = true;
+        auto resumption = std::make_shared<Resumption>(handle);
+        if (m_queue != nullptr) {
+            this->subscribeQueued(std::move(resumption));
+            return;
+        }
+
+        auto onError = [this, resumption](std::exception_ptr ex) {
+            m_error = std::move(ex);
+            resumption->resume();
+        };
+
+        if constexpr (std::is_void_v<T>) {
+            this->subscribe(
+              [resumption] {
+                  resumption->resume();
+              },
+              std::move(onError));
+        } else {
+            this->subscribe(
+              [this, resumption](T value) {
+                  m_value.emplace(std::move(value));
+                  resumption->resume();
+              },
+              std::move(onError));
+        }
+    }
+
+    T await_resume()
+    {
+        if (!m_subscribed) {
+            return m_future.get();
+        }
+        if (m_error) {
+            std::rethrow_exception(std::move(m_error));
+        }
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(*m_value);
+        }
+    }
+
+private:
+    struct Empty
+    {};
+
+    template<typename OnValue, typename OnError>
+    void subscribe(OnValue&& onValue, OnError&& onError)
+    {
+        if (m_aoCtx != nullptr) {
+            std::move(m_future)
+              .then(*m_aoCtx, std::forward<OnValue>(onValue))
+              .fail(*m_aoCtx, std::forward<OnError>(onError));
+        } else {
+            std::move(m_future).then(std::forward<OnValue>(onValue)).fail(std::forward<OnError>(onError));
+        }
+    }
+
+    // The result is stored where the future is settled, the coroutine is resumed with the queue dispatch
+    void subscribeQueued(std::shared_ptr<Resumption> resumption)
+    {
+        auto resume = [queue = m_queue, guard = m_guard, resumption = std::move(resumption)] {
+            auto work = [resumption] {
+                resumption->resume();
+            };
+            if (guard.has_value()) {
+                queue->dispatch(*guard, std::move(work));
+            } else {
+                queue->dispatch(std::move(work));
+            }
+        };
+        auto onError = [this, resume](std::exception_ptr ex) {
+            m_error = std::move(ex);
+            resume();
+        };
+
+        if constexpr (std::is_void_v<T>) {
+            std::move(m_future).then(resume).fail(std::move(onError));
+        } else {
+            std::move(m_future)
+              .then([this, resume](T value) {
+                  m_value.emplace(std::move(value));
+                  resume();
+              })
+              .fail(std::move(onError));
+        }
+    }
+
+    nhope::Future<T> m_future;
+    nhope::AOContext* m_aoCtx;
+    CompletionQueuePtr m_queue;
+    std::optional<CompletionGuard> m_guard;
+    std::conditional_t<std::is_void_v<T>, Empty, std::optional<T>> m_value;
+    std::exception_ptr m_error;
+    bool m_subscribed = false;
+};
+
+template<typename T>
+class FuturePromiseBase
+{
+public:
+    template<typename... Args>
+    explicit FuturePromiseBase(Args&... args) noexcept
+      : m_aoCtx(findAOContext(args...))
+    {}
+
+    static void* operator new(std::size_t size)
+    {
+        return allocateFrame(size);
+    }
+
+    static void operator delete(void* ptr, std::size_t size) noexcept
+    {
+        deallocateFrame(ptr, size);
+    }
+
+    nhope::Future<T> get_return_object()
+    {
+        return m_promise.future();
+    }
+
+    std::suspend_never initial_suspend() noexcept
+    {
+        return {};
+    }
+
+    std::suspend_never final_suspend() noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception() noexcept
+    {
+        m_promise.setException(std::current_exception());
+    }
+
+    template<typename U>
+    FutureAwaiter<U> await_transform(nhope::Future<U>&& future)
+    {
+        return {std::move(future), m_aoCtx};
+    }
+
+    template<typename U>
+    FutureAwaiter<U> await_transform(QueuedFuture<U>&& queued)
+    {
+        return {std::move(queued.future), m_aoCtx, std::move(queued.queue), std::move(queued.guard)};
+    }
+
+protected:
+    nhope::Promise<T> m_promise;
+
+private:
+    nhope::AOContext* m_aoCtx;
+};
+
+template<typename T>
+class FuturePromise final : public FuturePromiseBase<T>
+{
+public:
+    using FuturePromiseBase<T>::FuturePromiseBase;
+
+    template<typename U>
+    void return_value(U&& value)
+    {
+        this->m_promise.setValue(std::forward<U>(value));
+    }
+};
+
+template<>
+class FuturePromise<void> final : public FuturePromiseBase<void>
+{
+public:
+    using FuturePromiseBase<void>::FuturePromiseBase;
+
+    void return_void()
+    {
+        this->m_promise.setValue();
+    }
+};
+
+}   // namespace detail
+
+}   // namespace royalbed::common
+
+template<typename T, typename... Args>
+struct std::coroutine_traits<nhope::Future<T>, Args...>
+{
+    using promise_type = royalbed::common::detail::FuturePromise<T>;
+};
@@ -2,9 +2,11 @@
 
 #include <algorithm>
 #include <cctype>
+#include <charconv>
 #include <functional>
 #include <string>
 #include <string_view>
+#include <system_error>
 #include <type_traits>
 
 namespace royalbed::common::detail {
@@ -61,6 +63,71 @@ struct LowercaseEqual final
     }
 };
 
+constexpr bool isSpace(char ch) noexcept
+{
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\f' || ch == '\v';
+}
+
+// Removes ASCII whitespaces, does not depend on the locale
+constexpr std::string_view strip(std::string_view str) noexcept
+{
+    while (!str.empty() && isSpace(str.front())) {
+        str.remove_prefix(1);
+    }
+    while (!str.empty() && isSpace(str.back())) {
+        str.remove_suffix(1);
+    }
+    return str;
+}
+
+template<typename T>
+concept FromCharsConvertible = std::is_arithmetic_v<T> || std::is_enum_v<T>;
+
+/**
+ * Converts numbers, bools ("true", "false", "1", "0") and enums (by the underlying value).
+ * Surrounding whitespaces and the leading '+' are allowed.
+ * Does not throw and does not allocate: returns std::errc::invalid_argument or std::errc::result_out_of_range
+ * on failure, `value` is left unchanged in that case.
+ */
+template<FromCharsConvertible T>
+std::errc tryFromString(std::string_view str, T& value) noexcept
+{
+    str = strip(str);
+
+    if constexpr (std::is_same_v<T, bool>) {
+        if (str == "true" || str == "1") {
+            value = true;
+        } else if (str == "false" || str == "0") {
+            value = false;
+        } else {
+            return std::errc::invalid_argument;
+        }
+        return std::errc{};
+    } else if constexpr (std::is_enum_v<T>) {
+        std::underlying_type_t<T> underlying{};
+        const auto ec = tryFromString(str, underlying);
+        if (ec == std::errc{}) {
+            value = static_cast<T>(underlying);
+        }
+        return ec;
+    } else {
+        if (!str.empty() && str.front() == '+') {
+            str.remove_prefix(1);
+        }
+
+        T result{};
+        const auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), result);
+        if (ec != std::errc{}) {
+            return ec;
+        }
+        if (ptr != str.data() + str.size()) {
+            return std::errc::invalid_argument;
+        }
+        value = result;
+        return std::errc{};
+    }
+}
+
 template<typename T>
 T fromString(std::string_view /*unused*/)
 {
@@ -96,4 +163,13 @@ long long fromString(std::string_view str);
 template<>
 unsigned long long fromString(std::string_view str);
 
+template<>
+float fromString(std::string_view str);
+
+template<>
+double fromString(std::string_view str);
+
+template<>
+bool fromString(std::string_view str);
+
 }   // namespace royalbed::common::detail
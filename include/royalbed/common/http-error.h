@@ -14,7 +14,7 @@ public:
     [[nodiscard]] int httpStatus() const;
 
 private:
-    const int m_httpStatus;
+    int m_httpStatus;
 };
 
 }   // namespace royalbed::common
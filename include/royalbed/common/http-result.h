@@ -0,0 +1,129 @@
+#pragma once
+
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "royalbed/common/http-error.h"
+
+namespace royalbed::common {
+
+/**
+ * Either a value or an HttpError, like std::expected<T, HttpError>.
+ * Used on the hot paths (parameters, bodies, routing) to report bad requests without throwing.
+ * value() throws the stored error, so callers that do not check the result keep the old behaviour.
+ */
+template<typename T>
+class HttpResult final
+{
+public:
+    HttpResult(T value)   // NOLINT(google-explicit-constructor)
+      : m_data(std::in_place_index<0>, std::move(value))
+    {}
+
+    HttpResult(HttpError error)   // NOLINT(google-explicit-constructor)
+      : m_data(std::in_place_index<1>, std::move(error))
+    {}
+
+    [[nodiscard]] bool hasValue() const noexcept
+    {
+        return m_data.index() == 0;
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return this->hasValue();
+    }
+
+    T& value() &
+    {
+        this->throwIfError();
+        return *std::get_if<0>(&m_data);
+    }
+
+    const T& value() const&
+    {
+        this->throwIfError();
+        return *std::get_if<0>(&m_data);
+    }
+
+    T&& value() &&
+    {
+        this->throwIfError();
+        return std::move(*std::get_if<0>(&m_data));
+    }
+
+    T& operator*() noexcept
+    {
+        return *std::get_if<0>(&m_data);
+    }
+
+    const T& operator*() const noexcept
+    {
+        return *std::get_if<0>(&m_data);
+    }
+
+    T* operator->() noexcept
+    {
+        return std::get_if<0>(&m_data);
+    }
+
+    const T* operator->() const noexcept
+    {
+        return std::get_if<0>(&m_data);
+    }
+
+    [[nodiscard]] const HttpError& error() const noexcept
+    {
+        return *std::get_if<1>(&m_data);
+    }
+
+private:
+    void throwIfError() const
+    {
+        if (const auto* error = std::get_if<1>(&m_data)) {
+            throw *error;
+        }
+    }
+
+    std::variant<T, HttpError> m_data;
+};
+
+template<>
+class HttpResult<void> final
+{
+public:
+    HttpResult() = default;
+
+    HttpResult(HttpError error)   // NOLINT(google-explicit-constructor)
+      : m_error(std::move(error))
+    {}
+
+    [[nodiscard]] bool hasValue() const noexcept
+    {
+        return !m_error.has_value();
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return this->hasValue();
+    }
+
+    void value() const
+    {
+        if (m_error.has_value()) {
+            throw *m_error;
+        }
+    }
+
+    [[nodiscard]] const HttpError& error() const noexcept
+    {
+        return *m_error;
+    }
+
+private:
+    std::optional<HttpError> m_error;
+};
+
+}   // namespace royalbed::common
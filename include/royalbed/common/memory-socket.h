@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/io/tcp.h"
+
+namespace royalbed::common {
+
+struct MemorySocketParams
+{
+    // Задержка доставки каждого сегмента
+    std::chrono::nanoseconds latency{};
+
+    // Пропускная способность в байтах в секунду, 0 - без ограничения.
+    // Запись завершается, когда данные "переданы" с заданной скоростью
+    std::uint64_t bandwidth{};
+
+    // Максимальный размер сегмента, 0 - без ограничения.
+    // Запись разбивается на сегменты, одно чтение никогда не возвращает данные двух сегментов
+    std::size_t maxSegmentSize{};
+};
+
+namespace detail {
+class MemoryPipe;
+}   // namespace detail
+
+/**
+ * Connection over memory: two one-way pipes, not bound to a thread yet.
+ * Each end is opened as an nhope::TcpSocket in the AOContext it is used in, so the ends
+ * may work in different threads. Reading an end returns 0 (EOF) after the other end is closed,
+ * writing to it fails with std::errc::broken_pipe.
+ */
+class MemoryLink final
+{
+public:
+    enum class End
+    {
+        First,
+        Second
+    };
+
+    explicit MemoryLink(const MemorySocketParams& params = {});
+
+    [[nodiscard]] nhope::TcpSocketPtr open(nhope::AOContext& aoCtx, End end) const;
+
+private:
+    std::shared_ptr<detail::MemoryPipe> m_forward;
+    std::shared_ptr<detail::MemoryPipe> m_backward;
+};
+
+std::pair<nhope::TcpSocketPtr, nhope::TcpSocketPtr> makeMemorySocketPair(nhope::AOContext& firstCtx,
+                                                                         nhope::AOContext& secondCtx,
+                                                                         const MemorySocketParams& params = {});
+
+}   // namespace royalbed::common
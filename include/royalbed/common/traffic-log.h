@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "royalbed/common/headers.h"
+
+namespace royalbed::common {
+
+struct CapturedRequest
+{
+    // Since the start of the capture
+    std::chrono::nanoseconds time{};
+
+    std::string method;
+
+    // Path with the query
+    std::string target;
+
+    Headers headers;
+
+    // false if the body was not recorded (too large or of unknown size)
+    bool bodyCaptured{true};
+    std::string body;
+};
+
+/**
+ * Writes captured requests to a compact binary log: a magic followed by the records,
+ * integers are LEB128 varints, strings are prefixed with their size. The records are written by blocks,
+ * flush() saves the recent ones. Thread-safe.
+ */
+class TrafficLogWriter final
+{
+public:
+    explicit TrafficLogWriter(const std::filesystem::path& path);
+    ~TrafficLogWriter();
+
+    TrafficLogWriter(const TrafficLogWriter&) = delete;
+    TrafficLogWriter& operator=(const TrafficLogWriter&) = delete;
+
+    // Time since the writer was created, for CapturedRequest::time
+    [[nodiscard]] std::chrono::nanoseconds elapsed() const noexcept;
+
+    void write(const CapturedRequest& request);
+    void flush();
+
+private:
+    const std::chrono::steady_clock::time_point m_start;
+
+    std::mutex m_mutex;
+    std::string m_buffer;
+    std::ofstream m_file;
+};
+
+using TrafficLogWriterPtr = std::shared_ptr<TrafficLogWriter>;
+
+/**
+ * Reads the log written by TrafficLogWriter. A truncated last record (e.g. the capturing process
+ * was killed) is ignored, any other damage throws std::runtime_error.
+ */
+class TrafficLogReader final
+{
+public:
+    explicit TrafficLogReader(const std::filesystem::path& path);
+
+    std::optional<CapturedRequest> next();
+
+private:
+    std::ifstream m_file;
+};
+
+}   // namespace royalbed::common
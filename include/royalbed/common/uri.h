@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <string_view>
@@ -15,9 +19,108 @@ public:
     explicit UriParseError(std::string_view msg);
 };
 
+/**
+ * Query parameters.
+ * The query is parsed on the first access. All names and values are kept in one buffer: parsed parameters
+ * refer to the encoded query string, only names and values with escape sequences are unescaped
+ * into the tail of the buffer. Lookups in large queries use a small hash index.
+ * Const methods modify the internal cache, so the object must not be accessed from several threads at once.
+ */
+class UriQuery final
+{
+public:
+    using Param = std::pair<std::string_view, std::string_view>;
+
+    class Iterator final
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Param;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Param;
+
+        Iterator() = default;
+        Iterator(const UriQuery* query, std::size_t index) noexcept
+          : m_query(query)
+          , m_index(index)
+        {}
+
+        Param operator*() const noexcept
+        {
+            return (*m_query)[m_index];
+        }
+
+        Iterator& operator++() noexcept
+        {
+            ++m_index;
+            return *this;
+        }
+
+        Iterator operator++(int) noexcept
+        {
+            auto retval = *this;
+            ++m_index;
+            return retval;
+        }
+
+        bool operator==(const Iterator& other) const noexcept = default;
+
+    private:
+        const UriQuery* m_query = nullptr;
+        std::size_t m_index = 0;
+    };
+
+    UriQuery() = default;
+    UriQuery(std::initializer_list<Param> params);
+
+    // "name=value&name2=value2", parsing is deferred until the first access.
+    // The access to the parameters throws UriParseError if the query is malformed
+    static UriQuery parse(std::string_view encoded);
+
+    // Parses the query if it is not parsed yet and returns the reason if it is malformed, does not throw it
+    [[nodiscard]] std::optional<std::string_view> tryParse() const;
+
+    [[nodiscard]] bool empty() const;
+    [[nodiscard]] std::size_t size() const;
+
+    [[nodiscard]] Param operator[](std::size_t index) const;
+    [[nodiscard]] std::optional<std::string_view> find(std::string_view name) const;
+
+    void add(std::string_view name, std::string_view value);
+
+    [[nodiscard]] Iterator begin() const;
+    [[nodiscard]] Iterator end() const;
+
+    bool operator==(const UriQuery& other) const;
+
+private:
+    static constexpr std::size_t indexThreshold = 8;
+
+    struct Piece
+    {
+        std::uint32_t offset;
+        std::uint32_t size;
+    };
+
+    void parseIfNeeded() const;
+    void buildIndex() const;
+
+    [[nodiscard]] std::string_view view(Piece piece) const noexcept;
+    Piece append(std::string_view str);
+
+    mutable std::string m_buffer;
+    std::uint32_t m_encodedSize = 0;
+    mutable bool m_parsed = true;
+    mutable std::vector<std::pair<Piece, Piece>> m_params;
+
+    // open addressing, param index + 1 (0 is empty slot)
+    mutable std::vector<std::uint32_t> m_index;
+};
+
 struct Uri final
 {
-    using Query = std::vector<std::pair<std::string, std::string>>;
+    using Query = UriQuery;
 
     std::string scheme;
     std::string host;
@@ -43,6 +146,14 @@ enum class UriEscapeMode
     Path,
 };
 
+/**
+ * Appends `in` to `out` with the symbols not allowed in the mode percent-encoded, a space in the query is '+'.
+ *
+ * Runs of allowed symbols are looked for with AVX2 or SSE2 and copied in bulk. The instruction set is chosen
+ * at compile time only, by __AVX2__/__SSE2__, there is no runtime CPU dispatch: a default x86-64 build uses SSE2,
+ * AVX2 is used only when the library is built with -mavx2 (or a -march that has it),
+ * other targets use a scalar loop.
+ */
 void uriEscape(std::string& out, std::string_view in, UriEscapeMode mode = UriEscapeMode::Other);
 std::string uriEscape(std::string_view in, UriEscapeMode mode = UriEscapeMode::Other);
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <optional>
 
@@ -9,6 +10,8 @@
 #include "nhope/io/tcp.h"
 #include "spdlog/logger.h"
 
+#include "royalbed/common/completion-queue.h"
+#include "royalbed/server/detail/session.h"
 #include "royalbed/server/router.h"
 
 namespace royalbed::server::detail {
@@ -40,6 +43,10 @@ struct KeepAliveParams
     // Для поддержки keep-alive соединений необходимо указать число больше 1
     std::uint16_t requestsCount{defaultRequests};
 
+    // Максимальный размер непрочитанного обработчиком тела запроса, который будет вычитан и отброшен,
+    // чтобы сохранить соединение. Если тело больше, соединение закрывается после отправки ответа.
+    std::size_t maxDrainBodySize{SessionParams::defaultMaxDrainBodySize};
+
     static constexpr std::uint16_t defaultRequests{1000};
     static constexpr auto defaultMaxTime{std::chrono::seconds(600)};
 };
@@ -51,6 +58,9 @@ struct ConnectionParams
     ConnectionCtx& ctx;
     std::shared_ptr<spdlog::logger> log;
     nhope::TcpSocketPtr sock;
+
+    // Очередь завершений из других потоков в контекст сервера, общая для всех соединений
+    common::CompletionQueuePtr completions;
 };
 
 void openConnection(nhope::AOContext& aoCtx, ConnectionParams&& params);
@@ -2,12 +2,14 @@
 
 #include <exception>
 #include <optional>
-#include <string>
 #include <string_view>
+#include <system_error>
+#include <utility>
 
 #include "fmt/core.h"
 
 #include "royalbed/common/detail/string-utils.h"
+#include "royalbed/common/http-result.h"
 #include "royalbed/server/error.h"
 #include "royalbed/server/http-status.h"
 #include "royalbed/server/param-properties.h"
@@ -15,28 +17,61 @@
 
 namespace royalbed::server::detail {
 
-std::optional<std::string> extractParam(const RequestContext& req, std::string_view name, ParamLocation loc,
-                                        bool required);
+// The value refers to the request context
+common::HttpResult<std::optional<std::string_view>> tryExtractParam(const RequestContext& req, std::string_view name,
+                                                                    ParamLocation loc, bool required);
+std::optional<std::string_view> extractParam(const RequestContext& req, std::string_view name, ParamLocation loc,
+                                             bool required);
 
+// The value is made only from a parsed string, so T does not have to be default constructible
 template<typename T>
-std::optional<T> extractParam(const RequestContext& req, const ParamProperties<T>& paramProps)
+ParamError parseParam(std::string_view str, std::optional<T>& value) noexcept(common::detail::FromCharsConvertible<T>)
 {
-    const auto param = extractParam(req, paramProps.name, paramProps.loc, paramProps.required);
-    try {
-        if (!param.has_value()) {
-            return paramProps.defaultValue;
+    if constexpr (common::detail::FromCharsConvertible<T>) {
+        T parsed{};
+        const auto ec = common::detail::tryFromString(str, parsed);
+        if (ec == std::errc{}) {
+            value.emplace(parsed);
+            return ParamError::None;
         }
-
-        T val = common::detail::fromString<T>(param.value());
-        for (const auto& validate : paramProps.validators) {
-            validate(val);
+        return ec == std::errc::result_out_of_range ? ParamError::OutOfRange : ParamError::InvalidValue;
+    } else {
+        try {
+            value.emplace(common::detail::fromString<T>(str));
+            return ParamError::None;
+        } catch (const std::exception&) {
+            return ParamError::InvalidValue;
         }
-        return val;
+    }
+}
 
-    } catch (const std::exception& ex) {
-        const auto message = fmt::format("Failed to get '{}' parameter: {}", paramProps.name, ex.what());
-        throw HttpError(HttpStatus::BadRequest, message);
+template<typename T, ParamError (*check)(const T&) noexcept>
+common::HttpResult<std::optional<T>> tryExtractParam(const RequestContext& req, const ParamProperties<T>& paramProps)
+{
+    auto param = tryExtractParam(req, paramProps.name, paramProps.loc, paramProps.required);
+    if (!param) {
+        return param.error();
+    }
+    if (!param->has_value()) {
+        return paramProps.defaultValue;
     }
+
+    std::optional<T> val;
+    auto error = parseParam(**param, val);
+    if (error == ParamError::None) {
+        error = check(*val);
+    }
+    if (error != ParamError::None) {
+        const auto message = fmt::format("Failed to get '{}' parameter: {}", paramProps.name, toString(error));
+        return HttpError(HttpStatus::BadRequest, message);
+    }
+    return val;
+}
+
+template<typename T, ParamError (*check)(const T&) noexcept>
+std::optional<T> extractParam(const RequestContext& req, const ParamProperties<T>& paramProps)
+{
+    return tryExtractParam<T, check>(req, paramProps).value();
 }
 
 }   // namespace royalbed::server::detail
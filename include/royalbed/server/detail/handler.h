@@ -25,6 +25,7 @@
 #include "royalbed/common/request.h"
 #include "royalbed/common/detail/traits.h"
 #include "royalbed/common/body.h"
+#include "royalbed/common/http-result.h"
 #include "royalbed/server/param.h"
 #include "royalbed/server/error.h"
 #include "royalbed/server/low-level-handler.h"
@@ -157,6 +158,11 @@ auto constructParams(Params&&... p)
     return std::make_tuple(std::forward<Params>(p)...);
 }
 
+template<typename T>
+static constexpr bool isHttpResult = false;
+template<typename T>
+static constexpr bool isHttpResult<common::HttpResult<T>> = true;
+
 template<BodyTypename BType, typename Type>
 auto initParam(RequestContext& ctx, BType& body)
 {
@@ -164,6 +170,8 @@ auto initParam(RequestContext& ctx, BType& body)
         return BType(std::move(body));   // call move constructor
     } else if constexpr (std::is_same_v<Type, RequestContext&>) {
         return std::ref(ctx);
+    } else if constexpr (isQueryOrParam<std::decay_t<Type>>) {
+        return std::decay_t<Type>::tryMake(ctx);
     } else if constexpr (std::is_constructible_v<Type, RequestContext&>) {
         return Type(ctx);
     } else {
@@ -171,17 +179,49 @@ auto initParam(RequestContext& ctx, BType& body)
     }
 }
 
+template<typename T>
+const HttpError* paramError(const T& param) noexcept
+{
+    if constexpr (isHttpResult<T>) {
+        return param ? nullptr : &param.error();
+    } else {
+        return nullptr;
+    }
+}
+
+template<typename T>
+decltype(auto) unwrapParam(T&& param) noexcept
+{
+    if constexpr (isHttpResult<std::decay_t<T>>) {
+        return std::move(*param);
+    } else {
+        return std::forward<T>(param);
+    }
+}
+
 template<typename Handler, BodyTypename BodyT, std::size_t... IArg>
 auto callUserHandler(RequestContext& ctx, BodyT&& body, Handler&& handler, std::index_sequence<IArg...> /*unused*/)
 {
     using namespace nhope;
     using FnProps = FunctionProps<decltype(std::function(std::declval<Handler>()))>;
     using FnRet = typename FnProps::ReturnType;
+    using Result = common::HttpResult<FnRet>;
+
     auto paramTuple = constructParams(initParam<BodyT, typename FnProps::template ArgumentType<IArg>>(ctx, body)...);
+
+    // the first rejected parameter makes the bad request
+    const HttpError* error = nullptr;
+    ((error = error != nullptr ? error : paramError(std::get<IArg>(paramTuple))), ...);
+    if (error != nullptr) {
+        return Result(*error);
+    }
+
+    auto args = std::forward_as_tuple(unwrapParam(std::get<IArg>(std::move(paramTuple)))...);
     if constexpr (std::is_void_v<FnRet>) {
-        std::apply(handler, std::move(paramTuple));
+        std::apply(handler, std::move(args));
+        return Result();
     } else {
-        return std::apply(handler, std::move(paramTuple));
+        return Result(std::apply(handler, std::move(args)));
     }
 }
 
@@ -191,23 +231,29 @@ nhope::Future<void> callHandler(Handler&& handler, RequestContext& ctx, BodyT&&
     using FnProps = nhope::FunctionProps<decltype(std::function(std::declval<Handler>()))>;
     using R = typename FnProps::ReturnType;
 
-    if constexpr (std::is_void_v<R>) {
-        callUserHandler(ctx, std::move(body), std::forward<Handler>(handler),
-                        std::make_index_sequence<FnProps::argumentCount>{});
-    } else {
-        R result = callUserHandler(ctx, std::move(body), std::forward<Handler>(handler),
-                                   std::make_index_sequence<FnProps::argumentCount>{});
+    auto result = callUserHandler(ctx, std::move(body), std::forward<Handler>(handler),
+                                  std::make_index_sequence<FnProps::argumentCount>{});
+    if (!result) {
+        ctx.error = result.error();
+        return nhope::makeReadyFuture();
+    }
+
+    if constexpr (!std::is_void_v<R>) {
         if constexpr (nhope::isFuture<R>) {
             using FR = typename R::Type;
             if constexpr (std::is_void_v<FR>) {
-                return result;
+                return std::move(*result);
             } else {
-                return result.then(ctx.aoCtx, [&ctx](FR v) mutable {
+                if (result->isReady()) {
+                    addContent(ctx, nlohmann::to_string(nlohmann::json(result->get())));
+                    return nhope::makeReadyFuture();
+                }
+                return std::move(*result).then(ctx.aoCtx, [&ctx](FR v) mutable {
                     addContent(ctx, nlohmann::to_string(nlohmann::json(v)));
                 });
             }
         } else {
-            addContent(ctx, nlohmann::to_string(nlohmann::json(result)));
+            addContent(ctx, nlohmann::to_string(nlohmann::json(*result)));
         }
     }
     return nhope::makeReadyFuture();
@@ -218,7 +264,12 @@ nhope::Future<void> fetchBodyAndCallHandler(Handler handler, RequestContext& ctx
 {
     return nhope::readAll(*ctx.request.body)
       .then(ctx.aoCtx, [&ctx, handler = std::move(handler)](const auto& rawBody) mutable {
-          BodyT body = common::parseBody<typename BodyT::Type>(ctx.request.headers, rawBody);
+          auto parsed = common::tryParseBody<typename BodyT::Type>(ctx.request.headers, rawBody);
+          if (!parsed) {
+              ctx.error = parsed.error();
+              return nhope::makeReadyFuture();
+          }
+          BodyT body = std::move(*parsed);
           return callHandler(std::move(handler), ctx, std::move(body));
       });
 }
@@ -235,8 +286,14 @@ LowLevelHandler makeLowLevelHandler(Handler&& handler, int defaultStatus)
         constexpr bool paramHasBody = bodyIndex != -1;
         if constexpr (paramHasBody) {
             using BType = std::decay_t<typename FnProps::template ArgumentType<bodyIndex>>;
-            if (common::extractBodyType(ctx.request.headers) != BType::type()) {
-                throw HttpError(HttpStatus::BadRequest, "request body has incompatible content type");
+            const auto bodyType = common::tryExtractBodyType(ctx.request.headers);
+            if (!bodyType) {
+                ctx.error = bodyType.error();
+                return nhope::makeReadyFuture();
+            }
+            if (*bodyType != BType::type()) {
+                ctx.error = HttpError(HttpStatus::BadRequest, "request body has incompatible content type");
+                return nhope::makeReadyFuture();
             }
             return fetchBodyAndCallHandler<Handler, BType>(handler, ctx);
         } else {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -11,6 +12,8 @@
 #include "nhope/io/io-device.h"
 #include "nhope/io/pushback-reader.h"
 
+#include "royalbed/common/completion-queue.h"
+#include "royalbed/common/coro.h"
 #include "royalbed/server/request-context.h"
 #include "royalbed/server/router.h"
 
@@ -25,6 +28,9 @@ public:
     virtual void sessionFinished(std::uint32_t sessionNum, bool keepALive) noexcept = 0;
 
     virtual bool sessionNeedClose() noexcept = 0;
+
+    // The buffer to skip an unread request body, shared by the sessions of the connection
+    virtual gsl::span<std::uint8_t> drainBuffer() = 0;
 };
 
 struct SessionParams
@@ -35,6 +41,17 @@ struct SessionParams
     nhope::PushbackReader& in;
     nhope::Writter& out;
     std::shared_ptr<spdlog::logger> log;
+
+    // Сколько байт непрочитанного тела запроса можно отбросить, чтобы сохранить keep-alive соединение
+    std::size_t maxDrainBodySize{defaultMaxDrainBodySize};
+
+    // Кэш кадров корутин сессии, общий для всех сессий соединения
+    common::FramePoolPtr framePool;
+
+    // Очередь завершений из других потоков в контекст сервера, общая для всех сессий, может отсутствовать
+    common::CompletionQueuePtr completions;
+
+    static constexpr std::size_t defaultMaxDrainBodySize{64 * 1024};
 };
 
 void startSession(nhope::AOContext& aoCtx, SessionParams&& params);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nhope/io/sock-addr.h"
+#include "nhope/io/tcp.h"
+
+#include "royalbed/common/memory-socket.h"
+
+namespace royalbed::server {
+
+class Listener;
+using ListenerPtr = std::shared_ptr<Listener>;
+
+/**
+ * Source of the incoming connections of the server.
+ */
+class Listener
+{
+public:
+    virtual ~Listener() = default;
+
+    virtual nhope::Future<nhope::TcpSocketPtr> accept() = 0;
+
+    [[nodiscard]] virtual nhope::SockAddr bindAddress() const = 0;
+
+    static ListenerPtr listenTcp(nhope::AOContext& aoCtx, const std::string& address, std::uint16_t port);
+};
+
+class MemoryListener;
+using MemoryListenerPtr = std::shared_ptr<MemoryListener>;
+
+/**
+ * Accepts connections over memory (common::MemoryLink) instead of the kernel, so the whole server
+ * can be run in-process without syscalls, e.g. in benchmarks and simulations.
+ */
+class MemoryListener : public Listener
+{
+public:
+    // Opens the client end of a new connection in aoCtx. May be called from any thread
+    [[nodiscard]] virtual nhope::TcpSocketPtr connect(nhope::AOContext& aoCtx) = 0;
+
+    static MemoryListenerPtr create(nhope::AOContext& aoCtx, const common::MemorySocketParams& params = {});
+};
+
+}   // namespace royalbed::server
@@ -1,10 +1,72 @@
 #pragma once
 
 #include <functional>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+#include "nhope/async/future.h"
+#include "nhope/utils/type.h"
+
 #include "royalbed/server/request-context.h"
 
 namespace royalbed::server {
 
-using Middleware = std::function<nhope::Future<bool>(RequestContext& ctx)>;
+/**
+ * Returns true to pass the request further (to the next middleware and the handler).
+ * A middleware may return nhope::Future<bool> or a plain bool. Synchronous middlewares are called
+ * inline by the session without any futures.
+ */
+class Middleware final
+{
+public:
+    using SyncFn = std::function<bool(RequestContext& ctx)>;
+    using AsyncFn = std::function<nhope::Future<bool>(RequestContext& ctx)>;
+
+    Middleware() = default;
+
+    template<typename Fn>
+    requires(!std::is_same_v<std::remove_cvref_t<Fn>, Middleware>)
+    Middleware(Fn&& fn)   // NOLINT(google-explicit-constructor)
+    {
+        using R = std::invoke_result_t<Fn&, RequestContext&>;
+        if constexpr (nhope::isFuture<R>) {
+            m_async = std::forward<Fn>(fn);
+        } else {
+            static_assert(std::is_same_v<R, bool>, "middleware must return bool or nhope::Future<bool>");
+            m_sync = std::forward<Fn>(fn);
+        }
+    }
+
+    [[nodiscard]] bool isSync() const noexcept
+    {
+        return m_sync != nullptr;
+    }
+
+    [[nodiscard]] const SyncFn& sync() const noexcept
+    {
+        return m_sync;
+    }
+
+    [[nodiscard]] const AsyncFn& async() const noexcept
+    {
+        return m_async;
+    }
+
+    // Type of the stored callable, same as std::function::target_type()
+    [[nodiscard]] const std::type_info& target_type() const noexcept   // NOLINT(readability-identifier-naming)
+    {
+        return m_sync != nullptr ? m_sync.target_type() : m_async.target_type();
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return m_sync != nullptr || m_async != nullptr;
+    }
+
+private:
+    SyncFn m_sync;
+    AsyncFn m_async;
+};
 
 }   // namespace royalbed::server
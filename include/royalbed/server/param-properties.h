@@ -1,10 +1,8 @@
 #pragma once
 
-#include <functional>
 #include <optional>
 #include <string>
 #include <string_view>
-#include <vector>
 
 namespace royalbed::server {
 
@@ -14,6 +12,18 @@ enum class ParamLocation
     Query
 };
 
+// The reason why the parameter value is rejected
+enum class ParamError
+{
+    None,
+    InvalidValue,
+    OutOfRange,
+    TooBig,
+    TooSmall,
+};
+
+std::string_view toString(ParamError error) noexcept;
+
 template<typename T>
 struct ParamProperties final
 {
@@ -25,7 +35,6 @@ struct ParamProperties final
     ParamLocation loc = ParamLocation::Path;
     bool required = true;
     std::optional<T> defaultValue;
-    std::vector<std::function<void(const T&)>> validators;
 };
 
 }   // namespace royalbed::server
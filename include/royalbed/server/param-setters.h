@@ -4,14 +4,12 @@
 #include <cstddef>
 #include <cstdint>
 #include <tuple>
+#include <type_traits>
 #include <string_view>
-
-#include <fmt/format.h>
+#include <utility>
 
 #include "royalbed/server/string-literal.h"
 #include "royalbed/server/param-properties.h"
-#include "royalbed/server/error.h"
-#include "royalbed/server/http-status.h"
 
 namespace royalbed::server {
 
@@ -69,13 +67,13 @@ template<std::int64_t MaxVal>
 struct Max final
 {
     template<typename T>
-    static void validate(ParamProperties<T>& properties)
+    static constexpr ParamError check(const T& val) noexcept
     {
-        properties.validators.emplace_back([](const auto& val) {
-            if (val > MaxVal) {
-                throw common::HttpError(common::HttpStatus::BadRequest, fmt::format("param value to big: {}", val));
-            }
-        });
+        if constexpr (std::is_integral_v<T>) {
+            return std::cmp_greater(val, MaxVal) ? ParamError::TooBig : ParamError::None;
+        } else {
+            return val > MaxVal ? ParamError::TooBig : ParamError::None;
+        }
     }
 };
 
@@ -83,13 +81,13 @@ template<std::int64_t MinVal>
 struct Min final
 {
     template<typename T>
-    static void validate(ParamProperties<T>& properties)
+    static constexpr ParamError check(const T& val) noexcept
     {
-        properties.validators.emplace_back([](const auto& val) {
-            if (val < MinVal) {
-                throw common::HttpError(common::HttpStatus::BadRequest, fmt::format("param value to small: {}", val));
-            }
-        });
+        if constexpr (std::is_integral_v<T>) {
+            return std::cmp_less(val, MinVal) ? ParamError::TooSmall : ParamError::None;
+        } else {
+            return val < MinVal ? ParamError::TooSmall : ParamError::None;
+        }
     }
 };
 
@@ -4,6 +4,7 @@
 #include <type_traits>
 #include <utility>
 
+#include "royalbed/common/http-result.h"
 #include "royalbed/server/detail/extract-param.h"
 #include "royalbed/server/param-properties.h"
 #include "royalbed/server/param-setters.h"
@@ -23,8 +24,8 @@ template<typename T, typename P>
 concept ParametrValidateble = requires
 {
     {
-        T::validate(std::declval<ParamProperties<P>&>())
-        } -> std::same_as<void>;
+        T::check(std::declval<const P&>())
+        } -> std::same_as<ParamError>;
 };
 
 template<typename T, typename P>
@@ -48,12 +49,29 @@ void initProperties(ParamProperties<T>& properties)
 {
     if constexpr (ParametrSetterable<HeadProperty, T>) {
         HeadProperty::set(properties);
-    } else if constexpr (ParametrValidateble<HeadProperty, T>) {
-        HeadProperty::validate(properties);
     }
     initProperties<T, TailProperties...>(properties);
 }
 
+template<typename T, typename Property>
+constexpr ParamError checkProperty(const T& val) noexcept
+{
+    if constexpr (ParametrValidateble<Property, T>) {
+        return Property::check(val);
+    } else {
+        return ParamError::None;
+    }
+}
+
+// All validators of the pack are inlined into one function, the first failed check wins
+template<typename T, ParametrSettings<T>... Properties>
+constexpr ParamError checkProperties(const T& val) noexcept
+{
+    auto error = ParamError::None;
+    [[maybe_unused]] const bool valid = (((error = checkProperty<T, Properties>(val)) == ParamError::None) && ...);
+    return error;
+}
+
 template<typename T, ParametrSettings<T>... Setters>
 void checkProps()
 {
@@ -83,9 +101,19 @@ public:
     Param& operator=(Param&&) noexcept = default;
 
     Param(const RequestContext& req)
-      : m_data(detail::extractParam<T>(req, Param::props()))
+      : m_data(detail::extractParam<T, &checkProperties<T, Properties...>>(req, Param::props()))
     {}
 
+    // Reports the bad request by value instead of throwing HttpError
+    static common::HttpResult<Param> tryMake(const RequestContext& req)
+    {
+        auto data = detail::tryExtractParam<T, &checkProperties<T, Properties...>>(req, Param::props());
+        if (!data) {
+            return data.error();
+        }
+        return Param(std::move(*data));
+    }
+
     const T& operator*() const
     {
         return m_data.value();
@@ -123,6 +151,10 @@ public:
     }
 
 private:
+    explicit Param(std::optional<T> data)
+      : m_data(std::move(data))
+    {}
+
     std::optional<T> m_data;
 };
 
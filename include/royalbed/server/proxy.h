@@ -0,0 +1,40 @@
+#pragma once
+
+#include "nhope/async/ao-context.h"
+
+#include "royalbed/client/client-pool.h"
+#include "royalbed/client/uri.h"
+#include "royalbed/server/low-level-handler.h"
+
+namespace royalbed::server {
+
+struct ProxyParams
+{
+    // Сервис, которому передаются запросы: host, port и префикс пути.
+    // Путь и query запроса добавляются к префиксу
+    client::Uri upstream;
+
+    // Пул соединений с сервисом
+    client::ClientPoolParams pool;
+};
+
+/**
+ * Handler passing the requests to the upstream service over pooled keep-alive connections.
+ *
+ * Both bodies are streamed: the request body is read from the client as the upstream connection takes it,
+ * the response is made as soon as the upstream headers arrive and its body is read from the upstream
+ * as the client takes it, so a slow peer on either side slows down the other one.
+ *
+ * The hop-by-hop headers (Connection and the headers it names, Keep-Alive, Proxy-*, TE, Trailer,
+ * Transfer-Encoding, Upgrade) are not passed, a body of unknown length is sent chunked.
+ * The upstream failures are answered with "502 Bad Gateway", the timeouts with "504 Gateway Timeout".
+ *
+ * The pool lives in aoCtx, the handler may be called from any server thread: the bodies are read in the contexts
+ * of their owners. The session reads the next request only when the upstream is done with the body of the current
+ * one, even if it has answered earlier, and closes the connection if the body has not been forwarded whole:
+ *
+ *     router.setNotFoundHandler(proxyTo(aoCtx, {.upstream = client::Uri::parse("http://legacy:8080")}));
+ */
+LowLevelHandler proxyTo(nhope::AOContext& aoCtx, ProxyParams params);
+
+}   // namespace royalbed::server
@@ -4,6 +4,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -12,13 +13,17 @@
 
 #include "nhope/async/ao-context.h"
 
+#include "royalbed/common/completion-queue.h"
+#include "royalbed/server/error.h"
 #include "royalbed/server/request.h"
 #include "royalbed/server/response.h"
 
 namespace royalbed::server {
 
 class Router;
-using RawPathParams = std::vector<std::pair<std::string, std::string>>;
+
+// Names refer to the router resources, values refer to the request path
+using RawPathParams = std::vector<std::pair<std::string_view, std::string_view>>;
 
 struct RequestContext final
 {
@@ -35,6 +40,17 @@ struct RequestContext final
 
     Response response;
 
+    // The bad request reported by a handler or a middleware without throwing.
+    // The router turns it into the response for the route handlers, the session does it for the middlewares
+    std::optional<HttpError> error;
+
+    // Delivers results of other threads (e.g. the worker pool) into aoCtx in batches.
+    // Shared by all the sessions of the server IO context, may be null
+    common::CompletionQueuePtr completions;
+
+    // The completions posted for the request are dropped if the session is gone by then
+    common::CompletionOwner completionOwner;
+
     nhope::AOContext aoCtx;
 };
 
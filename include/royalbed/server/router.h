@@ -55,6 +55,7 @@ public:
     Router& setMethodNotAllowedHandler(LowLevelHandler handler);
     Router& setExceptionHandler(ExceptionHandler handler);
 
+    // RouteResult::rawPathParams refer to `path`, so it must outlive the result
     [[nodiscard]] RouteResult route(std::string_view method, std::string_view path) const;
     [[nodiscard]] std::vector<std::string> allowMethods(std::string_view path) const;
 
@@ -152,9 +153,11 @@ public:
 
 private:
     Router& addRoute(std::string_view method, std::string_view resource, LowLevelHandler handler);
-    void processException(RequestContext& ctx, std::exception_ptr e, std::string_view normalizedPath) const;
-
     class Node;
+
+    static void processException(RequestContext& ctx, std::exception_ptr e, const Node& node);
+    static void processError(RequestContext& ctx, const Node& node);
+
     std::unique_ptr<Node> m_root;
 };
 
@@ -8,6 +8,7 @@
 #include "spdlog/logger.h"
 #include "nhope/async/ao-context.h"
 
+#include "royalbed/server/listener.h"
 #include "royalbed/server/router.h"
 
 namespace royalbed::server {
@@ -20,6 +21,10 @@ struct ServerParams
     Router router;
 
     std::shared_ptr<spdlog::logger> log;
+
+    // Источник входящих соединений (например, MemoryListener).
+    // Если не задан, сервер принимает TCP-соединения на bindAddress:port
+    ListenerPtr listener;
 };
 
 class Server;
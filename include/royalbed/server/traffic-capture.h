@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+
+#include "royalbed/common/traffic-log.h"
+#include "royalbed/server/middleware.h"
+
+namespace royalbed::server {
+
+struct TrafficCaptureParams
+{
+    common::TrafficLogWriterPtr log;
+
+    // Bodies over the limit are not recorded, only the request head is.
+    // The body is recorded while the handler reads it, the request is written when the body is read to the end
+    // (so the records of the requests with bodies follow the handler, CapturedRequest::time is of the arrival)
+    std::size_t maxBodySize{defaultMaxBodySize};
+
+    static constexpr std::size_t defaultMaxBodySize{1024 * 1024};
+};
+
+/**
+ * Middleware recording the incoming requests to a traffic log for a later replay:
+ *
+ *     auto log = std::make_shared<common::TrafficLogWriter>("traffic.rbt");
+ *     router.addMiddleware(captureTraffic({.log = log}));
+ */
+Middleware captureTraffic(TrafficCaptureParams params);
+
+}   // namespace royalbed::server
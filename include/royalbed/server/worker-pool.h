@@ -0,0 +1,146 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nlohmann/json.hpp"
+
+#include "royalbed/common/completion-queue.h"
+#include "royalbed/server/detail/handler.h"
+#include "royalbed/server/error.h"
+#include "royalbed/server/http-status.h"
+#include "royalbed/server/request-context.h"
+
+namespace royalbed::server {
+
+struct WorkerPoolParams
+{
+    std::size_t threadCount{1};
+
+    // Tasks over the limit are rejected, the request is answered with "503 Service Unavailable"
+    std::size_t maxQueueSize{defaultMaxQueueSize};
+
+    static constexpr std::size_t defaultMaxQueueSize{1024};
+};
+
+struct WorkerPoolStats
+{
+    std::size_t queueDepth{};
+    std::size_t activeTasks{};
+    std::uint64_t completedTasks{};
+    std::uint64_t rejectedTasks{};
+
+    // Time the tasks spent in the queue before a worker took them
+    std::chrono::nanoseconds lastWaitTime{};
+    std::chrono::nanoseconds maxWaitTime{};
+    std::chrono::nanoseconds totalWaitTime{};
+};
+
+class WorkerPool;
+using WorkerPoolPtr = std::shared_ptr<WorkerPool>;
+
+/**
+ * Bounded pool of threads for CPU-heavy handlers, so they do not stall the IO context.
+ */
+class WorkerPool
+{
+public:
+    virtual ~WorkerPool() = default;
+
+    // Returns false if the queue is full
+    [[nodiscard]] virtual bool post(std::function<void()> task) = 0;
+
+    [[nodiscard]] virtual WorkerPoolStats stats() const = 0;
+
+    static WorkerPoolPtr create(WorkerPoolParams params);
+};
+
+namespace detail {
+
+template<typename R, typename... Args, typename Fn>
+auto makeOffloadedHandler(WorkerPoolPtr pool, Fn&& fn, std::function<R(Args...)>* /*signature*/)
+{
+    static_assert(!nhope::isFuture<R>, "offloaded handler must be synchronous");
+    static_assert((!std::is_same_v<std::decay_t<Args>, RequestContext> && ...),
+                  "offloaded handler must not access RequestContext, it belongs to the IO thread");
+
+    using Func = std::decay_t<Fn>;
+    // the arguments are taken by value: the task owns them, the session may be cancelled while it is in the queue
+    return [pool = std::move(pool), fn = std::make_shared<Func>(std::forward<Fn>(fn))](
+             RequestContext& ctx, std::decay_t<Args>... args) -> nhope::Future<void> {
+        auto promise = std::make_shared<nhope::Promise<void>>();
+        auto future = promise->future();
+
+        auto taskArgs = std::make_shared<std::tuple<std::decay_t<Args>...>>(std::move(args)...);
+        const bool posted = pool->post([fn, promise, taskArgs, completions = ctx.completions,
+                                        guard = ctx.completionOwner.guard(), aoCtxRef = nhope::AOContextRef(ctx.aoCtx),
+                                        &ctx]() mutable {
+            std::function<void()> settle;
+            try {
+                if constexpr (std::is_void_v<R>) {
+                    std::apply(*fn, std::move(*taskArgs));
+                    settle = [promise] {
+                        promise->setValue();
+                    };
+                } else {
+                    // the result is serialized by the worker too, the IO context only moves it into the response.
+                    // The completion is not run after the session is gone, so the context is still alive
+                    auto content = nlohmann::to_string(nlohmann::json(std::apply(*fn, std::move(*taskArgs))));
+                    settle = [promise, &ctx, content = std::move(content)]() mutable {
+                        addContent(ctx, std::move(content));
+                        promise->setValue();
+                    };
+                }
+            } catch (...) {
+                settle = [promise, ex = std::current_exception()] {
+                    promise->setException(ex);
+                };
+            }
+
+            if (completions != nullptr) {
+                completions->post(guard, std::move(settle));
+            } else {
+                aoCtxRef.exec(std::move(settle));
+            }
+        });
+        if (!posted) {
+            ctx.error = HttpError(HttpStatus::ServiceUnavailable, "worker pool queue is full");
+            return nhope::makeReadyFuture();
+        }
+        return future;
+    };
+}
+
+}   // namespace detail
+
+/**
+ * Runs a high-level handler on the worker pool:
+ *
+ *     router.get("/report/:id", offload(pool, [](Param<"id", int> id) {
+ *         return buildReport(id.get());
+ *     }));
+ *
+ * Parameters and body are extracted in the IO context. The result is sent back to it through
+ * RequestContext::completions, the queue shared by the sessions of the server IO context, so the results
+ * of different sessions share the wakeups (or with a plain AOContext::exec if there is no completion queue).
+ * The router and the session continue right in its drain.
+ * A full queue answers "503 Service Unavailable" through RequestContext::error.
+ * The handler must be synchronous and must not take RequestContext.
+ */
+template<typename Fn>
+auto offload(WorkerPoolPtr pool, Fn&& fn)
+{
+    using Signature = decltype(std::function(fn));
+    return detail::makeOffloadedHandler(std::move(pool), std::forward<Fn>(fn), static_cast<Signature*>(nullptr));
+}
+
+}   // namespace royalbed::server
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+#include "royalbed/client/circuit-breaker.h"
+
+namespace royalbed::client {
+
+CircuitOpenError::CircuitOpenError()
+  : std::runtime_error("circuit breaker is open")
+{}
+
+CircuitBreaker::CircuitBreaker(CircuitBreakerParams params)
+  : m_params(std::move(params))
+{
+    m_params.windowSize = std::max<std::size_t>(m_params.windowSize, 1);
+    m_params.minimumCalls = std::clamp<std::size_t>(m_params.minimumCalls, 1, m_params.windowSize);
+    m_params.halfOpenCalls = std::max<std::size_t>(m_params.halfOpenCalls, 1);
+    m_window.reserve(m_params.windowSize);
+}
+
+CircuitBreaker::Permit CircuitBreaker::acquire()
+{
+    if (m_state == CircuitState::Open && Clock::now() - m_openedAt >= m_params.openDuration) {
+        transition(CircuitState::HalfOpen);
+    }
+
+    if (m_state == CircuitState::Open ||
+        (m_state == CircuitState::HalfOpen && m_trialsStarted == m_params.halfOpenCalls)) {
+        ++m_rejected;
+        throw CircuitOpenError();
+    }
+    if (m_state == CircuitState::HalfOpen) {
+        ++m_trialsStarted;
+    }
+    return {.generation = m_generation, .started = Clock::now()};
+}
+
+void CircuitBreaker::release(const Permit& permit, bool failed)
+{
+    if (permit.generation != m_generation) {
+        return;
+    }
+    const Outcome outcome{
+      .failed = failed,
+      .slow = Clock::now() - permit.started >= m_params.slowCallDuration,
+    };
+
+    if (m_state == CircuitState::HalfOpen) {
+        if (outcome.failed || outcome.slow) {
+            transition(CircuitState::Open);
+        } else if (++m_trialsSucceeded == m_params.halfOpenCalls) {
+            transition(CircuitState::Closed);
+        }
+        return;
+    }
+
+    record(outcome);
+    if (m_window.size() < m_params.minimumCalls) {
+        return;
+    }
+    const auto calls = static_cast<double>(m_window.size());
+    if (static_cast<double>(m_failed) >= m_params.failureRateThreshold * calls ||
+        static_cast<double>(m_slow) >= m_params.slowCallRateThreshold * calls) {
+        transition(CircuitState::Open);
+    }
+}
+
+CircuitBreakerMetrics CircuitBreaker::metrics() const
+{
+    return {
+      .state = m_state,
+      .calls = m_window.size(),
+      .failedCalls = m_failed,
+      .slowCalls = m_slow,
+      .rejectedCalls = m_rejected,
+      .openCount = m_openCount,
+    };
+}
+
+void CircuitBreaker::record(Outcome outcome)
+{
+    if (m_window.size() < m_params.windowSize) {
+        m_window.push_back(outcome);
+    } else {
+        auto& oldest = m_window[m_next];
+        m_failed -= oldest.failed ? 1 : 0;
+        m_slow -= oldest.slow ? 1 : 0;
+        oldest = outcome;
+    }
+    m_next = (m_next + 1) % m_params.windowSize;
+    m_failed += outcome.failed ? 1 : 0;
+    m_slow += outcome.slow ? 1 : 0;
+}
+
+void CircuitBreaker::transition(CircuitState state)
+{
+    m_state = state;
+    ++m_generation;
+
+    m_window.clear();
+    m_next = 0;
+    m_failed = 0;
+    m_slow = 0;
+    m_trialsStarted = 0;
+    m_trialsSucceeded = 0;
+
+    if (state == CircuitState::Open) {
+        m_openedAt = Clock::now();
+        ++m_openCount;
+    }
+}
+
+}   // namespace royalbed::client
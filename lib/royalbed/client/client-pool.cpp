@@ -0,0 +1,720 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "fmt/core.h"
+
+#include "nhope/async/ao-context-error.h"
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nhope/async/timer.h"
+#include "nhope/io/io-device.h"
+#include "nhope/io/pushback-reader.h"
+#include "nhope/io/tcp.h"
+
+#include "royalbed/client/client-pool.h"
+#include "royalbed/client/detail/receive-response.h"
+#include "royalbed/client/detail/send-request.h"
+#include "royalbed/common/coro.h"
+
+namespace royalbed::client {
+
+namespace {
+
+using namespace std::literals;
+using Clock = std::chrono::steady_clock;
+
+struct Connection;
+struct Exchange;
+
+using ExchangePtr = std::shared_ptr<Exchange>;
+
+// One call of openRequest, answered by the first response to any of its exchanges
+struct Call
+{
+    nhope::Promise<Response> promise{};
+    Clock::time_point started{Clock::now()};
+
+    // The original request and its hedged copy
+    std::vector<std::weak_ptr<Exchange>> exchanges{};
+
+    // sendRequest: the timeout covers reading the response body too
+    bool readsBody{false};
+    bool timedOut{false};
+
+    // The connection the body of the response is being read from
+    std::weak_ptr<Connection> bodyConn{};
+};
+
+using CallPtr = std::shared_ptr<Call>;
+
+struct Exchange
+{
+    Request request;
+    CallPtr call;
+
+    // The connection the request is given to, none while it waits
+    std::weak_ptr<Connection> conn{};
+
+    // Idempotent without a body: may share the connection with other requests and be sent again
+    bool pipelined{false};
+    bool retried{false};
+
+    // Failed or answered
+    bool finished{false};
+};
+
+struct Host;
+
+struct Connection
+{
+    explicit Connection(Host& h)
+      : host(h)
+    {}
+
+    [[nodiscard]] std::size_t load() const noexcept
+    {
+        return toWrite.size() + toRead.size();
+    }
+
+    [[nodiscard]] bool idle() const noexcept
+    {
+        return socket != nullptr && load() == 0;
+    }
+
+    Host& host;
+    nhope::TcpSocketPtr socket;
+    nhope::PushbackReaderPtr reader;
+
+    std::deque<ExchangePtr> toWrite;
+
+    // Written or being written, in the order of the responses
+    std::deque<ExchangePtr> toRead;
+
+    Clock::time_point idleSince{};
+
+    // Carries a request that can not be pipelined
+    bool exclusive{false};
+
+    bool writing{false};
+    bool reading{false};
+    bool closed{false};
+};
+
+using ConnectionPtr = std::shared_ptr<Connection>;
+
+struct Host
+{
+    std::string name;
+    std::uint16_t port{};
+
+    // Connecting, busy and idle
+    std::vector<ConnectionPtr> connections;
+
+    // Wait for a connection, in the order of the requests
+    std::deque<ExchangePtr> waiting;
+
+    // See ClientPoolParams::retryBudgetRatio
+    double retryTokens{};
+
+    // The latest response times, a ring buffer
+    std::vector<Clock::duration> latencies;
+    std::size_t nextLatency{};
+
+    // ClientPoolParams::hedgePercentile of the latencies
+    std::optional<Clock::duration> hedgeDelay;
+};
+
+// The response times kept per host and how many of them are needed to hedge
+constexpr std::size_t latencySamples = 128;
+constexpr std::size_t hedgeDelayUpdate = 16;
+
+std::exception_ptr timedOut()
+{
+    return std::make_exception_ptr(std::system_error(std::make_error_code(std::errc::timed_out)));
+}
+
+bool isIdempotent(const Request& request)
+{
+    static constexpr std::array methods{"GET"sv, "HEAD"sv, "OPTIONS"sv, "TRACE"sv, "PUT"sv, "DELETE"sv};
+    return std::find(methods.begin(), methods.end(), request.method) != methods.end();
+}
+
+// Passes the body through and reports when it is read to the end, the connection is read further only then
+class PooledBody final : public nhope::Reader
+{
+public:
+    PooledBody(ConnectionPtr conn, nhope::ReaderPtr body, nhope::Promise<void>&& done)
+      : m_conn(std::move(conn))
+      , m_body(std::move(body))
+      , m_done(std::move(done))
+    {}
+
+    ~PooledBody() override
+    {
+        // the rest of the body is in the socket, the connection can not be reused
+        finish(std::make_exception_ptr(nhope::AsyncOperationWasCancelled()));
+    }
+
+    void read(gsl::span<std::uint8_t> buf, nhope::IOHandler handler) override
+    {
+        m_body->read(buf, [this, handler = std::move(handler)](std::exception_ptr err, std::size_t n) {
+            if (err) {
+                finish(err);
+            } else if (n == 0) {
+                finish(nullptr);
+            }
+            handler(std::move(err), n);
+        });
+    }
+
+private:
+    void finish(std::exception_ptr err)
+    {
+        if (m_done.satisfied()) {
+            return;
+        }
+        if (err) {
+            m_done.setException(std::move(err));
+        } else {
+            m_done.setValue();
+        }
+    }
+
+    ConnectionPtr m_conn;
+    nhope::ReaderPtr m_body;
+    nhope::Promise<void> m_done;
+};
+
+// A response to HEAD, 204 and 304 or with "Content-Length: 0" leaves nothing in the socket
+bool hasBody(const Request& request, const Response& response)
+{
+    constexpr int noContent = 204;
+    constexpr int notModified = 304;
+    if (response.body == nullptr || request.method == "HEAD" || response.status == noContent ||
+        response.status == notModified) {
+        return false;
+    }
+    const auto it = response.headers.find("Content-Length");
+    return it == response.headers.end() || it->second != "0";
+}
+
+bool keepsConnection(const Response& response)
+{
+    const auto it = response.headers.find("Connection");
+    return it == response.headers.end() || it->second != "close";
+}
+
+class ClientPoolImpl final : public ClientPool
+{
+public:
+    ClientPoolImpl(nhope::AOContext& parent, ClientPoolParams params)
+      : m_params(std::move(params))
+      , m_aoCtx(parent)
+    {
+        if (!m_params.connect) {
+            m_params.connect = [](nhope::AOContext& aoCtx, const std::string& host, std::uint16_t port) {
+                return nhope::TcpSocket::connect(aoCtx, host, port);
+            };
+        }
+        m_params.maxConnectionsPerHost = std::max<std::size_t>(m_params.maxConnectionsPerHost, 1);
+        m_params.pipelineDepth = std::max<std::size_t>(m_params.pipelineDepth, 1);
+        m_params.retryBudgetBurst = std::max(m_params.retryBudgetBurst, 0.0);
+    }
+
+    ~ClientPoolImpl() override
+    {
+        m_aoCtx.close();
+    }
+
+    nhope::Future<Response> sendRequest(Request&& request) override
+    {
+        auto call = std::make_shared<Call>();
+        call->readsBody = true;
+        return open(std::move(request), call).then(m_aoCtx, [&aoCtx = m_aoCtx, call](auto resp) {
+            return detail::readResponseBody(aoCtx, std::move(resp)).fail([call](std::exception_ptr e) -> Response {
+                // the connection has been closed by the timeout
+                std::rethrow_exception(call->timedOut ? timedOut() : std::move(e));
+            });
+        });
+    }
+
+    nhope::Future<Response> openRequest(Request&& request) override
+    {
+        return open(std::move(request), std::make_shared<Call>());
+    }
+
+    [[nodiscard]] std::size_t idleConnectionCount() const override
+    {
+        std::size_t count = 0;
+        for (const auto& [key, host] : m_hosts) {
+            count += static_cast<std::size_t>(std::count_if(host.connections.begin(), host.connections.end(),
+                                                            [](const ConnectionPtr& conn) {
+                                                                return conn->idle();
+                                                            }));
+        }
+        return count;
+    }
+
+private:
+    nhope::Future<Response> open(Request&& request, const CallPtr& call)
+    {
+        detail::setRequestHost(request);
+        auto& host = this->host(request.uri.host, request.uri.port);
+        host.retryTokens = std::min(host.retryTokens + m_params.retryBudgetRatio, m_params.retryBudgetBurst);
+
+        auto exchange = makeExchange(std::move(request), call);
+        auto future = call->promise.future();
+
+        // the waiting requests are not overtaken
+        if (!host.waiting.empty() || !place(host, exchange)) {
+            host.waiting.push_back(exchange);
+        }
+        if (m_params.requestTimeout > 0ns) {
+            scheduleTimeout(call);
+        }
+        if (exchange->pipelined && host.hedgeDelay) {
+            scheduleHedge(exchange, *host.hedgeDelay);
+        }
+        return future;
+    }
+
+    Host& host(const std::string& name, std::uint16_t port)
+    {
+        auto [it, inserted] = m_hosts.try_emplace(fmt::format("{}:{}", name, port));
+        if (inserted) {
+            it->second.name = name;
+            it->second.port = port;
+            it->second.retryTokens = m_params.retryBudgetBurst;
+        }
+        return it->second;
+    }
+
+    static ExchangePtr makeExchange(Request&& request, const CallPtr& call)
+    {
+        auto exchange = std::make_shared<Exchange>(Exchange{.request = std::move(request), .call = call});
+        exchange->pipelined = exchange->request.body == nullptr && isIdempotent(exchange->request);
+        call->exchanges.push_back(exchange);
+        return exchange;
+    }
+
+    // Gives the request to a connection if there is a free place
+    bool place(Host& host, const ExchangePtr& exchange, const Connection* avoid = nullptr)
+    {
+        auto conn = pick(host, *exchange, avoid);
+        const bool opened = conn == nullptr;
+        if (opened) {
+            if (host.connections.size() >= m_params.maxConnectionsPerHost) {
+                return false;
+            }
+            conn = host.connections.emplace_back(std::make_shared<Connection>(host));
+        }
+
+        conn->exclusive = conn->exclusive || !exchange->pipelined;
+        conn->toWrite.push_back(exchange);
+        exchange->conn = conn;
+        if (opened) {
+            connect(m_aoCtx, conn);
+        } else if (conn->socket != nullptr && !conn->writing) {
+            write(m_aoCtx, conn);
+        }
+        return true;
+    }
+
+    // The last released idle connection, otherwise the least loaded one with a place in the pipeline
+    ConnectionPtr pick(Host& host, const Exchange& exchange, const Connection* avoid)
+    {
+        const auto now = Clock::now();
+        std::vector<ConnectionPtr> expired;
+        ConnectionPtr idle;
+        ConnectionPtr pipeline;
+        for (const auto& conn : host.connections) {
+            if (conn.get() == avoid) {
+                continue;
+            }
+            if (conn->idle()) {
+                if (now - conn->idleSince >= m_params.idleTimeout) {
+                    expired.push_back(conn);
+                } else if (idle == nullptr || conn->idleSince > idle->idleSince) {
+                    idle = conn;
+                }
+            } else if (exchange.pipelined && !conn->exclusive && conn->load() < m_params.pipelineDepth &&
+                       (pipeline == nullptr || conn->load() < pipeline->load())) {
+                pipeline = conn;
+            }
+        }
+
+        for (const auto& conn : expired) {
+            retire(conn);
+        }
+        return idle != nullptr ? idle : pipeline;
+    }
+
+    void serveWaiting(Host& host)
+    {
+        while (!host.waiting.empty()) {
+            // a failed connection may serve the rest while the request is placed
+            auto exchange = std::move(host.waiting.front());
+            host.waiting.pop_front();
+            if (exchange->call->promise.satisfied()) {
+                continue;
+            }
+            if (!place(host, exchange)) {
+                host.waiting.push_front(std::move(exchange));
+                return;
+            }
+        }
+    }
+
+    nhope::Future<void> connect(nhope::AOContext& aoCtx, ConnectionPtr conn)
+    {
+        if (m_params.connectTimeout > 0ns) {
+            nhope::setTimeout(aoCtx, m_params.connectTimeout, [this, conn](auto) {
+                if (conn->socket == nullptr) {
+                    fail(conn, timedOut());
+                }
+            });
+        }
+
+        std::exception_ptr error;
+        nhope::TcpSocketPtr socket;
+        try {
+            socket = co_await m_params.connect(aoCtx, conn->host.name, conn->host.port);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        if (conn->closed) {
+            co_return;
+        }
+        if (error) {
+            fail(conn, error);
+            co_return;
+        }
+        conn->reader = nhope::PushbackReader::create(aoCtx, *socket);
+        conn->socket = std::move(socket);
+        if (!conn->toWrite.empty()) {
+            write(aoCtx, conn);
+        }
+    }
+
+    // Nothing has been sent, there is no point to send it again
+    void fail(const ConnectionPtr& conn, std::exception_ptr error)
+    {
+        for (auto& exchange : conn->toWrite) {
+            exchange->retried = true;
+        }
+        close(conn, std::move(error));
+    }
+
+    // The pipelined requests in a row are written at once
+    nhope::Future<void> write(nhope::AOContext& aoCtx, ConnectionPtr conn)
+    {
+        conn->writing = true;
+        std::exception_ptr error;
+        try {
+            while (!conn->closed && !conn->toWrite.empty()) {
+                if (!conn->toWrite.front()->pipelined) {
+                    auto exchange = std::move(conn->toWrite.front());
+                    conn->toWrite.pop_front();
+                    if (exchange->call->promise.satisfied()) {
+                        continue;
+                    }
+                    conn->toRead.push_back(exchange);
+                    startReading(aoCtx, conn);
+                    co_await detail::sendRequest(aoCtx, std::move(exchange->request), *conn->socket);
+                    continue;
+                }
+
+                std::string batch;
+                while (!conn->toWrite.empty() && conn->toWrite.front()->pipelined) {
+                    auto exchange = std::move(conn->toWrite.front());
+                    conn->toWrite.pop_front();
+                    // answered over another connection or timed out
+                    if (exchange->call->promise.satisfied()) {
+                        continue;
+                    }
+                    detail::writeRequestHead(exchange->request, batch);
+                    conn->toRead.push_back(std::move(exchange));
+                }
+                if (batch.empty()) {
+                    continue;
+                }
+                startReading(aoCtx, conn);
+                co_await nhope::write(*conn->socket, std::move(batch));
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        conn->writing = false;
+        if (error) {
+            close(conn, error);
+        }
+    }
+
+    // The responses are matched to the requests in order
+    void startReading(nhope::AOContext& aoCtx, const ConnectionPtr& conn)
+    {
+        if (!conn->reading) {
+            read(aoCtx, conn);
+        }
+    }
+
+    nhope::Future<void> read(nhope::AOContext& aoCtx, ConnectionPtr conn)
+    {
+        conn->reading = true;
+
+        std::exception_ptr error;
+        bool keepAlive = true;
+        try {
+            while (keepAlive && !conn->closed && !conn->toRead.empty()) {
+                auto response = co_await detail::receiveResponse(aoCtx, *conn->reader);
+                keepAlive = keepsConnection(response);
+
+                auto exchange = std::move(conn->toRead.front());
+                conn->toRead.pop_front();
+                exchange->finished = true;
+                auto& call = *exchange->call;
+                const bool body = hasBody(exchange->request, response);
+                if (call.promise.satisfied()) {
+                    // the hedged copy has won, the rest of the body is not needed
+                    keepAlive = keepAlive && !body;
+                    continue;
+                }
+
+                recordLatency(conn->host, Clock::now() - call.started);
+                if (!body) {
+                    call.promise.setValue(std::move(response));
+                } else {
+                    // the next response follows the body, so the caller reads it before the connection goes on
+                    nhope::Promise<void> bodyRead;
+                    auto bodyReadFuture = bodyRead.future();
+                    response.body = std::make_unique<PooledBody>(conn, std::move(response.body), std::move(bodyRead));
+                    call.bodyConn = conn;
+                    call.promise.setValue(std::move(response));
+                    co_await std::move(bodyReadFuture);
+                    call.bodyConn.reset();
+                }
+
+                if (keepAlive && conn->load() < m_params.pipelineDepth) {
+                    serveWaiting(conn->host);
+                }
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        conn->reading = false;
+        if (conn->closed) {
+            co_return;
+        }
+        if (error || !keepAlive) {
+            // the requests pipelined after "Connection: close" have not been processed
+            close(conn, error);
+            co_return;
+        }
+        if (conn->load() == 0) {
+            conn->exclusive = false;
+            conn->idleSince = Clock::now();
+            scheduleSweep();
+            serveWaiting(conn->host);
+        }
+    }
+
+    // Removes the connection from the pool, the running reads and writes are cancelled
+    void retire(const ConnectionPtr& conn)
+    {
+        conn->closed = true;
+        std::erase(conn->host.connections, conn);
+        if (conn->socket != nullptr) {
+            conn->socket->ioCancel();
+        }
+    }
+
+    // The requests without a response go to other connections once, the rest fail with the error
+    void close(const ConnectionPtr& conn, std::exception_ptr error)
+    {
+        if (conn->closed) {
+            return;
+        }
+        retire(conn);
+
+        if (error == nullptr) {
+            error = std::make_exception_ptr(std::system_error(std::make_error_code(std::errc::connection_aborted)));
+        }
+        auto& host = conn->host;
+        std::vector<ExchangePtr> retry;
+        for (auto* queue : {&conn->toRead, &conn->toWrite}) {
+            for (auto& exchange : *queue) {
+                if (exchange->call->promise.satisfied()) {
+                    continue;
+                }
+                if (exchange->pipelined && !exchange->retried && host.retryTokens >= 1) {
+                    host.retryTokens -= 1;
+                    exchange->retried = true;
+                    exchange->conn.reset();
+                    retry.push_back(std::move(exchange));
+                } else {
+                    finish(*exchange, error);
+                }
+            }
+            queue->clear();
+        }
+
+        host.waiting.insert(host.waiting.begin(), retry.begin(), retry.end());
+        serveWaiting(host);
+    }
+
+    // Fails the call unless its other exchange may still get a response
+    static void finish(Exchange& exchange, const std::exception_ptr& error)
+    {
+        exchange.finished = true;
+        auto& call = *exchange.call;
+        const bool pending = std::any_of(call.exchanges.begin(), call.exchanges.end(), [](const auto& weak) {
+            const auto other = weak.lock();
+            return other != nullptr && !other->finished;
+        });
+        if (!pending && !call.promise.satisfied()) {
+            call.promise.setException(error);
+        }
+    }
+
+    void scheduleTimeout(const CallPtr& call)
+    {
+        nhope::setTimeout(m_aoCtx, m_params.requestTimeout, [this, call](auto) {
+            if (call->promise.satisfied()) {
+                // sendRequest is still reading the body: its connection is closed, so the read fails
+                if (const auto conn = call->bodyConn.lock(); call->readsBody && conn != nullptr) {
+                    call->timedOut = true;
+                    close(conn, timedOut());
+                }
+                return;
+            }
+            call->promise.setException(timedOut());
+            for (const auto& weak : call->exchanges) {
+                if (auto exchange = weak.lock()) {
+                    abandon(exchange);
+                }
+            }
+        });
+    }
+
+    // The connection is closed if the response is on the way, otherwise the request is just dropped
+    void abandon(const ExchangePtr& exchange)
+    {
+        exchange->finished = true;
+        const auto conn = exchange->conn.lock();
+        if (conn == nullptr) {
+            std::erase(host(exchange->request.uri.host, exchange->request.uri.port).waiting, exchange);
+        } else if (!conn->closed) {
+            if (std::find(conn->toRead.begin(), conn->toRead.end(), exchange) != conn->toRead.end()) {
+                close(conn, nullptr);
+            } else {
+                std::erase(conn->toWrite, exchange);
+            }
+        }
+    }
+
+    // A copy of the request that is still without a response goes to another connection
+    void scheduleHedge(const ExchangePtr& exchange, Clock::duration delay)
+    {
+        nhope::setTimeout(m_aoCtx, delay, [this, weak = std::weak_ptr(exchange)](auto) {
+            const auto exchange = weak.lock();
+            if (exchange == nullptr || exchange->finished || exchange->call->promise.satisfied()) {
+                return;
+            }
+            // a copy of a waiting request would wait too
+            const auto conn = exchange->conn.lock();
+            if (conn == nullptr || conn->closed || conn->host.retryTokens < 1) {
+                return;
+            }
+
+            const auto& request = exchange->request;
+            Request copy{.method = request.method, .uri = request.uri, .headers = request.headers, .body = nullptr};
+            auto hedged = makeExchange(std::move(copy), exchange->call);
+            hedged->retried = true;
+            if (place(conn->host, hedged, conn.get())) {
+                conn->host.retryTokens -= 1;
+            }
+        });
+    }
+
+    void recordLatency(Host& host, Clock::duration latency)
+    {
+        if (m_params.hedgePercentile <= 0) {
+            return;
+        }
+        if (host.latencies.size() < latencySamples) {
+            host.latencies.push_back(latency);
+        } else {
+            host.latencies[host.nextLatency] = latency;
+        }
+        host.nextLatency = (host.nextLatency + 1) % latencySamples;
+        if (host.nextLatency % hedgeDelayUpdate != 0) {
+            return;
+        }
+
+        auto sorted = host.latencies;
+        const auto rank = static_cast<std::size_t>(m_params.hedgePercentile / 100 * double(sorted.size() - 1));
+        const auto nth = sorted.begin() + static_cast<std::ptrdiff_t>(std::min(rank, sorted.size() - 1));
+        std::nth_element(sorted.begin(), nth, sorted.end());
+        host.hedgeDelay = *nth;
+    }
+
+    // Closes the expired idle connections while there are any
+    void scheduleSweep()
+    {
+        if (m_sweepScheduled) {
+            return;
+        }
+        m_sweepScheduled = true;
+        nhope::setTimeout(m_aoCtx, m_params.idleTimeout, [this](auto) {
+            m_sweepScheduled = false;
+            const auto now = Clock::now();
+            std::vector<ConnectionPtr> expired;
+            bool idle = false;
+            for (auto& [key, host] : m_hosts) {
+                for (const auto& conn : host.connections) {
+                    if (conn->idle() && now - conn->idleSince >= m_params.idleTimeout) {
+                        expired.push_back(conn);
+                    } else {
+                        idle = idle || conn->idle();
+                    }
+                }
+            }
+            for (const auto& conn : expired) {
+                retire(conn);
+            }
+            if (idle) {
+                scheduleSweep();
+            }
+        });
+    }
+
+    ClientPoolParams m_params;
+    std::map<std::string, Host> m_hosts;
+    bool m_sweepScheduled{false};
+
+    nhope::AOContext m_aoCtx;
+};
+
+}   // namespace
+
+ClientPoolPtr ClientPool::create(nhope::AOContext& aoCtx, ClientPoolParams params)
+{
+    return std::make_shared<ClientPoolImpl>(aoCtx, std::move(params));
+}
+
+}   // namespace royalbed::client
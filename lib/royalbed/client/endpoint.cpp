@@ -0,0 +1,217 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+
+#include "royalbed/client/endpoint.h"
+#include "royalbed/client/detail/send-request.h"
+#include "royalbed/common/coro.h"
+
+namespace royalbed::client {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::uint16_t defaultPort = 80;
+
+struct Replica
+{
+    Uri target;
+    std::size_t inFlight{};
+
+    // EWMA of the response time, nanoseconds
+    double latency{};
+
+    std::size_t failures{};
+    Clock::time_point ejectedUntil{};
+};
+
+bool isFailure(const Response& response)
+{
+    constexpr int serverErrors = 500;
+    return response.status >= serverErrors;
+}
+
+class EndpointImpl final : public Endpoint
+{
+public:
+    EndpointImpl(nhope::AOContext& parent, EndpointParams params)
+      : m_params(std::move(params))
+      , m_pool(ClientPool::create(parent, m_params.pool))
+      , m_random(std::random_device()())
+      , m_aoCtx(parent)
+    {
+        if (m_params.targets.empty()) {
+            throw std::invalid_argument("endpoint has no targets");
+        }
+        if (m_params.circuitBreaker) {
+            m_breaker.emplace(*m_params.circuitBreaker);
+        }
+        for (auto& target : m_params.targets) {
+            if (target.host.empty()) {
+                throw std::invalid_argument("endpoint target has no host");
+            }
+            if (target.port == 0) {
+                target.port = defaultPort;
+            }
+            m_replicas.push_back({.target = target});
+        }
+    }
+
+    ~EndpointImpl() override
+    {
+        m_aoCtx.close();
+    }
+
+    nhope::Future<Response> sendRequest(Request&& request) override
+    {
+        return openRequest(std::move(request)).then(m_aoCtx, [&aoCtx = m_aoCtx](auto resp) {
+            return detail::readResponseBody(aoCtx, std::move(resp));
+        });
+    }
+
+    nhope::Future<Response> openRequest(Request&& request) override
+    {
+        auto& replica = choose();
+        request.uri.host = replica.target.host;
+        request.uri.port = replica.target.port;
+        return send(m_aoCtx, replica, std::move(request));
+    }
+
+    [[nodiscard]] std::vector<ReplicaState> replicas() const override
+    {
+        const auto now = Clock::now();
+        std::vector<ReplicaState> states;
+        for (const auto& replica : m_replicas) {
+            states.push_back({
+              .target = replica.target,
+              .inFlight = replica.inFlight,
+              .latency = std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(replica.latency)),
+              .ejected = replica.ejectedUntil > now,
+            });
+        }
+        return states;
+    }
+
+    [[nodiscard]] std::optional<CircuitBreakerMetrics> circuitBreakerMetrics() const override
+    {
+        if (!m_breaker) {
+            return std::nullopt;
+        }
+        return m_breaker->metrics();
+    }
+
+private:
+    // The better of two random replicas that are not ejected
+    Replica& choose()
+    {
+        const auto now = Clock::now();
+        m_candidates.clear();
+        for (auto& replica : m_replicas) {
+            if (replica.ejectedUntil <= now) {
+                m_candidates.push_back(&replica);
+            }
+        }
+        if (m_candidates.empty()) {
+            for (auto& replica : m_replicas) {
+                m_candidates.push_back(&replica);
+            }
+        }
+        if (m_candidates.size() == 1) {
+            return *m_candidates.front();
+        }
+
+        std::uniform_int_distribution<std::size_t> first(0, m_candidates.size() - 1);
+        std::uniform_int_distribution<std::size_t> second(0, m_candidates.size() - 2);
+        const auto a = first(m_random);
+        auto b = second(m_random);
+        if (b >= a) {
+            ++b;
+        }
+        return cost(*m_candidates[a]) <= cost(*m_candidates[b]) ? *m_candidates[a] : *m_candidates[b];
+    }
+
+    static double cost(const Replica& replica)
+    {
+        // a replica without responses yet is still compared by the load
+        return (replica.latency + 1) * static_cast<double>(replica.inFlight + 1);
+    }
+
+    nhope::Future<Response> send(nhope::AOContext& /*aoCtx*/, Replica& replica, Request request)
+    {
+        // rejected before anything is sent
+        std::optional<CircuitBreaker::Permit> permit;
+        if (m_breaker) {
+            permit = m_breaker->acquire();
+        }
+
+        ++replica.inFlight;
+        const auto started = Clock::now();
+
+        std::exception_ptr error;
+        Response response;
+        try {
+            response = co_await m_pool->openRequest(std::move(request));
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        --replica.inFlight;
+        const bool failed = error != nullptr || isFailure(response);
+        report(replica, Clock::now() - started, failed);
+        if (permit) {
+            m_breaker->release(*permit, failed);
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        co_return response;
+    }
+
+    void report(Replica& replica, Clock::duration elapsed, bool failed)
+    {
+        const auto sample = std::chrono::duration<double, std::nano>(elapsed).count();
+        replica.latency =
+          replica.latency == 0 ? sample : replica.latency + m_params.latencyWeight * (sample - replica.latency);
+
+        if (!failed) {
+            replica.failures = 0;
+            return;
+        }
+        if (++replica.failures >= m_params.ejectAfterFailures) {
+            replica.failures = 0;
+            replica.ejectedUntil = Clock::now() + m_params.ejectionTime;
+
+            // back from the ejection the replica is probed again
+            replica.latency = 0;
+        }
+    }
+
+    EndpointParams m_params;
+    ClientPoolPtr m_pool;
+    std::vector<Replica> m_replicas;
+    std::vector<Replica*> m_candidates;
+    std::minstd_rand m_random;
+    std::optional<CircuitBreaker> m_breaker;
+
+    nhope::AOContext m_aoCtx;
+};
+
+}   // namespace
+
+EndpointPtr Endpoint::create(nhope::AOContext& aoCtx, EndpointParams params)
+{
+    return std::make_shared<EndpointImpl>(aoCtx, std::move(params));
+}
+
+}   // namespace royalbed::client
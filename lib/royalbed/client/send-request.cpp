@@ -1,6 +1,9 @@
 #include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <string_view>
+#include <utility>
 #include "3rdparty/llhttp/llhttp.h"
 
 #include "nhope/async/future.h"
@@ -206,9 +209,18 @@ private:
     Response m_response;
 };
 
+// origin-form, the authority goes to the Host header
 void writePath(const Request& req, std::string& out)
 {
-    out += req.uri.toString();
+    if (req.uri.scheme.empty() && req.uri.isRelative() && req.uri.fragment.empty()) {
+        out += req.uri.toString();
+        return;
+    }
+
+    common::Uri target;
+    target.path = req.uri.path;
+    target.query = req.uri.query;
+    out += target.toString();
 }
 
 void writeStartLine(const Request& req, std::string& out)
@@ -222,9 +234,7 @@ void writeStartLine(const Request& req, std::string& out)
 nhope::ReaderPtr makeRequestHeaderStream(nhope::AOContext& aoCtx, const Request& req)
 {
     std::string requestHeader;
-    writeStartLine(req, requestHeader);
-    writeHeaders(req.headers, requestHeader);
-    requestHeader += "\r\n"sv;
+    detail::writeRequestHead(req, requestHeader);
     return nhope::StringReader::create(aoCtx, std::move(requestHeader));
 }
 
@@ -242,6 +252,13 @@ nhope::ReaderPtr makeRequestStream(nhope::AOContext& aoCtx, Request&& request)
 }   // namespace
 namespace detail {
 
+void writeRequestHead(const Request& request, std::string& out)
+{
+    writeStartLine(request, out);
+    writeHeaders(request.headers, out);
+    out += "\r\n"sv;
+}
+
 nhope::Future<std::size_t> sendRequest(nhope::AOContext& aoCtx, Request&& request, nhope::Writter& device)
 {
     auto requestStream = makeRequestStream(aoCtx, std::move(request));
@@ -259,6 +276,20 @@ nhope::Future<common::Response> makeRequest(nhope::AOContext& aoCtx, Request&& r
     });
 }
 
+void setRequestHost(Request& request)
+{
+    if (request.uri.host.empty()) {
+        throw std::runtime_error("connection host is empty");
+    }
+    if (request.uri.port == 0) {
+        constexpr auto defaultPort = 80;
+        request.uri.port = defaultPort;
+    }
+    if (auto it = request.headers.find("Host"); it == request.headers.end()) {
+        request.headers["Host"] = request.uri.host + ":" + std::to_string(request.uri.port);
+    }
+}
+
 class ClientConnection : public std::enable_shared_from_this<ClientConnection>
 {
 public:
@@ -268,20 +299,7 @@ public:
       , m_ctx(aoCtx)
     {}
 
-    nhope::Future<common::Response> start(Request&& request)
-    {
-        return makeRequest(m_ctx, std::move(request), *m_socket, *m_reader)
-          .then(m_ctx, [self = shared_from_this()](auto r) mutable {
-              if (r.body != nullptr) {
-                  return nhope::readAll(*r.body).then(self->m_ctx, [self, resp = std::move(r)](auto data) mutable {
-                      resp.body = std::make_unique<royalbed::common::detail::StringReader>(
-                        std::string((const char*)data.data(), data.size()));
-                      return (std::move(resp));
-                  });
-              }
-              return nhope::makeReadyFuture<common::Response>(std::move(r));
-          });
-    }
+    nhope::Future<common::Response> start(Request&& request);
 
 private:
     std::unique_ptr<nhope::TcpSocket> m_socket;
@@ -289,21 +307,58 @@ private:
     nhope::AOContext m_ctx;
 };
 
-}   // namespace detail
+using ClientConnectionPtr = std::shared_ptr<ClientConnection>;
 
-nhope::Future<common::Response> sendRequest(nhope::AOContext& aoCtx, Request&& request)
+// Keeps the connection open while the body is read from it
+class ConnectionBody final : public nhope::Reader
 {
-    if (request.uri.host.empty()) {
-        throw std::runtime_error("connection host is empty");
-    }
-    if (request.uri.port == 0) {
-        constexpr auto defaultPort = 80;
-        request.uri.port = defaultPort;
+public:
+    ConnectionBody(ClientConnectionPtr connection, nhope::ReaderPtr body)
+      : m_connection(std::move(connection))
+      , m_body(std::move(body))
+    {}
+
+    void read(gsl::span<std::uint8_t> buf, nhope::IOHandler handler) override
+    {
+        m_body->read(buf, std::move(handler));
     }
-    if (auto it = request.headers.find("Host"); it == request.headers.end()) {
-        request.headers["Host"] = request.uri.host + ":" + std::to_string(request.uri.port);
+
+private:
+    ClientConnectionPtr m_connection;
+    nhope::ReaderPtr m_body;
+};
+
+nhope::Future<common::Response> ClientConnection::start(Request&& request)
+{
+    return makeRequest(m_ctx, std::move(request), *m_socket, *m_reader)
+      .then(m_ctx, [self = shared_from_this()](auto r) mutable {
+          if (r.body != nullptr) {
+              r.body = std::make_unique<ConnectionBody>(std::move(self), std::move(r.body));
+          }
+          return r;
+      });
+}
+
+nhope::Future<common::Response> readResponseBody(nhope::AOContext& aoCtx, common::Response&& response)
+{
+    if (response.body == nullptr) {
+        return nhope::makeReadyFuture<common::Response>(std::move(response));
     }
 
+    auto& body = *response.body;
+    return nhope::readAll(body).then(aoCtx, [resp = std::move(response)](auto data) mutable {
+        resp.body = std::make_unique<royalbed::common::detail::StringReader>(
+          std::string(reinterpret_cast<const char*>(data.data()), data.size()));   // NOLINT
+        return std::move(resp);
+    });
+}
+
+}   // namespace detail
+
+nhope::Future<common::Response> openRequest(nhope::AOContext& aoCtx, Request&& request)
+{
+    detail::setRequestHost(request);
+
     return nhope::TcpSocket::connect(aoCtx, request.uri.host, request.uri.port)
       .then(aoCtx, [&aoCtx, r = std::move(request)](auto s) mutable {
           auto c = std::make_shared<detail::ClientConnection>(aoCtx, std::move(s));
@@ -311,4 +366,11 @@ nhope::Future<common::Response> sendRequest(nhope::AOContext& aoCtx, Request&& r
       });
 }
 
+nhope::Future<common::Response> sendRequest(nhope::AOContext& aoCtx, Request&& request)
+{
+    return openRequest(aoCtx, std::move(request)).then(aoCtx, [&aoCtx](auto resp) {
+        return detail::readResponseBody(aoCtx, std::move(resp));
+    });
+}
+
 }   // namespace royalbed::client
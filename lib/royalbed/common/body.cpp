@@ -19,16 +19,26 @@ const auto content = "Content-Type"s;
 
 }   // namespace
 
-BodyType extractBodyType(const Headers& headers)
+HttpResult<BodyType> tryExtractBodyType(const Headers& headers)
 {
-    const auto& contentType = headers.at(content);
+    const auto it = headers.find(content);
+    if (it == headers.end()) {
+        return HttpError(HttpStatus::BadRequest, fmt::format("{0} header not found", content));
+    }
+
+    const auto& contentType = it->second;
     if (contentType == jsonContent) {
         return BodyType::Json;
     }
     if (contentType == plainContent) {
         return BodyType::Plain;
     }
-    throw HttpError(HttpStatus::BadRequest, fmt::format("{0} \"{1}\" not supported yet", content, contentType));
+    return HttpError(HttpStatus::BadRequest, fmt::format("{0} \"{1}\" not supported yet", content, contentType));
+}
+
+BodyType extractBodyType(const Headers& headers)
+{
+    return tryExtractBodyType(headers).value();
 }
 
 }   // namespace royalbed::common
@@ -0,0 +1,171 @@
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+
+#include "royalbed/common/completion-queue.h"
+
+namespace royalbed::common {
+
+namespace {
+
+// the queue whose drain runs on this thread
+thread_local const CompletionQueue* currentDrain = nullptr;
+
+}   // namespace
+
+CompletionQueue::CompletionQueue(Tag /*tag*/, nhope::AOContext& aoCtx)
+  : m_aoCtxRef(aoCtx)
+{}
+
+CompletionQueue::~CompletionQueue()
+{
+    for (auto* node = m_head.exchange(nullptr); node != nullptr;) {
+        delete std::exchange(node, node->next);
+    }
+}
+
+CompletionQueuePtr CompletionQueue::create(nhope::AOContext& aoCtx)
+{
+    return std::make_shared<CompletionQueue>(Tag{}, aoCtx);
+}
+
+void CompletionQueue::post(Completion completion)
+{
+    auto* node = new Node{std::move(completion), nullptr};
+    auto* head = m_head.load(std::memory_order_relaxed);
+    do {
+        node->next = head;
+    } while (!m_head.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+    m_posted.fetch_add(1, std::memory_order_relaxed);
+
+    if (head != nullptr) {
+        // the drain is already scheduled and has not taken the batch yet
+        return;
+    }
+
+    m_wakeups.fetch_add(1, std::memory_order_relaxed);
+    m_aoCtxRef.exec([self = shared_from_this()] {
+        self->drain();
+    });
+}
+
+void CompletionQueue::post(const CompletionGuard& guard, Completion completion)
+{
+    this->post(guarded(guard, std::move(completion)));
+}
+
+void CompletionQueue::dispatch(Completion work)
+{
+    if (this->draining()) {
+        work();
+        return;
+    }
+    m_aoCtxRef.exec(std::move(work));
+}
+
+void CompletionQueue::dispatch(const CompletionGuard& guard, Completion work)
+{
+    this->dispatch(guarded(guard, std::move(work)));
+}
+
+nhope::Future<void> CompletionQueue::continueWith(nhope::Future<void>&& future, Completion fn)
+{
+    return this->continueIn(std::nullopt, std::move(future), std::move(fn));
+}
+
+nhope::Future<void> CompletionQueue::continueWith(const CompletionGuard& guard, nhope::Future<void>&& future,
+                                                  Completion fn)
+{
+    return this->continueIn(guard, std::move(future), std::move(fn));
+}
+
+CompletionQueue::Completion CompletionQueue::guarded(const std::optional<CompletionGuard>& guard,
+                                                     Completion completion)
+{
+    if (!guard.has_value()) {
+        return completion;
+    }
+    return [guard = *guard, completion = std::move(completion)] {
+        if (!guard.expired()) {
+            completion();
+        }
+    };
+}
+
+nhope::Future<void> CompletionQueue::continueIn(std::optional<CompletionGuard> guard, nhope::Future<void>&& future,
+                                                Completion fn)
+{
+    auto promise = std::make_shared<nhope::Promise<void>>();
+    auto result = promise->future();
+
+    std::move(future)
+      .then([self = shared_from_this(), guard, promise, fn = std::move(fn)] {
+          self->dispatch(guarded(guard, [promise, fn] {
+              try {
+                  fn();
+                  promise->setValue();
+              } catch (...) {
+                  promise->setException(std::current_exception());
+              }
+          }));
+      })
+      .fail([self = shared_from_this(), guard, promise](std::exception_ptr ex) {
+          self->dispatch(guarded(guard, [promise, ex] {
+              promise->setException(ex);
+          }));
+      });
+    return result;
+}
+
+bool CompletionQueue::draining() const noexcept
+{
+    return currentDrain == this;
+}
+
+std::uint64_t CompletionQueue::postedCount() const noexcept
+{
+    return m_posted.load(std::memory_order_relaxed);
+}
+
+std::uint64_t CompletionQueue::wakeupCount() const noexcept
+{
+    return m_wakeups.load(std::memory_order_relaxed);
+}
+
+void CompletionQueue::drain()
+{
+    // the nodes are pushed to the head, restore the posting order
+    Node* batch = nullptr;
+    for (auto* node = m_head.exchange(nullptr, std::memory_order_acquire); node != nullptr;) {
+        auto* next = node->next;
+        node->next = batch;
+        batch = node;
+        node = next;
+    }
+
+    const auto* prevDrain = std::exchange(currentDrain, this);
+    std::exception_ptr error;
+    while (batch != nullptr) {
+        const std::unique_ptr<Node> node(std::exchange(batch, batch->next));
+        try {
+            node->completion();
+        } catch (...) {
+            if (error == nullptr) {
+                error = std::current_exception();
+            }
+        }
+    }
+    currentDrain = prevDrain;
+
+    if (error != nullptr) {
+        std::rethrow_exception(error);
+    }
+}
+
+}   // namespace royalbed::common
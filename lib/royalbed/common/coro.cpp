@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+
+#include "royalbed/common/coro.h"
+
+namespace royalbed::common {
+
+namespace {
+
+thread_local FramePoolPtr currentPool;   // NOLINT
+
+// The frame keeps the pool alive, the owner of the pool may go away before a cancelled coroutine.
+// The pool is not thread-safe, a frame destroyed by another thread goes to the global heap
+struct FrameHeader
+{
+    FramePoolPtr pool;
+    std::thread::id thread;
+};
+
+constexpr std::size_t frameHeaderSize =
+  (sizeof(FrameHeader) + __STDCPP_DEFAULT_NEW_ALIGNMENT__ - 1) / __STDCPP_DEFAULT_NEW_ALIGNMENT__
+  * __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+}   // namespace
+
+FramePool::FramePool()
+{
+    // deallocate() must not throw
+    m_free.reserve(maxCachedFrames);
+}
+
+FramePool::~FramePool()
+{
+    for (const auto& block : m_free) {
+        ::operator delete(block.ptr, block.size);
+    }
+}
+
+void* FramePool::allocate(std::size_t size)
+{
+    const auto it = std::find_if(m_free.begin(), m_free.end(), [size](const Block& block) {
+        return block.size == size;
+    });
+    if (it == m_free.end()) {
+        return ::operator new(size);
+    }
+
+    auto* ptr = it->ptr;
+    m_free.erase(it);
+    return ptr;
+}
+
+void FramePool::deallocate(void* ptr, std::size_t size) noexcept
+{
+    if (m_free.size() >= maxCachedFrames) {
+        ::operator delete(ptr, size);
+        return;
+    }
+    m_free.push_back({ptr, size});
+}
+
+FramePoolScope::FramePoolScope(FramePoolPtr pool) noexcept
+  : m_prev(std::exchange(currentPool, std::move(pool)))
+{}
+
+FramePoolScope::~FramePoolScope()
+{
+    currentPool = std::move(m_prev);
+}
+
+namespace detail {
+
+void* allocateFrame(std::size_t size)
+{
+    auto pool = currentPool;
+    const auto total = frameHeaderSize + size;
+    auto* mem = static_cast<std::byte*>(pool != nullptr ? pool->allocate(total) : ::operator new(total));
+    new (mem) FrameHeader{std::move(pool), std::this_thread::get_id()};
+    return mem + frameHeaderSize;
+}
+
+void deallocateFrame(void* ptr, std::size_t size) noexcept
+{
+    auto* mem = static_cast<std::byte*>(ptr) - frameHeaderSize;
+    auto* header = std::launder(reinterpret_cast<FrameHeader*>(mem));   // NOLINT
+    auto pool = std::move(header->pool);
+    const bool ownThread = header->thread == std::this_thread::get_id();
+    header->~FrameHeader();
+
+    const auto total = frameHeaderSize + size;
+    if (pool != nullptr && ownThread) {
+        pool->deallocate(mem, total);
+    } else {
+        ::operator delete(mem, total);
+    }
+}
+
+}   // namespace detail
+
+}   // namespace royalbed::common
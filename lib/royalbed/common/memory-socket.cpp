@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "nhope/async/ao-context-error.h"
+#include "nhope/async/ao-context.h"
+#include "nhope/async/timer.h"
+#include "nhope/io/io-device.h"
+#include "nhope/io/sock-addr.h"
+#include "nhope/io/tcp.h"
+
+#include "royalbed/common/memory-socket.h"
+
+namespace royalbed::common {
+
+namespace detail {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * One direction of a memory connection. The writer and the reader may be in different threads.
+ */
+class MemoryPipe final
+{
+public:
+    using Waiter = std::function<void()>;
+
+    struct ReadResult
+    {
+        std::size_t size{};
+        bool eof{};
+
+        // The next segment is still in flight
+        std::optional<Clock::time_point> waitUntil{};
+    };
+
+    explicit MemoryPipe(const MemorySocketParams& params)
+      : m_params(params)
+    {}
+
+    // Returns the time the last byte leaves the writer
+    Clock::time_point push(std::span<const std::uint8_t> data)
+    {
+        Waiter waiter;
+        Clock::time_point departure = Clock::now();
+        {
+            std::scoped_lock lock(m_mutex);
+            if (m_readClosed || m_writeClosed) {
+                throw std::system_error(std::make_error_code(std::errc::broken_pipe));
+            }
+
+            const auto segmentSize = m_params.maxSegmentSize > 0 ? m_params.maxSegmentSize : data.size();
+            for (std::size_t pos = 0; pos < data.size(); pos += segmentSize) {
+                const auto segment = data.subspan(pos, std::min(segmentSize, data.size() - pos));
+                departure = std::max(departure, m_lastDeparture) + transmissionTime(segment.size());
+                m_lastDeparture = departure;
+                m_segments.push_back({
+                  .data = {segment.begin(), segment.end()},
+                  .deliverAt = departure + m_params.latency,
+                });
+            }
+            waiter = std::exchange(m_waiter, nullptr);
+        }
+
+        if (waiter) {
+            waiter();
+        }
+        return departure;
+    }
+
+    // The waiter is called once from the writer thread when there is something to read
+    ReadResult pop(std::span<std::uint8_t> buf, Waiter waiter)
+    {
+        std::scoped_lock lock(m_mutex);
+        if (m_segments.empty()) {
+            if (m_writeClosed) {
+                return {.eof = true};
+            }
+            m_waiter = std::move(waiter);
+            return {};
+        }
+
+        auto& segment = m_segments.front();
+        if (segment.deliverAt > Clock::now()) {
+            return {.waitUntil = segment.deliverAt};
+        }
+
+        const auto n = std::min(buf.size(), segment.data.size() - segment.offset);
+        std::memcpy(buf.data(), segment.data.data() + segment.offset, n);
+        segment.offset += n;
+        if (segment.offset == segment.data.size()) {
+            m_segments.pop_front();
+        }
+        return {.size = n};
+    }
+
+    void closeWrite()
+    {
+        Waiter waiter;
+        {
+            std::scoped_lock lock(m_mutex);
+            m_writeClosed = true;
+            waiter = std::exchange(m_waiter, nullptr);
+        }
+        if (waiter) {
+            waiter();
+        }
+    }
+
+    void closeRead()
+    {
+        std::scoped_lock lock(m_mutex);
+        m_readClosed = true;
+        m_segments.clear();
+        m_waiter = nullptr;
+    }
+
+private:
+    struct Segment
+    {
+        std::vector<std::uint8_t> data;
+        Clock::time_point deliverAt;
+        std::size_t offset{};
+    };
+
+    [[nodiscard]] Clock::duration transmissionTime(std::size_t size) const
+    {
+        if (m_params.bandwidth == 0) {
+            return {};
+        }
+        const auto ns = static_cast<double>(size) * 1e9 / static_cast<double>(m_params.bandwidth);
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::nano>(ns));
+    }
+
+    const MemorySocketParams m_params;
+
+    std::mutex m_mutex;
+    std::deque<Segment> m_segments;
+    Clock::time_point m_lastDeparture;
+    Waiter m_waiter;
+    bool m_writeClosed{false};
+    bool m_readClosed{false};
+};
+
+}   // namespace detail
+
+namespace {
+
+using detail::Clock;
+using detail::MemoryPipe;
+
+constexpr std::uint16_t firstPort = 1;
+constexpr std::uint16_t secondPort = 2;
+
+class MemorySocket final : public nhope::TcpSocket
+{
+public:
+    MemorySocket(nhope::AOContext& parent, std::shared_ptr<MemoryPipe> in, std::shared_ptr<MemoryPipe> out,
+                 std::uint16_t localPort, std::uint16_t peerPort)
+      : m_in(std::move(in))
+      , m_out(std::move(out))
+      , m_localPort(localPort)
+      , m_peerPort(peerPort)
+      , m_aoCtx(parent)
+      , m_aoCtxRef(m_aoCtx)
+    {}
+
+    ~MemorySocket() override
+    {
+        m_in->closeRead();
+        m_out->closeWrite();
+    }
+
+    void read(gsl::span<std::uint8_t> buf, nhope::IOHandler handler) override
+    {
+        m_aoCtx.exec([this, buf, handler = std::move(handler)]() mutable {
+            m_read.emplace(PendingRead{buf, std::move(handler)});
+            processRead();
+        });
+    }
+
+    void write(gsl::span<const std::uint8_t> data, nhope::IOHandler handler) override
+    {
+        m_aoCtx.exec([this, data, handler = std::move(handler)] {
+            Clock::time_point departure;
+            try {
+                departure = m_out->push({data.data(), data.size()});
+            } catch (...) {
+                handler(std::current_exception(), 0);
+                return;
+            }
+
+            const auto now = Clock::now();
+            if (departure <= now) {
+                handler(nullptr, data.size());
+                return;
+            }
+            nhope::setTimeout(m_aoCtx, departure - now, [handler, n = data.size()](auto) {
+                handler(nullptr, n);
+            });
+        });
+    }
+
+    void ioCancel() override
+    {
+        m_aoCtx.exec([this] {
+            if (auto read = std::exchange(m_read, std::nullopt)) {
+                read->handler(std::make_exception_ptr(nhope::AsyncOperationWasCancelled()), 0);
+            }
+        });
+    }
+
+    void setOptions(const Options& /*opts*/) override
+    {}
+
+    [[nodiscard]] Options options() const override
+    {
+        return {};
+    }
+
+    [[nodiscard]] NativeHandle nativeHandle() override
+    {
+        return {};
+    }
+
+    [[nodiscard]] nhope::SockAddr localAddress() const override
+    {
+        return nhope::SockAddr::ipv4("127.0.0.1", m_localPort);
+    }
+
+    [[nodiscard]] nhope::SockAddr peerAddress() const override
+    {
+        return nhope::SockAddr::ipv4("127.0.0.1", m_peerPort);
+    }
+
+    // There are no half-closed memory connections, any mode closes both directions
+    void shutdown(Shutdown /*unused*/) override
+    {
+        m_in->closeRead();
+        m_out->closeWrite();
+    }
+
+private:
+    struct PendingRead
+    {
+        gsl::span<std::uint8_t> buf;
+        nhope::IOHandler handler;
+    };
+
+    void processRead()
+    {
+        if (!m_read.has_value()) {
+            return;
+        }
+
+        auto waiter = [this, aoCtxRef = m_aoCtxRef]() mutable {
+            aoCtxRef.exec([this] {
+                processRead();
+            });
+        };
+        const auto result = m_in->pop({m_read->buf.data(), m_read->buf.size()}, std::move(waiter));
+
+        if (result.waitUntil.has_value()) {
+            if (!m_timerArmed) {
+                m_timerArmed = true;
+                nhope::setTimeout(m_aoCtx, *result.waitUntil - Clock::now(), [this](auto) {
+                    m_timerArmed = false;
+                    processRead();
+                });
+            }
+            return;
+        }
+
+        if (result.size > 0 || result.eof) {
+            auto read = std::exchange(m_read, std::nullopt);
+            read->handler(nullptr, result.size);
+        }
+    }
+
+    std::shared_ptr<MemoryPipe> m_in;
+    std::shared_ptr<MemoryPipe> m_out;
+    const std::uint16_t m_localPort;
+    const std::uint16_t m_peerPort;
+
+    std::optional<PendingRead> m_read;
+    bool m_timerArmed{false};
+
+    nhope::AOContext m_aoCtx;
+    nhope::AOContextRef m_aoCtxRef;
+};
+
+}   // namespace
+
+MemoryLink::MemoryLink(const MemorySocketParams& params)
+  : m_forward(std::make_shared<MemoryPipe>(params))
+  , m_backward(std::make_shared<MemoryPipe>(params))
+{}
+
+nhope::TcpSocketPtr MemoryLink::open(nhope::AOContext& aoCtx, End end) const
+{
+    if (end == End::First) {
+        return std::make_unique<MemorySocket>(aoCtx, m_backward, m_forward, firstPort, secondPort);
+    }
+    return std::make_unique<MemorySocket>(aoCtx, m_forward, m_backward, secondPort, firstPort);
+}
+
+std::pair<nhope::TcpSocketPtr, nhope::TcpSocketPtr> makeMemorySocketPair(nhope::AOContext& firstCtx,
+                                                                         nhope::AOContext& secondCtx,
+                                                                         const MemorySocketParams& params)
+{
+    const MemoryLink link(params);
+    return {link.open(firstCtx, MemoryLink::End::First), link.open(secondCtx, MemoryLink::End::Second)};
+}
+
+}   // namespace royalbed::common
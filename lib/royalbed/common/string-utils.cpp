@@ -1,10 +1,8 @@
-#include <cctype>
 #include <charconv>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <system_error>
-#include <type_traits>
 
 #include "fmt/core.h"
 
@@ -14,60 +12,22 @@ namespace royalbed::common::detail {
 
 namespace {
 
-class ToIntegerConvertError final : public std::invalid_argument
+class FromStringConvertError final : public std::invalid_argument
 {
 public:
-    explicit ToIntegerConvertError(std::string_view str, std::string_view what)
-      : std::invalid_argument(fmt::format("Unable convert '{}' to integer: {}", str, what))
+    explicit FromStringConvertError(std::string_view str, std::string_view what)
+      : std::invalid_argument(fmt::format("Unable convert '{}': {}", str, what))
     {}
 };
 
-std::string_view strip(std::string_view str) noexcept
-{
-    while (!str.empty() && (std::isspace(str.front()) != 0)) {
-        str.remove_prefix(1);
-    }
-
-    while (!str.empty() && (std::isspace(str.back()) != 0)) {
-        str.remove_suffix(1);
-    }
-
-    return str;
-}
-
-std::string_view removePlus(std::string_view str)
-{
-    if (!str.empty() && str.front() == '+') {
-        str.remove_prefix(1);
-    }
-    return str;
-}
-
-std::string_view normalization(std::string_view str)
-{
-    str = strip(str);
-    str = removePlus(str);
-    return str;
-}
-
 template<typename T>
-T toInteger(std::string_view str)
+T convert(std::string_view str)
 {
-    static_assert(std::is_integral_v<T>);
-
-    const auto normalized = normalization(str);
-
     T val{};
-    const auto result = std::from_chars(normalized.begin(), normalized.end(), val);
-    if (result.ec != std::errc{}) {
-        const auto errCode = std::make_error_code(result.ec);
-        throw ToIntegerConvertError(str, errCode.message());
+    const auto ec = tryFromString(str, val);
+    if (ec != std::errc{}) {
+        throw FromStringConvertError(str, std::make_error_code(ec).message());
     }
-
-    if (result.ptr != normalized.end()) {
-        throw ToIntegerConvertError(str, "not integer");
-    }
-
     return val;
 }
 
@@ -82,49 +42,67 @@ std::string fromString(std::string_view str)
 template<>
 short fromString(std::string_view str)
 {
-    return toInteger<short>(str);
+    return convert<short>(str);
 }
 
 template<>
 unsigned short fromString(std::string_view str)
 {
-    return toInteger<unsigned short>(str);
+    return convert<unsigned short>(str);
 }
 
 template<>
 int fromString(std::string_view str)
 {
-    return toInteger<int>(str);
+    return convert<int>(str);
 }
 
 template<>
 unsigned int fromString(std::string_view str)
 {
-    return toInteger<unsigned int>(str);
+    return convert<unsigned int>(str);
 }
 
 template<>
 long fromString(std::string_view str)
 {
-    return toInteger<long>(str);
+    return convert<long>(str);
 }
 
 template<>
 unsigned long fromString(std::string_view str)
 {
-    return toInteger<unsigned long>(str);
+    return convert<unsigned long>(str);
 }
 
 template<>
 long long fromString(std::string_view str)
 {
-    return toInteger<long long>(str);
+    return convert<long long>(str);
 }
 
 template<>
 unsigned long long fromString(std::string_view str)
 {
-    return toInteger<unsigned long long>(str);
+    return convert<unsigned long long>(str);
+}
+
+template<>
+float fromString(std::string_view str)
+{
+    return convert<float>(str);
+}
+
+template<>
+double fromString(std::string_view str)
+{
+    return convert<double>(str);
+}
+
+template<>
+bool fromString(std::string_view str)
+{
+    return convert<bool>(str);
 }
 
 }   // namespace royalbed::common::detail
@@ -0,0 +1,168 @@
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "fmt/core.h"
+
+#include "royalbed/common/traffic-log.h"
+
+namespace royalbed::common {
+
+namespace {
+
+using namespace std::literals;
+
+constexpr auto magic = "RBTRAFF1"sv;
+constexpr std::uint8_t bodyCapturedFlag = 1;
+
+// Records are collected in memory and written by blocks
+constexpr std::size_t flushThreshold = 64 * 1024;
+
+// Guards against allocating garbage sizes of a damaged log
+constexpr std::uint64_t maxFieldSize = std::uint64_t{1} << 32;
+
+class TruncatedRecord final
+{};
+
+void putVarint(std::string& out, std::uint64_t value)
+{
+    constexpr std::uint8_t payloadMask = 0x7f;
+    constexpr std::uint8_t continuationBit = 0x80;
+    while (value > payloadMask) {
+        out += static_cast<char>((value & payloadMask) | continuationBit);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+void putString(std::string& out, std::string_view str)
+{
+    putVarint(out, str.size());
+    out += str;
+}
+
+std::uint64_t getVarint(std::istream& in)
+{
+    constexpr int maxShift = 63;
+    std::uint64_t value = 0;
+    for (int shift = 0; shift <= maxShift; shift += 7) {
+        const auto ch = in.get();
+        if (ch == std::char_traits<char>::eof()) {
+            throw TruncatedRecord();
+        }
+        value |= static_cast<std::uint64_t>(ch & 0x7f) << shift;
+        if ((ch & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::runtime_error("traffic log is damaged: bad varint");
+}
+
+std::string getString(std::istream& in)
+{
+    const auto size = getVarint(in);
+    if (size > maxFieldSize) {
+        throw std::runtime_error("traffic log is damaged: bad string size");
+    }
+    std::string str(size, '\0');
+    if (!in.read(str.data(), static_cast<std::streamsize>(size))) {
+        throw TruncatedRecord();
+    }
+    return str;
+}
+
+}   // namespace
+
+TrafficLogWriter::TrafficLogWriter(const std::filesystem::path& path)
+  : m_start(std::chrono::steady_clock::now())
+  , m_file(path, std::ios::binary | std::ios::trunc)
+{
+    if (!m_file) {
+        throw std::runtime_error(fmt::format("unable to create traffic log {}", path.string()));
+    }
+    m_file.write(magic.data(), magic.size());
+}
+
+TrafficLogWriter::~TrafficLogWriter()
+{
+    m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+}
+
+std::chrono::nanoseconds TrafficLogWriter::elapsed() const noexcept
+{
+    return std::chrono::steady_clock::now() - m_start;
+}
+
+void TrafficLogWriter::write(const CapturedRequest& request)
+{
+    std::scoped_lock lock(m_mutex);
+
+    putVarint(m_buffer, static_cast<std::uint64_t>(request.time.count()));
+    putString(m_buffer, request.method);
+    putString(m_buffer, request.target);
+    putVarint(m_buffer, request.headers.size());
+    for (const auto& [name, value] : request.headers) {
+        putString(m_buffer, name);
+        putString(m_buffer, value);
+    }
+    m_buffer += static_cast<char>(request.bodyCaptured ? bodyCapturedFlag : 0);
+    putString(m_buffer, request.body);
+
+    if (m_buffer.size() >= flushThreshold) {
+        m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+        m_buffer.clear();
+    }
+}
+
+void TrafficLogWriter::flush()
+{
+    std::scoped_lock lock(m_mutex);
+    m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+    m_buffer.clear();
+    m_file.flush();
+}
+
+TrafficLogReader::TrafficLogReader(const std::filesystem::path& path)
+  : m_file(path, std::ios::binary)
+{
+    std::array<char, magic.size()> header{};
+    if (!m_file.read(header.data(), header.size()) || std::string_view(header.data(), header.size()) != magic) {
+        throw std::runtime_error(fmt::format("{} is not a traffic log", path.string()));
+    }
+}
+
+std::optional<CapturedRequest> TrafficLogReader::next()
+{
+    if (m_file.peek() == std::char_traits<char>::eof()) {
+        return std::nullopt;
+    }
+
+    try {
+        CapturedRequest request;
+        request.time = std::chrono::nanoseconds(getVarint(m_file));
+        request.method = getString(m_file);
+        request.target = getString(m_file);
+        for (auto count = getVarint(m_file); count > 0; --count) {
+            auto name = getString(m_file);
+            request.headers.emplace(std::move(name), getString(m_file));
+        }
+        const auto flags = m_file.get();
+        if (flags == std::char_traits<char>::eof()) {
+            throw TruncatedRecord();
+        }
+        request.bodyCaptured = (flags & bodyCapturedFlag) != 0;
+        request.body = getString(m_file);
+        return request;
+    } catch (const TruncatedRecord&) {
+        return std::nullopt;
+    }
+}
+
+}   // namespace royalbed::common
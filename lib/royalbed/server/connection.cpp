@@ -1,5 +1,7 @@
+#include <array>
 #include <cassert>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <optional>
@@ -16,6 +18,7 @@
 #include "nhope/io/io-device.h"
 #include "nhope/io/pushback-reader.h"
 
+#include "royalbed/common/coro.h"
 #include "royalbed/common/detail/uptime.h"
 #include "royalbed/server/detail/session.h"
 #include "royalbed/server/detail/connection.h"
@@ -23,6 +26,8 @@
 namespace royalbed::server::detail {
 namespace {
 
+constexpr std::size_t drainBufferSize = 4096;
+
 class Connection final
   : public nhope::AOContextCloseHandler
   , public SessionCtx
@@ -34,6 +39,8 @@ public:
       , m_ctx(params.ctx)
       , m_sock(std::move(params.sock))
       , m_leftRequests(params.keepAlive.requestsCount > 0 ? params.keepAlive.requestsCount : 1)
+      , m_maxDrainBodySize(params.keepAlive.maxDrainBodySize)
+      , m_completions(std::move(params.completions))
       , m_upTime(m_log, "connection time:")
       , m_aoCtx(parent)
     {
@@ -101,6 +108,14 @@ private:
         return m_leftRequests == 0;
     }
 
+    gsl::span<std::uint8_t> drainBuffer() override
+    {
+        if (m_drainBuf == nullptr) {
+            m_drainBuf = std::make_unique<std::array<std::uint8_t, drainBufferSize>>();
+        }
+        return *m_drainBuf;
+    }
+
     void sessionFinished(std::uint32_t sessionNum, bool keepAlive) noexcept override
     {
         m_haveActiveSession = false;
@@ -131,6 +146,9 @@ private:
                                         .in = *m_sessionIn,
                                         .out = *m_sock,
                                         .log = std::move(sessionLog),
+                                        .maxDrainBodySize = m_maxDrainBodySize,
+                                        .framePool = m_framePool,
+                                        .completions = m_completions,
                                       });
     }
 
@@ -143,7 +161,11 @@ private:
     nhope::PushbackReaderPtr m_sessionIn;
 
     std::uint32_t m_leftRequests;
+    const std::size_t m_maxDrainBodySize;
+    std::unique_ptr<std::array<std::uint8_t, drainBufferSize>> m_drainBuf;
     bool m_haveActiveSession{};
+    common::FramePoolPtr m_framePool = std::make_shared<common::FramePool>();
+    common::CompletionQueuePtr m_completions;
 
     royalbed::common::detail::UpTimeLogger m_upTime;
 
@@ -1,22 +1,20 @@
 
 #include <algorithm>
 #include <optional>
-#include <string>
 #include <string_view>
-#include <utility>
-#include <vector>
 
 #include "fmt/core.h"
 
 #include "royalbed/server/param.h"
 #include "royalbed/server/error.h"
 #include "royalbed/server/request-context.h"
+#include "royalbed/server/uri.h"
 
 namespace royalbed::server::detail {
 
 namespace {
 
-std::optional<std::string> findByName(const std::vector<std::pair<std::string, std::string>>& v, std::string_view name)
+std::optional<std::string_view> findByName(const RawPathParams& v, std::string_view name)
 {
     const auto it = std::find_if(v.begin(), v.end(), [&](const auto& p) {
         return p.first == name;
@@ -27,30 +25,63 @@ std::optional<std::string> findByName(const std::vector<std::pair<std::string, s
     return it->second;
 }
 
-std::optional<std::string> extractParam(const RequestContext& req, std::string_view name, ParamLocation loc)
+common::HttpResult<std::optional<std::string_view>> extractParam(const RequestContext& req, std::string_view name,
+                                                                 ParamLocation loc)
 {
     if (loc == ParamLocation::Path) {
         return findByName(req.rawPathParams, name);
     }
-    return findByName(req.request.uri.query, name);
+    // the query is parsed on the first access
+    if (const auto error = req.request.uri.query.tryParse()) {
+        return HttpError(HttpStatus::BadRequest, fmt::format("Malformed query: {}", *error));
+    }
+    return req.request.uri.query.find(name);
 }
 
 }   // namespace
 
-std::optional<std::string> extractParam(const RequestContext& req, const std::string_view name, ParamLocation loc,
-                                        bool required)
+common::HttpResult<std::optional<std::string_view>> tryExtractParam(const RequestContext& req,
+                                                                    const std::string_view name, ParamLocation loc,
+                                                                    bool required)
 {
     auto param = extractParam(req, name, loc);
-    if (param != std::nullopt) {
+    if (!param || param->has_value()) {
         return param;
     }
 
     if (required) {
         const auto message = fmt::format("Required parameter '{}' not found", name);
-        throw HttpError(HttpStatus::BadRequest, message);
+        return HttpError(HttpStatus::BadRequest, message);
     }
 
-    return std::nullopt;
+    return std::optional<std::string_view>{};
+}
+
+std::optional<std::string_view> extractParam(const RequestContext& req, const std::string_view name,
+                                             ParamLocation loc, bool required)
+{
+    return tryExtractParam(req, name, loc, required).value();
 }
 
 }   // namespace royalbed::server::detail
+
+namespace royalbed::server {
+
+std::string_view toString(ParamError error) noexcept
+{
+    switch (error) {
+        case ParamError::None:
+            return "no error";
+        case ParamError::InvalidValue:
+            return "invalid value";
+        case ParamError::OutOfRange:
+            return "value is out of range";
+        case ParamError::TooBig:
+            return "value is too big";
+        case ParamError::TooSmall:
+            return "value is too small";
+    }
+    return "unknown error";
+}
+
+}   // namespace royalbed::server
@@ -0,0 +1,115 @@
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nhope/io/sock-addr.h"
+#include "nhope/io/tcp.h"
+
+#include "royalbed/common/memory-socket.h"
+#include "royalbed/server/listener.h"
+
+namespace royalbed::server {
+namespace {
+
+class TcpListener final : public Listener
+{
+public:
+    TcpListener(nhope::AOContext& aoCtx, const std::string& address, std::uint16_t port)
+      : m_tcpServer(nhope::TcpServer::start(aoCtx, {
+                                                     .address = address,
+                                                     .port = port,
+                                                   }))
+    {}
+
+    nhope::Future<nhope::TcpSocketPtr> accept() override
+    {
+        return m_tcpServer->accept();
+    }
+
+    [[nodiscard]] nhope::SockAddr bindAddress() const override
+    {
+        return m_tcpServer->bindAddress();
+    }
+
+private:
+    nhope::TcpServerPtr m_tcpServer;
+};
+
+class MemoryListenerImpl final : public MemoryListener
+{
+public:
+    MemoryListenerImpl(nhope::AOContext& aoCtx, const common::MemorySocketParams& params)
+      : m_params(params)
+      , m_aoCtx(aoCtx)
+      , m_aoCtxRef(m_aoCtx)
+    {}
+
+    nhope::Future<nhope::TcpSocketPtr> accept() override
+    {
+        auto promise = std::make_shared<nhope::Promise<nhope::TcpSocketPtr>>();
+        auto future = promise->future();
+        m_aoCtxRef.exec([this, promise] {
+            m_accepts.push_back(promise);
+            processQueue();
+        });
+        return future;
+    }
+
+    [[nodiscard]] nhope::SockAddr bindAddress() const override
+    {
+        return nhope::SockAddr::ipv4("127.0.0.1", 0);
+    }
+
+    nhope::TcpSocketPtr connect(nhope::AOContext& aoCtx) override
+    {
+        const common::MemoryLink link(m_params);
+        auto sock = link.open(aoCtx, common::MemoryLink::End::First);
+
+        // the server end is opened in the listener context
+        m_aoCtxRef.exec([this, link] {
+            m_links.push_back(link);
+            processQueue();
+        });
+        return sock;
+    }
+
+private:
+    void processQueue()
+    {
+        while (!m_accepts.empty() && !m_links.empty()) {
+            auto promise = std::move(m_accepts.front());
+            m_accepts.pop_front();
+            auto link = std::move(m_links.front());
+            m_links.pop_front();
+
+            promise->setValue(link.open(m_aoCtx, common::MemoryLink::End::Second));
+        }
+    }
+
+    const common::MemorySocketParams m_params;
+
+    // Touched only in m_aoCtx
+    std::deque<std::shared_ptr<nhope::Promise<nhope::TcpSocketPtr>>> m_accepts;
+    std::deque<common::MemoryLink> m_links;
+
+    nhope::AOContext m_aoCtx;
+    nhope::AOContextRef m_aoCtxRef;
+};
+
+}   // namespace
+
+ListenerPtr Listener::listenTcp(nhope::AOContext& aoCtx, const std::string& address, std::uint16_t port)
+{
+    return std::make_shared<TcpListener>(aoCtx, address, port);
+}
+
+MemoryListenerPtr MemoryListener::create(nhope::AOContext& aoCtx, const common::MemorySocketParams& params)
+{
+    return std::make_shared<MemoryListenerImpl>(aoCtx, params);
+}
+
+}   // namespace royalbed::server
@@ -0,0 +1,406 @@
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "fmt/core.h"
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nhope/io/io-device.h"
+
+#include "royalbed/client/client-pool.h"
+#include "royalbed/common/coro.h"
+#include "royalbed/common/detail/string-utils.h"
+#include "royalbed/server/error.h"
+#include "royalbed/server/http-status.h"
+#include "royalbed/server/proxy.h"
+#include "royalbed/server/request-context.h"
+
+namespace royalbed::server {
+
+namespace {
+
+using namespace std::literals;
+
+constexpr std::array hopByHopHeaders{
+  "Connection"sv, "Keep-Alive"sv, "Proxy-Authenticate"sv, "Proxy-Authorization"sv,
+  "Proxy-Connection"sv, "TE"sv, "Trailer"sv, "Transfer-Encoding"sv, "Upgrade"sv,
+};
+
+// The headers named in Connection are hop-by-hop too
+void removeHopByHopHeaders(Headers& headers)
+{
+    if (const auto it = headers.find("Connection"); it != headers.end()) {
+        std::string_view names = it->second;
+        while (!names.empty()) {
+            const auto comma = names.find(',');
+            headers.erase(std::string(common::detail::strip(names.substr(0, comma))));
+            names = comma == std::string_view::npos ? ""sv : names.substr(comma + 1);
+        }
+    }
+    for (const auto name : hopByHopHeaders) {
+        headers.erase(std::string(name));
+    }
+}
+
+// Same as the session decides whether the request has a body
+bool hasBody(const Headers& headers)
+{
+    if (headers.contains("Transfer-Encoding")) {
+        return true;
+    }
+    const auto it = headers.find("Content-Length");
+    return it != headers.end() && it->second != "0"sv;
+}
+
+/**
+ * Frames the decoded body back into chunks for "Transfer-Encoding: chunked".
+ * The data is read right after the room for the chunk size and moved to it, there is no extra buffer.
+ */
+class ChunkedBody final : public nhope::Reader
+{
+public:
+    ChunkedBody(nhope::AOContext& aoCtx, nhope::ReaderPtr body)
+      : m_aoCtx(aoCtx)
+      , m_body(std::move(body))
+    {}
+
+    void read(gsl::span<std::uint8_t> buf, nhope::IOHandler handler) override
+    {
+        assert(buf.size() > chunkOverhead);   // NOLINT
+
+        if (m_finished) {
+            m_aoCtx.exec([handler = std::move(handler)] {
+                handler(nullptr, 0);
+            });
+            return;
+        }
+
+        const auto data = buf.subspan(maxSizeLength, buf.size() - chunkOverhead);
+        m_body->read(data, [this, buf, handler = std::move(handler)](std::exception_ptr err, std::size_t n) {
+            if (err) {
+                handler(std::move(err), 0);
+                return;
+            }
+            if (n == 0) {
+                m_finished = true;
+                std::memcpy(buf.data(), lastChunk.data(), lastChunk.size());
+                handler(nullptr, lastChunk.size());
+                return;
+            }
+
+            const auto size = fmt::format("{:x}\r\n", n);
+            std::memmove(buf.data() + size.size(), buf.data() + maxSizeLength, n);
+            std::memcpy(buf.data(), size.data(), size.size());
+            std::memcpy(buf.data() + size.size() + n, crlf.data(), crlf.size());
+            handler(nullptr, size.size() + n + crlf.size());
+        });
+    }
+
+private:
+    static constexpr auto crlf = "\r\n"sv;
+    static constexpr auto lastChunk = "0\r\n\r\n"sv;
+
+    // 64-bit size in hex and CRLF
+    static constexpr std::size_t maxSizeLength = 2 * sizeof(std::size_t) + crlf.size();
+    static constexpr std::size_t chunkOverhead = maxSizeLength + crlf.size();
+
+    nhope::AOContextRef m_aoCtx;
+    nhope::ReaderPtr m_body;
+    bool m_finished = false;
+};
+
+/**
+ * Reader of a device that belongs to another context: the device is read and destroyed in its context,
+ * the handlers are called in the context of the reader.
+ * The device reads into its own buffer, so a read in progress never writes to the buffer of a reader that is gone.
+ */
+class ForeignReader final : public nhope::Reader
+{
+public:
+    ForeignReader(nhope::AOContext& deviceCtx, nhope::AOContext& aoCtx, nhope::ReaderPtr device)
+      : m_deviceCtx(deviceCtx)
+      , m_aoCtx(aoCtx)
+      , m_device(std::make_shared<Device>(Device{.reader = std::move(device), .buf = {}}))
+    {}
+
+    ~ForeignReader() override
+    {
+        m_deviceCtx.exec([device = std::move(m_device)] {});
+    }
+
+    void read(gsl::span<std::uint8_t> buf, nhope::IOHandler handler) override
+    {
+        auto done = [aoCtx = m_aoCtx, alive = std::weak_ptr(m_alive), buf, handler = std::move(handler)](
+                      const std::shared_ptr<Device>& device, std::exception_ptr err, std::size_t n) mutable {
+            aoCtx.exec([alive, buf, handler = std::move(handler), device, err = std::move(err), n] {
+                if (alive.expired()) {
+                    return;
+                }
+                std::memcpy(buf.data(), device->buf.data(), n);
+                handler(err, n);
+            });
+        };
+        m_deviceCtx.exec([device = m_device, size = buf.size(), done = std::move(done)]() mutable {
+            device->buf.resize(size);
+            device->reader->read(device->buf, [device, done](std::exception_ptr err, std::size_t n) mutable {
+                done(device, std::move(err), n);
+            });
+        });
+    }
+
+private:
+    struct Device
+    {
+        nhope::ReaderPtr reader;
+        std::vector<std::uint8_t> buf;
+    };
+
+    nhope::AOContextRef m_deviceCtx;
+    nhope::AOContextRef m_aoCtx;
+    std::shared_ptr<Device> m_device;
+    std::shared_ptr<bool> m_alive = std::make_shared<bool>(true);
+};
+
+// Reports whether the body has been read to the end when the reader is done with it
+class ForwardedBody final : public nhope::Reader
+{
+public:
+    ForwardedBody(nhope::ReaderPtr body, nhope::Promise<bool>&& done)
+      : m_body(std::move(body))
+      , m_done(std::move(done))
+    {}
+
+    ~ForwardedBody() override
+    {
+        settle(false);
+    }
+
+    void read(gsl::span<std::uint8_t> buf, nhope::IOHandler handler) override
+    {
+        m_body->read(buf, [this, handler = std::move(handler)](std::exception_ptr err, std::size_t n) {
+            if (err != nullptr || n == 0) {
+                settle(err == nullptr);
+            }
+            handler(std::move(err), n);
+        });
+    }
+
+private:
+    void settle(bool complete)
+    {
+        if (!m_done.satisfied()) {
+            m_done.setValue(complete);
+        }
+    }
+
+    nhope::ReaderPtr m_body;
+    nhope::Promise<bool> m_done;
+};
+
+/**
+ * The response body ends only when the upstream is done with the request body, so the session reads the next
+ * request right behind it. If the request body has not been read to the end, the response fails
+ * and the connection is closed.
+ */
+class AfterRequestBody final : public nhope::Reader
+{
+public:
+    AfterRequestBody(nhope::AOContext& parent, nhope::ReaderPtr body, nhope::Future<bool>&& requestBodyForwarded)
+      : m_aoCtx(parent)
+      , m_body(std::move(body))
+      , m_requestBodyForwarded(std::move(requestBodyForwarded))
+    {}
+
+    void read(gsl::span<std::uint8_t> buf, nhope::IOHandler handler) override
+    {
+        m_body->read(buf, [this, handler = std::move(handler)](std::exception_ptr err, std::size_t n) {
+            if (err != nullptr || n > 0 || !m_requestBodyForwarded.has_value()) {
+                handler(std::move(err), n);
+                return;
+            }
+            auto forwarded = std::move(*m_requestBodyForwarded);
+            m_requestBodyForwarded.reset();
+            forwarded.then(m_aoCtx, [handler](bool complete) {
+                if (!complete) {
+                    const auto code = std::make_error_code(std::errc::connection_aborted);
+                    handler(std::make_exception_ptr(std::system_error(code, "request body has not been forwarded")), 0);
+                    return;
+                }
+                handler(nullptr, 0);
+            });
+        });
+    }
+
+private:
+    nhope::AOContext m_aoCtx;
+    nhope::ReaderPtr m_body;
+    std::optional<nhope::Future<bool>> m_requestBodyForwarded;
+};
+
+// The body passes through as is if its length is known, otherwise it is chunked again
+void passBody(nhope::AOContext& aoCtx, Headers& headers, nhope::ReaderPtr& body)
+{
+    if (body != nullptr && !headers.contains("Content-Length")) {
+        headers["Transfer-Encoding"] = "chunked";
+        body = std::make_unique<ChunkedBody>(aoCtx, std::move(body));
+    }
+}
+
+std::string joinPath(std::string_view prefix, std::string_view path)
+{
+    if (prefix.ends_with('/') && path.starts_with('/')) {
+        prefix.remove_suffix(1);
+    }
+    return fmt::format("{}{}", prefix, path);
+}
+
+class Proxy final : public std::enable_shared_from_this<Proxy>
+{
+public:
+    Proxy(nhope::AOContext& parent, ProxyParams&& params)
+      : m_upstream(std::move(params.upstream))
+      , m_aoCtx(parent)
+      , m_pool(client::ClientPool::create(m_aoCtx, std::move(params.pool)))
+    {
+        if (m_upstream.host.empty()) {
+            throw std::invalid_argument("proxy upstream has no host");
+        }
+    }
+
+    ~Proxy()
+    {
+        m_aoCtx.close();
+    }
+
+    nhope::Future<void> handle(RequestContext& ctx)
+    {
+        auto& request = ctx.request;
+        const bool withBody = hasBody(request.headers);
+
+        client::Request upstreamRequest{
+          .method = request.method,
+          .uri = m_upstream,
+          .headers = request.headers,
+          .body = nullptr,
+        };
+        upstreamRequest.uri.path = joinPath(m_upstream.path, request.uri.path);
+        upstreamRequest.uri.query = request.uri.query;
+        removeHopByHopHeaders(upstreamRequest.headers);
+        // the session has answered it
+        upstreamRequest.headers.erase("Expect");
+        if (const auto host = request.headers.find("Host"); host != request.headers.end()) {
+            upstreamRequest.headers.erase(host->first);
+            upstreamRequest.headers["X-Forwarded-Host"] = host->second;
+        }
+
+        // the session is not done with the request until the pool gives its body back
+        auto bodyForwarded = nhope::makeReadyFuture<bool>(true);
+        if (withBody) {
+            nhope::Promise<bool> forwarded;
+            bodyForwarded = forwarded.future();
+            upstreamRequest.body = std::make_unique<ForwardedBody>(std::move(request.body), std::move(forwarded));
+            passBody(ctx.aoCtx, upstreamRequest.headers, upstreamRequest.body);
+            upstreamRequest.body = std::make_unique<ForeignReader>(ctx.aoCtx, m_aoCtx, std::move(upstreamRequest.body));
+        }
+
+        std::exception_ptr error;
+        try {
+            ctx.response = co_await this->open(std::move(upstreamRequest));
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        auto& response = ctx.response;
+        if (error == nullptr && response.body != nullptr) {
+            response.body = std::make_unique<ForeignReader>(m_aoCtx, ctx.aoCtx, std::move(response.body));
+        }
+        constexpr int noContent = 204;
+        constexpr int notModified = 304;
+        if (request.method == "HEAD" || response.status == noContent || response.status == notModified) {
+            response.body = nullptr;
+        }
+
+        if (error != nullptr || response.body == nullptr) {
+            if (!co_await std::move(bodyForwarded)) {
+                // an unknown part of the body is left in the connection
+                request.headers["Connection"] = "close";
+            }
+            if (error != nullptr) {
+                throw gatewayError(error);
+            }
+        } else if (withBody) {
+            // the upstream may answer before it has read the whole body
+            response.body = std::make_unique<AfterRequestBody>(ctx.aoCtx, std::move(response.body),
+                                                               std::move(bodyForwarded));
+        }
+
+        removeHopByHopHeaders(response.headers);
+        passBody(ctx.aoCtx, response.headers, response.body);
+    }
+
+private:
+    // The pool is used in its own context
+    nhope::Future<client::Response> open(client::Request&& request)
+    {
+        auto promise = std::make_shared<nhope::Promise<client::Response>>();
+        auto future = promise->future();
+        auto shared = std::make_shared<client::Request>(std::move(request));
+        m_aoCtx.exec([self = shared_from_this(), promise, shared] {
+            forward(self->m_aoCtx, *self->m_pool, std::move(*shared), promise);
+        });
+        return future;
+    }
+
+    static nhope::Future<void> forward(nhope::AOContext& /*aoCtx*/, client::ClientPool& pool,
+                                       client::Request request,
+                                       std::shared_ptr<nhope::Promise<client::Response>> promise)
+    {
+        try {
+            promise->setValue(co_await pool.openRequest(std::move(request)));
+        } catch (...) {
+            promise->setException(std::current_exception());
+        }
+    }
+
+    static HttpError gatewayError(const std::exception_ptr& error)
+    {
+        try {
+            std::rethrow_exception(error);
+        } catch (const std::system_error& e) {
+            if (e.code() == std::errc::timed_out) {
+                return HttpError(HttpStatus::GatewayTimeout);
+            }
+            return HttpError(HttpStatus::BadGateway, e.what());
+        } catch (const std::exception& e) {
+            return HttpError(HttpStatus::BadGateway, e.what());
+        }
+    }
+
+    const client::Uri m_upstream;
+    nhope::AOContext m_aoCtx;
+    client::ClientPoolPtr m_pool;
+};
+
+}   // namespace
+
+LowLevelHandler proxyTo(nhope::AOContext& aoCtx, ProxyParams params)
+{
+    auto proxy = std::make_shared<Proxy>(aoCtx, std::move(params));
+    return [proxy](RequestContext& ctx) {
+        return proxy->handle(ctx);
+    };
+}
+
+}   // namespace royalbed::server
@@ -1,9 +1,11 @@
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
 #include <exception>
-#include <filesystem>
 #include <memory>
+#include <memory_resource>
+#include <span>
 #include <stdexcept>
 #include <string_view>
 #include <string>
@@ -35,10 +37,12 @@ namespace royalbed::server {
 namespace {
 using namespace royalbed::common::detail;
 
-namespace fs = std::filesystem;
 using namespace std::literals;
 using namespace fmt::literals;
 
+constexpr std::size_t routeArenaSize = 1024;
+constexpr std::size_t routeArenaSegments = 16;
+
 std::pair<std::string_view, std::string_view> headSegmentAndTail(std::string_view path) noexcept
 {
     const auto pos = path.find('/');
@@ -48,42 +52,6 @@ std::pair<std::string_view, std::string_view> headSegmentAndTail(std::string_vie
     return {path.substr(0, pos), path.substr(pos + 1)};
 }
 
-std::pair<std::string_view, std::string_view> headAndTailSegment(std::string_view path) noexcept
-{
-    const auto pos = path.rfind('/');
-    if (pos == std::string_view::npos) {
-        return {""sv, path};
-    }
-    return {path.substr(0, pos), path.substr(pos + 1)};
-}
-
-std::string_view limitPathByDepth(std::string_view path, std::size_t depth)
-{
-    // The path must be normalized (see normalizePath)
-    assert(path.empty() || path[0] != '/');   // NOLINT
-
-    if (depth == 1) {
-        // The root
-        return ""sv;
-    }
-
-    if (depth == 2) {
-        // The first segment
-        assert(!path.empty());   // NOLINT
-        return path.substr(0, path.find('/'));
-    }
-
-    std::size_t len = 0;
-    for (; depth > 1; --depth) {
-        // The path must be normalized (see normalizePath)
-        assert(len != std::string_view::npos);   // NOLINT
-        assert(len + 1 < path.size());           // NOLINT
-
-        len = path.find('/', len + 1);
-    }
-    return path.substr(0, len);
-}
-
 bool isParamSegment(std::string_view segment) noexcept
 {
     return !segment.empty() && segment[0] == ':';
@@ -94,18 +62,45 @@ bool isFixedSegment(std::string_view segment) noexcept
     return !isParamSegment(segment);
 }
 
-std::string normalizePath(std::string_view path)
+// Splits the path into segments: empty and "." segments are skipped, ".." removes the previous segment.
+// The segments refer to the source path.
+template<typename Segments>
+void splitPath(std::string_view path, Segments& segments)
 {
-    std::string retval = fs::path(path, fs::path::format::generic_format)   //
-                           .lexically_normal()
-                           .generic_string();
+    while (!path.empty()) {
+        auto [segment, tail] = headSegmentAndTail(path);
+        path = tail;
 
-    if (retval.starts_with('/')) {
-        retval.erase(0, 1);
+        if (segment.empty() || segment == "."sv) {
+            continue;
+        }
+        if (segment == ".."sv) {
+            if (!segments.empty()) {
+                segments.pop_back();
+            }
+            continue;
+        }
+        segments.push_back(segment);
     }
-    if (retval.ends_with('/')) {
-        retval.pop_back();
+}
+
+template<typename Segments, typename String>
+void joinSegments(const Segments& segments, String& out)
+{
+    for (const auto segment : segments) {
+        if (!out.empty()) {
+            out += '/';
+        }
+        out += segment;
     }
+}
+
+std::string normalizePath(std::string_view path)
+{
+    std::vector<std::string_view> segments;
+    splitPath(path, segments);
+    std::string retval;
+    joinSegments(segments, retval);
     return retval;
 }
 
@@ -125,11 +120,16 @@ const auto defaultMethodNotAllowedHandler = LowLevelHandler{[](RequestContext& c
     return nhope::makeReadyFuture();
 }};
 
+void makeErrorResponse(RequestContext& ctx, const HttpError& e)
+{
+    ctx.response = common::makePlainTextResponse(ctx.aoCtx, e.httpStatus(), e.what());
+}
+
 const auto defaultExceptionHandler = ExceptionHandler{[](RequestContext& ctx, std::exception_ptr ex) {
     try {
         std::rethrow_exception(std::move(ex));
     } catch (const HttpError& e) {
-        ctx.response = common::makePlainTextResponse(ctx.aoCtx, e.httpStatus(), e.what());
+        makeErrorResponse(ctx, e);
     } catch (const std::exception& e) {
         ctx.response = common::makePlainTextResponse(ctx.aoCtx, HttpStatus::InternalServerError, e.what());
     }
@@ -263,16 +263,19 @@ public:
         return result;
     }
 
-    void extractParamsFromPath(std::string_view path, RawPathParams& params) const
+    // `segments` are the path segments from the root up to this node
+    void extractParamsFromPath(std::span<const std::string_view> segments, RawPathParams& params) const
     {
-        const auto [pathHead, pathTailSegment] = headAndTailSegment(path);
-        if (!pathHead.empty()) {
-            assert(m_parent != nullptr);   // NOLINT
-            m_parent->extractParamsFromPath(pathHead, params);
+        if (this->isRoot()) {
+            assert(segments.empty());   // NOLINT
+            return;
         }
 
+        assert(!segments.empty());   // NOLINT
+        m_parent->extractParamsFromPath(segments.first(segments.size() - 1), params);
+
         if (this->isParamNode()) {
-            params.emplace_back(m_nodeSegment.substr(1), pathTailSegment);
+            params.emplace_back(std::string_view(m_nodeSegment).substr(1), segments.back());
         }
     }
 
@@ -486,7 +489,15 @@ RouteResult Router::route(std::string_view method, std::string_view path) const
 {
     RouteResult result;
 
-    const auto normalizedPath = normalizePath(path);
+    // the segments and the normalized path are only needed during the routing
+    std::array<std::byte, routeArenaSize> arenaBuf;   // NOLINT(cppcoreguidelines-pro-type-member-init)
+    std::pmr::monotonic_buffer_resource arena(arenaBuf.data(), arenaBuf.size());
+    std::pmr::vector<std::string_view> segments(&arena);
+    std::pmr::string normalizedPath(&arena);
+    segments.reserve(routeArenaSegments);
+    normalizedPath.reserve(path.size());
+    splitPath(path, segments);
+    joinSegments(segments, normalizedPath);
     const auto [found, bestNode, bestNodeDepth] = m_root->findNode(normalizedPath);
     assert(bestNode != nullptr);   // NOLINT
 
@@ -495,26 +506,46 @@ RouteResult Router::route(std::string_view method, std::string_view path) const
         return result;
     }
 
-    auto nodeHandler = bestNode->findMethodHandler(method);
+    const auto& nodeHandler = bestNode->findMethodHandler(method);
     if (nodeHandler == nullptr) {
         result.handler = bestNode->methodNotAllowedHandler();
         return result;
     }
 
-    result.handler = [fn = std::move(nodeHandler), this, normalizedPath](RequestContext& ctx) {
+    // the router outlives the sessions, so the handler refers to the node. Small enough for std::function
+    result.handler = [fn = &nodeHandler, node = bestNode](RequestContext& ctx) {
         try {
-            return fn(ctx).fail([&ctx, this, normalizedPath](std::exception_ptr e) {
-                processException(ctx, std::move(e), normalizedPath);
+            auto future = (*fn)(ctx);
+            if (future.isReady()) {
+                // the handler has finished synchronously, no need to schedule the continuation
+                future.get();
+                processError(ctx, *node);
+                return nhope::makeReadyFuture();
+            }
+            auto onDone = [&ctx, node] {
+                processError(ctx, *node);
+            };
+            // an offloaded handler is settled by a completion of the IO context queue, continue right in its drain.
+            // The queue drops the continuation of a closed session, so the error is not processed after it either
+            const auto guard = ctx.completionOwner.guard();
+            auto done = ctx.completions != nullptr ? ctx.completions->continueWith(guard, std::move(future), onDone)
+                                                   : std::move(future).then(ctx.aoCtx, onDone);
+            return std::move(done).fail([&ctx, node, guard](std::exception_ptr e) {
+                if (!guard.expired()) {
+                    processException(ctx, std::move(e), *node);
+                }
             });
         } catch (...) {
-            processException(ctx, std::current_exception(), normalizedPath);
+            processException(ctx, std::current_exception(), *node);
             return nhope::makeReadyFuture();
         }
     };
 
     result.middlewares = bestNode->middlewares();
-    const auto processedPath = limitPathByDepth(normalizedPath, bestNodeDepth);
-    bestNode->extractParamsFromPath(processedPath, result.rawPathParams);
+
+    // The root node has depth 1 and no segment
+    assert(bestNodeDepth > 0 && bestNodeDepth - 1 <= segments.size());   // NOLINT
+    bestNode->extractParamsFromPath(std::span(segments).first(bestNodeDepth - 1), result.rawPathParams);
 
     return result;
 }
@@ -553,11 +584,28 @@ Router& Router::addRoute(std::string_view method, std::string_view resource, Low
     return *this;
 }
 
-void Router::processException(RequestContext& ctx, std::exception_ptr e, std::string_view normalizedPath) const
+void Router::processException(RequestContext& ctx, std::exception_ptr e, const Node& node)
+{
+    node.exceptionHandler()(ctx, std::move(e));
+}
+
+void Router::processError(RequestContext& ctx, const Node& node)
 {
-    const auto [found, node, bestNodeDepth] = m_root->findNode(normalizedPath);
-    assert(found && "node must be founded");   // NOLINT
-    node->exceptionHandler()(ctx, std::move(e));
+    if (!ctx.error.has_value()) {
+        return;
+    }
+
+    const auto error = std::move(*ctx.error);
+    ctx.error.reset();
+
+    const auto& handler = node.exceptionHandler();
+    if (&handler == &defaultExceptionHandler) {
+        makeErrorResponse(ctx, error);
+        return;
+    }
+
+    // user handlers only know about exceptions
+    handler(ctx, std::make_exception_ptr(error));
 }
 
 }   // namespace royalbed::server
@@ -7,20 +7,22 @@
 #include "nhope/async/ao-context.h"
 #include "nhope/io/tcp.h"
 
+#include "royalbed/common/completion-queue.h"
 #include "royalbed/common/detail/uptime.h"
 #include "royalbed/server/detail/connection.h"
+#include "royalbed/server/listener.h"
 #include "royalbed/server/server.h"
 
 namespace royalbed::server {
 namespace {
 using namespace detail;
 
-nhope::TcpServerPtr startTcpServer(nhope::AOContext& aoCtx, const ServerParams& params)
+ListenerPtr startListener(nhope::AOContext& aoCtx, const ServerParams& params)
 {
-    return nhope::TcpServer::start(aoCtx, {
-                                            .address = params.bindAddress,
-                                            .port = params.port,
-                                          });
+    if (params.listener != nullptr) {
+        return params.listener;
+    }
+    return Listener::listenTcp(aoCtx, params.bindAddress, params.port);
 }
 
 class ServerImpl final
@@ -30,12 +32,13 @@ class ServerImpl final
 public:
     ServerImpl(nhope::AOContext& aoCtx, ServerParams&& params)
       : m_log(params.log)
-      , m_tcpServer(startTcpServer(aoCtx, params))
+      , m_listener(startListener(aoCtx, params))
       , m_router(std::move(params.router))
       , m_upTime(m_log, "service uptime")
       , m_aoCtx(aoCtx)
+      , m_completions(common::CompletionQueue::create(m_aoCtx))
     {
-        const auto bindAddr = m_tcpServer->bindAddress();
+        const auto bindAddr = m_listener->bindAddress();
         m_log->info("service accepting HTTP connections at http://{}", bindAddr.toString());
 
         for (const auto& resource : m_router.resources()) {
@@ -54,7 +57,7 @@ public:
 
     [[nodiscard]] nhope::SockAddr bindAddress() const override
     {
-        return m_tcpServer->bindAddress();
+        return m_listener->bindAddress();
     }
 
 private:
@@ -91,7 +94,7 @@ private:
 
     void acceptNextConnection()
     {
-        m_tcpServer->accept().then(m_aoCtx, [this](auto connection) {
+        m_listener->accept().then(m_aoCtx, [this](auto connection) {
             ++m_activeConnectionCount;
             const auto connectionNum = ++m_connectionCounter;
 
@@ -104,6 +107,7 @@ private:
                                               .ctx = *this,
                                               .log = m_log->clone(fmt::format("{}/C{}", m_log->name(), connectionNum)),
                                               .sock = std::move(connection),
+                                              .completions = m_completions,
                                             });
 
             this->acceptNextConnection();
@@ -111,7 +115,7 @@ private:
     }
 
     std::shared_ptr<spdlog::logger> m_log;
-    nhope::TcpServerPtr m_tcpServer;
+    ListenerPtr m_listener;
     Router m_router;
 
     // TODO add max connections limit
@@ -126,6 +130,7 @@ private:
     royalbed::common::detail::UpTimeLogger m_upTime;
 
     nhope::AOContext m_aoCtx;
+    common::CompletionQueuePtr m_completions;
 };
 
 }   // namespace
@@ -1,16 +1,22 @@
 #include <array>
 #include <cassert>
+#include <charconv>
 #include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <exception>
+#include <memory>
 #include <optional>
+#include <stdexcept>
 #include <string>
 #include <string_view>
+#include <system_error>
 #include <type_traits>
 #include <utility>
 
+#include "fmt/core.h"
 #include "royalbed/common/http-error.h"
+#include "royalbed/common/http-result.h"
 #include "royalbed/common/http-status.h"
 #include "royalbed/server/web-socket.h"
 #include "spdlog/logger.h"
@@ -20,6 +26,8 @@
 #include "nhope/io/io-device.h"
 #include "nhope/io/pushback-reader.h"
 
+#include "royalbed/common/coro.h"
+#include "royalbed/common/detail/string-utils.h"
 #include "royalbed/common/detail/uptime.h"
 #include "royalbed/server/detail/receive-request.h"
 #include "royalbed/server/detail/send-response.h"
@@ -39,6 +47,9 @@ using namespace std::literals;
 
 const auto ConnectionHeader = "Connection"s;
 const auto ConnectionHeaderCloseValue = "close"s;
+const auto ExpectHeader = "Expect"s;
+constexpr auto ExpectContinueValue = "100-continue"sv;
+constexpr auto ContinueResponse = "HTTP/1.1 100 Continue\r\n\r\n"sv;
 
 std::string gmtDateTime()
 {
@@ -50,6 +61,33 @@ std::string gmtDateTime()
     return {dateBuffer.data(), count};
 }
 
+bool hasBody(const Request& request)
+{
+    if (request.body == nullptr) {
+        return false;
+    }
+    if (request.headers.contains("Transfer-Encoding")) {
+        return true;
+    }
+    const auto it = request.headers.find("Content-Length");
+    return it != request.headers.end() && it->second != "0"sv;
+}
+
+// The parser has checked the value, there is no length for a chunked body
+std::optional<std::size_t> contentLength(const Request& request)
+{
+    const auto it = request.headers.find("Content-Length");
+    if (it == request.headers.end()) {
+        return std::nullopt;
+    }
+    std::size_t size = 0;
+    const auto& value = it->second;
+    if (std::from_chars(value.data(), value.data() + value.size(), size).ec != std::errc()) {
+        return std::nullopt;
+    }
+    return size;
+}
+
 template<typename AsyncFunc>
 auto safeCall(RequestContext& ctx, AsyncFunc&& func)
 {
@@ -65,6 +103,62 @@ auto safeCall(RequestContext& ctx, AsyncFunc&& func)
     }
 }
 
+enum class ExpectContinue
+{
+    None,
+    Pending,
+    Sent
+};
+
+/**
+ * Reader that postpones "100 Continue" until somebody actually starts reading the request body.
+ * So the routing, middlewares and handler checks can reject the request with a final status
+ * and the client will not send the body at all.
+ */
+class ContinueReader final : public nhope::Reader
+{
+public:
+    ContinueReader(nhope::AOContext& aoCtx, nhope::ReaderPtr body, nhope::Writter& out, ExpectContinue& state)
+      : m_aoCtxRef(aoCtx)
+      , m_body(std::move(body))
+      , m_out(out)
+      , m_state(state)
+    {}
+
+    void read(gsl::span<std::uint8_t> buf, nhope::IOHandler handler) override
+    {
+        if (m_state != ExpectContinue::Pending) {
+            m_body->read(buf, std::move(handler));
+            return;
+        }
+
+        m_state = ExpectContinue::Sent;
+
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        const auto* data = reinterpret_cast<const std::uint8_t*>(ContinueResponse.data());
+        m_out.write({data, ContinueResponse.size()},
+                    [this, aoCtxRef = m_aoCtxRef, buf, handler = std::move(handler)](auto err, auto n) mutable {
+                        aoCtxRef.exec([this, buf, err, n, handler = std::move(handler)]() mutable {
+                            if (err) {
+                                handler(std::move(err), 0);
+                                return;
+                            }
+                            if (n != ContinueResponse.size()) {
+                                handler(std::make_exception_ptr(std::runtime_error("failed to send 100 Continue")), 0);
+                                return;
+                            }
+                            m_body->read(buf, std::move(handler));
+                        });
+                    });
+    }
+
+private:
+    nhope::AOContextRef m_aoCtxRef;
+    nhope::ReaderPtr m_body;
+    nhope::Writter& m_out;
+    ExpectContinue& m_state;
+};
+
 class Session final : public nhope::AOContextCloseHandler
 {
 public:
@@ -73,6 +167,8 @@ public:
       , m_ctx(param.ctx)
       , m_in(param.in)
       , m_out(param.out)
+      , m_maxDrainBodySize(param.maxDrainBodySize)
+      , m_framePool(std::move(param.framePool))
       , m_requestCtx{
           .num = param.num,
           .log = std::move(param.log),
@@ -81,6 +177,9 @@ public:
           .request{},
           .rawPathParams{},
           .response{},
+          .error{},
+          .completions = std::move(param.completions),
+          .completionOwner{},
           .aoCtx = nhope::AOContext(aoCtx),
         }
         , m_upTime(m_requestCtx.log, "session time:")
@@ -92,6 +191,17 @@ public:
           *this);
     }
 
+    // The sessions of a connection one after another reuse the same memory block of the connection pool
+    static void* operator new(std::size_t size)
+    {
+        return common::detail::allocateFrame(size);
+    }
+
+    static void operator delete(void* ptr, std::size_t size) noexcept
+    {
+        common::detail::deallocateFrame(ptr, size);
+    }
+
 private:
     ~Session() override
     {
@@ -111,44 +221,71 @@ private:
 
     void start()
     {
-        receiveRequest(m_requestCtx.aoCtx, m_in)
-          .then(aoCtx(),
-                [this](auto req) mutable {
-                    m_ctx.sessionReceivedRequest(m_num);
-                    return this->processingRequest(std::move(req));
-                })
-          .fail(aoCtx(),
-                [this](auto ex) {
-                    return this->makeResponseFromError(std::move(ex));
-                })
-          .then(aoCtx(),
-                [this] {
-                    return this->sendResponse();
-                })
-          .then(aoCtx(),
-                [this](bool keepAlive) {
-                    this->finished(keepAlive);
-                })
-          .fail(aoCtx(), [this](auto ex) {
-              try {
-                  std::rethrow_exception(std::move(ex));
-              } catch (const std::exception& e) {
-                  m_requestCtx.log->error("session failed: {}", e.what());
-              }
-              this->finished(false);
-          });
+        const common::FramePoolScope scope(m_framePool);
+        this->run(aoCtx());
     }
 
-    bool isWebSocketRequest() const
+    /**
+     * Ready futures (most handlers finish synchronously) continue inline,
+     * the coroutine is suspended only when a handler or IO really waits.
+     */
+    nhope::Future<void> run(nhope::AOContext& /*aoCtx*/)
+    {
+        bool keepAlive = false;
+        try {
+            try {
+                auto req = co_await receiveRequest(m_requestCtx.aoCtx, m_in);
+                m_received = true;
+                m_ctx.sessionReceivedRequest(m_num);
+
+                bool doHandler = this->prepareRequest(std::move(req));
+                for (auto it = m_middlewares.begin(); doHandler && it != m_middlewares.end(); ++it) {
+                    bool doNext = false;
+                    if (it->isSync()) {
+                        doNext = it->sync()(m_requestCtx);
+                    } else {
+                        doNext = co_await safeCall(m_requestCtx, it->async());
+                    }
+                    doHandler = this->middlewarePassed(doNext);
+                }
+                const auto webSocket = doHandler ? this->isWebSocketRequest() : common::HttpResult<bool>(false);
+                if (!webSocket) {
+                    this->makeResponseFromError(webSocket.error());
+                } else if (doHandler) {
+                    if (*webSocket) {
+                        co_await this->acceptWebSocket();
+                    }
+                    // an offloaded handler is settled by the completion queue, it resumes the session too
+                    auto handled = safeCall(m_requestCtx, m_handler);
+                    co_await common::resumeFrom(m_requestCtx.completions, m_requestCtx.completionOwner.guard(),
+                                                std::move(handled));
+                }
+            } catch (...) {
+                this->makeResponseFromError(std::current_exception());
+            }
+
+            keepAlive = co_await this->sendResponse();
+            if (keepAlive && this->needDrain()) {
+                keepAlive = co_await this->drainRequestBody();
+            }
+        } catch (const std::exception& e) {
+            m_requestCtx.log->error("session failed: {}", e.what());
+            keepAlive = false;
+        }
+        this->finished(keepAlive);
+    }
+
+    common::HttpResult<bool> isWebSocketRequest() const
     {
         if (auto it = m_requestCtx.request.headers.find(ConnectionHeader); it != m_requestCtx.request.headers.end()) {
             if (it->second == "Upgrade"s) {
                 if (auto upgIt = m_requestCtx.request.headers.find("Upgrade"s);
                     upgIt != m_requestCtx.request.headers.end()) {
                     if (upgIt->second == "websocket"s) {
-                        if (m_requestCtx.request.headers.at("Sec-Websocket-Version") != "13"s) {
-                            throw common::HttpError(
-                              common::HttpStatus::BadRequest,
+                        const auto verIt = m_requestCtx.request.headers.find("Sec-Websocket-Version");
+                        if (verIt == m_requestCtx.request.headers.end() || verIt->second != "13"s) {
+                            return HttpError(
+                              HttpStatus::BadRequest,
                               "websocket: unsupported version: 13 not found in 'Sec-Websocket-Version' header");
                         }
                         return true;
@@ -159,52 +296,66 @@ private:
         return false;
     }
 
-    nhope::Future<void> processingRequest(Request&& req)
+    // Returns false if the response is already made
+    bool prepareRequest(Request&& req)
     {
         m_requestCtx.log->trace("request: \"{} {}\"", req.method, req.uri.path);
+        m_requestCtx.request = std::move(req);
 
-        auto routeResult = m_requestCtx.router.route(req.method, req.uri.path);
+        // path params refer to the request path, so route the request stored in the context
+        const auto& request = m_requestCtx.request;
+        auto routeResult = m_requestCtx.router.route(request.method, request.uri.path);
         m_handler = std::move(routeResult.handler);
         m_middlewares = std::move(routeResult.middlewares);
         m_requestCtx.rawPathParams = std::move(routeResult.rawPathParams);
-        m_requestCtx.request = std::move(req);
-
-        return this->doMiddlewares().then(aoCtx(), [this](bool doHandler) {
-            if (!doHandler) {
-                return nhope::makeReadyFuture();
-            }
 
-            // check web socket upgrade
-            if (isWebSocketRequest()) {
-                const auto raw =
-                  WebSocketController::makeHandShake(m_requestCtx.request.headers.at("Sec-Websocket-Key"));
+        if (auto expectation = this->checkExpectation(); !expectation) {
+            this->makeResponseFromError(expectation.error());
+            return false;
+        }
+        return true;
+    }
 
-                return nhope::write(m_out, raw).then(aoCtx(), [this](std::size_t) {
-                    m_requestCtx.webSocket.emplace(aoCtx(), m_in, m_out, m_requestCtx.log);
-                    return safeCall(m_requestCtx, m_handler);
-                });
-            }
+    bool middlewarePassed(bool doNext)
+    {
+        if (m_requestCtx.error.has_value()) {
+            this->makeResponseFromError(*m_requestCtx.error);
+            m_requestCtx.error.reset();
+            return false;
+        }
+        return doNext;
+    }
 
-            return safeCall(m_requestCtx, m_handler);
+    nhope::Future<void> acceptWebSocket()
+    {
+        const auto raw = WebSocketController::makeHandShake(m_requestCtx.request.headers.at("Sec-Websocket-Key"));
+        return nhope::write(m_out, raw).then(aoCtx(), [this](std::size_t) {
+            m_requestCtx.webSocket.emplace(aoCtx(), m_in, m_out, m_requestCtx.log);
         });
     }
 
-    nhope::Future<bool> doMiddlewares()
+    common::HttpResult<void> checkExpectation()
     {
-        if (m_middlewares.empty()) {
-            return nhope::makeReadyFuture<bool>(true);
+        auto& request = m_requestCtx.request;
+        const auto it = request.headers.find(ExpectHeader);
+        if (it == request.headers.end()) {
+            return {};
         }
 
-        const auto& middleware = m_middlewares.front();
-        return safeCall(m_requestCtx, middleware).then(aoCtx(), [this](bool doNext) {
-            assert(!m_middlewares.empty());   // NOLINT
+        if (!common::detail::LowercaseEqual{}(it->second, ExpectContinueValue)) {
+            return HttpError(HttpStatus::ExpectationFailed, fmt::format("unsupported expectation: {}", it->second));
+        }
 
-            m_middlewares.pop_front();
-            if (!doNext) {
-                return nhope::makeReadyFuture<bool>(false);
-            }
-            return this->doMiddlewares();
-        });
+        if (hasBody(request)) {
+            m_expectContinue = ExpectContinue::Pending;
+            request.body = std::make_unique<ContinueReader>(aoCtx(), std::move(request.body), m_out, m_expectContinue);
+        }
+        return {};
+    }
+
+    void makeResponseFromError(const HttpError& e)
+    {
+        m_requestCtx.response = common::makePlainTextResponse(aoCtx(), e.httpStatus(), e.what());
     }
 
     void makeResponseFromError(std::exception_ptr ex)
@@ -212,8 +363,7 @@ private:
         try {
             std::rethrow_exception(std::move(ex));
         } catch (const HttpError& e) {
-            m_requestCtx.response = common::makePlainTextResponse(aoCtx(), e.httpStatus(), e.what());
-
+            this->makeResponseFromError(e);
         } catch (const std::exception& e) {
             m_requestCtx.response = common::makePlainTextResponse(aoCtx(), HttpStatus::InternalServerError, e.what());
         }
@@ -224,6 +374,14 @@ private:
         if (m_ctx.sessionNeedClose()) {
             return true;
         }
+        if (!m_received) {
+            // The request is malformed, the rest of the stream can't be parsed
+            return true;
+        }
+        if (m_expectContinue == ExpectContinue::Pending) {
+            // The client is still waiting for "100 Continue" and may send the body at any moment
+            return true;
+        }
         if (auto it = m_requestCtx.request.headers.find(ConnectionHeader); it != m_requestCtx.request.headers.end()) {
             return it->second == ConnectionHeaderCloseValue;
         }
@@ -236,6 +394,16 @@ private:
             // we don't send response to web socket
             return nhope::makeReadyFuture<bool>(false);
         }
+        if (m_expectContinue == ExpectContinue::Pending && m_requestCtx.request.body == nullptr &&
+            m_requestCtx.response.body != nullptr) {
+            // The handler has passed the request body to the response, it is read only after the head is written,
+            // so "100 Continue" has to precede the final head
+            m_expectContinue = ExpectContinue::Sent;
+            return nhope::write(m_out, std::string(ContinueResponse)).then(aoCtx(), [this](std::size_t /*unused*/) {
+                return this->sendResponse();
+            });
+        }
+
         m_requestCtx.log->trace("response: {}", m_requestCtx.response.status);
         const bool needAddClose = needClose();
         if (needAddClose) {
@@ -250,6 +418,57 @@ private:
           });
     }
 
+    /**
+     * The next request on the connection starts right behind the body of the current one.
+     * If nobody has read the body, skip it to keep the connection alive.
+     */
+    bool needDrain() const
+    {
+        // the body may have been taken by the handler (e.g. sent back as response body)
+        return hasBody(m_requestCtx.request);
+    }
+
+    nhope::Future<bool> drainRequestBody()
+    {
+        if (const auto size = contentLength(m_requestCtx.request); size.has_value() && *size > m_maxDrainBodySize) {
+            m_requestCtx.log->trace("unread request body is too large, close the connection");
+            return nhope::makeReadyFuture<bool>(false);
+        }
+
+        m_drainBuf = m_ctx.drainBuffer();
+        this->discardNextBodyPortion();
+        return m_drainPromise.future();
+    }
+
+    void discardNextBodyPortion()
+    {
+        // BodyReader calls the handler in the session context
+        m_requestCtx.request.body->read(m_drainBuf, [this](std::exception_ptr err, std::size_t n) {
+            if (err) {
+                m_requestCtx.log->trace("failed to drain request body");
+                m_drainPromise.setValue(false);
+                return;
+            }
+
+            if (n == 0) {
+                if (m_drainedSize > 0) {
+                    m_requestCtx.log->trace("unread request body drained: {} bytes", m_drainedSize);
+                }
+                m_drainPromise.setValue(true);
+                return;
+            }
+
+            m_drainedSize += n;
+            if (m_drainedSize > m_maxDrainBodySize) {
+                m_requestCtx.log->trace("unread request body is too large, close the connection");
+                m_drainPromise.setValue(false);
+                return;
+            }
+
+            this->discardNextBodyPortion();
+        });
+    }
+
     void finished(bool keepAlive)
     {
         assert(!m_finished);   // NOLINT
@@ -275,7 +494,15 @@ private:
     nhope::PushbackReader& m_in;
     nhope::Writter& m_out;
 
+    const std::size_t m_maxDrainBodySize;
+    std::size_t m_drainedSize = 0;
+    gsl::span<std::uint8_t> m_drainBuf;
+    nhope::Promise<bool> m_drainPromise;
+
+    common::FramePoolPtr m_framePool;
     bool m_finished = false;
+    bool m_received = false;
+    ExpectContinue m_expectContinue = ExpectContinue::None;
 
     LowLevelHandler m_handler;
     std::list<Middleware> m_middlewares;
@@ -288,6 +515,7 @@ private:
 
 void startSession(nhope::AOContext& aoCtx, SessionParams&& param)
 {
+    const common::FramePoolScope scope(param.framePool);
     new Session(aoCtx, std::move(param));
 }
 
@@ -0,0 +1,154 @@
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include "nhope/io/io-device.h"
+
+#include "royalbed/common/traffic-log.h"
+#include "royalbed/server/middleware.h"
+#include "royalbed/server/request-context.h"
+#include "royalbed/server/traffic-capture.h"
+
+namespace royalbed::server {
+
+namespace {
+
+std::optional<std::size_t> contentLength(const Request& request)
+{
+    if (request.headers.contains("Transfer-Encoding")) {
+        return std::nullopt;
+    }
+    const auto it = request.headers.find("Content-Length");
+    if (it == request.headers.end()) {
+        return 0;
+    }
+
+    std::size_t size = 0;
+    const auto& value = it->second;
+    const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), size);
+    if (ec != std::errc() || ptr != value.data() + value.size()) {
+        return std::nullopt;
+    }
+    return size;
+}
+
+common::CapturedRequest captureHead(const common::TrafficLogWriter& log, const Request& request)
+{
+    return common::CapturedRequest{
+      .time = log.elapsed(),
+      .method = request.method,
+      .target = request.uri.toString(),
+      .headers = request.headers,
+      .bodyCaptured = true,
+      .body{},
+    };
+}
+
+/**
+ * Passes the body to the handler and records it on the way, so the body is not read ahead of the handler
+ * (and "100 Continue" is not sent for a request the handler rejects). The request is written to the log
+ * when the body is read to the end. A body that is not read through or is over the limit is not recorded,
+ * the head is written when the reader is destroyed.
+ */
+class CaptureReader final : public nhope::Reader
+{
+public:
+    CaptureReader(nhope::ReaderPtr body, common::TrafficLogWriterPtr log, common::CapturedRequest captured,
+                  std::size_t maxBodySize)
+      : m_body(std::move(body))
+      , m_log(std::move(log))
+      , m_captured(std::move(captured))
+      , m_maxBodySize(maxBodySize)
+    {}
+
+    ~CaptureReader() override
+    {
+        if (!m_written) {
+            m_captured.bodyCaptured = false;
+            m_captured.body.clear();
+            this->writeRecord();
+        }
+    }
+
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+
+    void read(gsl::span<std::uint8_t> buf, nhope::IOHandler handler) override
+    {
+        m_body->read(buf, [this, buf, handler = std::move(handler)](std::exception_ptr err, std::size_t n) mutable {
+            if (!err) {
+                this->capture(buf.first(n));
+            }
+            handler(std::move(err), n);
+        });
+    }
+
+private:
+    void capture(gsl::span<const std::uint8_t> data)
+    {
+        if (m_written) {
+            return;
+        }
+        if (data.empty()) {
+            // the end of the body
+            this->writeRecord();
+            return;
+        }
+        if (!m_captured.bodyCaptured) {
+            return;
+        }
+        if (m_captured.body.size() + data.size() > m_maxBodySize) {
+            m_captured.bodyCaptured = false;
+            m_captured.body.clear();
+            return;
+        }
+        m_captured.body.append(data.begin(), data.end());
+    }
+
+    void writeRecord() noexcept
+    {
+        m_written = true;
+        try {
+            m_log->write(m_captured);
+        } catch (...) {
+            // the capture must not break the request
+        }
+    }
+
+    nhope::ReaderPtr m_body;
+    common::TrafficLogWriterPtr m_log;
+    common::CapturedRequest m_captured;
+    const std::size_t m_maxBodySize;
+    bool m_written = false;
+};
+
+}   // namespace
+
+Middleware captureTraffic(TrafficCaptureParams params)
+{
+    return [params = std::move(params)](RequestContext& ctx) {
+        auto captured = captureHead(*params.log, ctx.request);
+
+        const auto bodySize = contentLength(ctx.request);
+        if (ctx.request.body == nullptr || bodySize == 0U) {
+            params.log->write(captured);
+            return true;
+        }
+        if (bodySize.has_value() && *bodySize > params.maxBodySize) {
+            captured.bodyCaptured = false;
+        }
+
+        ctx.request.body = std::make_unique<CaptureReader>(std::move(ctx.request.body), params.log,
+                                                           std::move(captured), params.maxBodySize);
+        return true;
+    };
+}
+
+}   // namespace royalbed::server
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "royalbed/server/worker-pool.h"
+
+namespace royalbed::server {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+class WorkerPoolImpl final : public WorkerPool
+{
+public:
+    explicit WorkerPoolImpl(const WorkerPoolParams& params)
+      : m_maxQueueSize(params.maxQueueSize)
+    {
+        const auto threadCount = std::max<std::size_t>(params.threadCount, 1);
+        m_threads.reserve(threadCount);
+        for (std::size_t i = 0; i < threadCount; ++i) {
+            m_threads.emplace_back([this] {
+                this->work();
+            });
+        }
+    }
+
+    ~WorkerPoolImpl() override
+    {
+        {
+            std::scoped_lock lock(m_mutex);
+            m_stopped = true;
+        }
+        m_cv.notify_all();
+        for (auto& th : m_threads) {
+            th.join();
+        }
+    }
+
+    bool post(std::function<void()> task) override
+    {
+        assert(task != nullptr);   // NOLINT
+        {
+            std::scoped_lock lock(m_mutex);
+            if (m_queue.size() >= m_maxQueueSize) {
+                ++m_stats.rejectedTasks;
+                return false;
+            }
+            m_queue.push_back({std::move(task), Clock::now()});
+        }
+        m_cv.notify_one();
+        return true;
+    }
+
+    [[nodiscard]] WorkerPoolStats stats() const override
+    {
+        std::scoped_lock lock(m_mutex);
+        auto stats = m_stats;
+        stats.queueDepth = m_queue.size();
+        return stats;
+    }
+
+private:
+    struct Task
+    {
+        std::function<void()> fn;
+        Clock::time_point enqueuedAt;
+    };
+
+    void work()
+    {
+        std::unique_lock lock(m_mutex);
+        for (;;) {
+            m_cv.wait(lock, [this] {
+                return m_stopped || !m_queue.empty();
+            });
+            if (m_queue.empty()) {
+                // stopped, the queued tasks are done
+                return;
+            }
+
+            auto task = std::move(m_queue.front());
+            m_queue.pop_front();
+
+            const auto wait = Clock::now() - task.enqueuedAt;
+            m_stats.lastWaitTime = wait;
+            m_stats.maxWaitTime = std::max<std::chrono::nanoseconds>(m_stats.maxWaitTime, wait);
+            m_stats.totalWaitTime += wait;
+            ++m_stats.activeTasks;
+
+            lock.unlock();
+            task.fn();
+            task.fn = nullptr;
+            lock.lock();
+
+            --m_stats.activeTasks;
+            ++m_stats.completedTasks;
+        }
+    }
+
+    const std::size_t m_maxQueueSize;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Task> m_queue;
+    WorkerPoolStats m_stats;
+    bool m_stopped = false;
+
+    std::vector<std::thread> m_threads;
+};
+
+}   // namespace
+
+WorkerPoolPtr WorkerPool::create(WorkerPoolParams params)
+{
+    return std::make_shared<WorkerPoolImpl>(params);
+}
+
+}   // namespace royalbed::server
@@ -1,16 +1,23 @@
+#include <algorithm>
 #include <array>
+#include <bit>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <iterator>
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string_view>
 #include <string>
 #include <utility>
 
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 #include <fmt/format.h>
 
-#include "nhope/utils/hex.h"
 #include "royalbed/common/uri.h"
 
 namespace royalbed::common {
@@ -18,87 +25,234 @@ namespace royalbed::common {
 namespace {
 using namespace std::literals;
 
-bool isAllowedSymbol(char ch, UriEscapeMode mode)
+enum class SymbolClass : std::uint8_t
 {
-    if (ch >= '0' && ch <= '9') {
-        return true;
+    Allowed,
+    Percent,
+    Plus,
+    Other,
+};
+
+using SymbolTable = std::array<SymbolClass, 256>;
+
+constexpr SymbolTable makeSymbolTable(UriEscapeMode mode)
+{
+    SymbolTable table{};
+    for (auto& cls : table) {
+        cls = SymbolClass::Other;
+    }
+    for (int ch = '0'; ch <= '9'; ++ch) {
+        table[ch] = SymbolClass::Allowed;
     }
-    if (ch >= 'A' && ch <= 'Z') {
-        return true;
+    for (int ch = 'A'; ch <= 'Z'; ++ch) {
+        table[ch] = SymbolClass::Allowed;
     }
-    if (ch >= 'a' && ch <= 'z') {
-        return true;
+    for (int ch = 'a'; ch <= 'z'; ++ch) {
+        table[ch] = SymbolClass::Allowed;
     }
-    if (ch == '-' || ch == '_' || ch == '.' || ch == '~') {
-        return true;
+    for (const char ch : "-_.~"sv) {
+        table[static_cast<std::uint8_t>(ch)] = SymbolClass::Allowed;
     }
-    if (ch == '/' && mode == UriEscapeMode::Path) {
-        return true;
+    if (mode == UriEscapeMode::Path) {
+        table['/'] = SymbolClass::Allowed;
     }
-    return false;
+    if (mode == UriEscapeMode::Query) {
+        table['+'] = SymbolClass::Plus;
+    }
+    table['%'] = SymbolClass::Percent;
+    return table;
 }
 
-std::string_view tail(std::string_view in, std::size_t offset)
-{
-    return offset < in.size() ? in.substr(offset) : std::string_view{};
-}
+constexpr std::array symbolTables{
+  makeSymbolTable(UriEscapeMode::Other),
+  makeSymbolTable(UriEscapeMode::Query),
+  makeSymbolTable(UriEscapeMode::Path),
+};
 
-std::string_view parsePath(std::string& out, std::string_view in)
+const SymbolTable& symbolTable(UriEscapeMode mode)
 {
-    const auto pathEnd = in.find_first_of("?#"sv);
-    uriUnescape(out, in.substr(0, pathEnd), UriEscapeMode::Path);
-    return tail(in, pathEnd);
+    return symbolTables[static_cast<std::size_t>(mode)];
 }
 
-void appendQueryParam(Uri::Query& out, std::string_view name, std::string_view value = std::string_view{})
-{
-    if (name.empty()) {
-        // name is empty, ignore it
-        return;
+constexpr std::uint8_t invalidHexDigit = 0xff;
+
+constexpr std::array<std::uint8_t, 256> hexDigits = [] {
+    std::array<std::uint8_t, 256> table{};
+    for (auto& digit : table) {
+        digit = invalidHexDigit;
+    }
+    for (int i = 0; i < 10; ++i) {
+        table['0' + i] = static_cast<std::uint8_t>(i);
+    }
+    for (int i = 0; i < 6; ++i) {
+        table['a' + i] = static_cast<std::uint8_t>(10 + i);
+        table['A' + i] = static_cast<std::uint8_t>(10 + i);
     }
+    return table;
+}();
 
-    try {
-        auto& p = out.emplace_back();
-        uriUnescape(p.first, name, UriEscapeMode::Query);
-        uriUnescape(p.second, value, UriEscapeMode::Query);
-    } catch (...) {
-        out.pop_back();
-        throw;
+#if defined(__AVX2__)
+
+std::size_t vectorAllowedPrefix(const char* data, std::size_t size, UriEscapeMode mode)
+{
+    constexpr std::size_t width = 32;
+
+    const auto digitLo = _mm256_set1_epi8('0' - 1);
+    const auto digitHi = _mm256_set1_epi8('9' + 1);
+    const auto alphaLo = _mm256_set1_epi8('a' - 1);
+    const auto alphaHi = _mm256_set1_epi8('z' + 1);
+    const auto lowerBit = _mm256_set1_epi8(0x20);
+    const auto slash = _mm256_set1_epi8(mode == UriEscapeMode::Path ? '/' : '-');
+
+    std::size_t pos = 0;
+    for (; pos + width <= size; pos += width) {
+        const auto ch = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));   // NOLINT
+        // bytes >= 0x80 are negative and fail the range checks
+        const auto digit = _mm256_and_si256(_mm256_cmpgt_epi8(ch, digitLo), _mm256_cmpgt_epi8(digitHi, ch));
+        const auto lower = _mm256_or_si256(ch, lowerBit);
+        const auto alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, alphaLo), _mm256_cmpgt_epi8(alphaHi, lower));
+        auto allowed = _mm256_or_si256(digit, alpha);
+        allowed = _mm256_or_si256(allowed, _mm256_cmpeq_epi8(ch, _mm256_set1_epi8('-')));
+        allowed = _mm256_or_si256(allowed, _mm256_cmpeq_epi8(ch, _mm256_set1_epi8('_')));
+        allowed = _mm256_or_si256(allowed, _mm256_cmpeq_epi8(ch, _mm256_set1_epi8('.')));
+        allowed = _mm256_or_si256(allowed, _mm256_cmpeq_epi8(ch, _mm256_set1_epi8('~')));
+        allowed = _mm256_or_si256(allowed, _mm256_cmpeq_epi8(ch, slash));
+
+        const auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(allowed));
+        if (mask != 0xffffffffU) {
+            return pos + static_cast<std::size_t>(std::countr_one(mask));
+        }
     }
+    return pos;
 }
 
-std::string_view parseQueryParam(Uri::Query& out, std::string_view in)
+#elif defined(__SSE2__)
+
+std::size_t vectorAllowedPrefix(const char* data, std::size_t size, UriEscapeMode mode)
 {
-    const auto nameEnd = in.find_first_of("=&"sv);
-    const auto name = in.substr(0, nameEnd);
-    if (nameEnd == std::string_view::npos) {
-        appendQueryParam(out, name);
-        return std::string_view{};
+    constexpr std::size_t width = 16;
+
+    const auto digitLo = _mm_set1_epi8('0' - 1);
+    const auto digitHi = _mm_set1_epi8('9' + 1);
+    const auto alphaLo = _mm_set1_epi8('a' - 1);
+    const auto alphaHi = _mm_set1_epi8('z' + 1);
+    const auto lowerBit = _mm_set1_epi8(0x20);
+    const auto slash = _mm_set1_epi8(mode == UriEscapeMode::Path ? '/' : '-');
+
+    std::size_t pos = 0;
+    for (; pos + width <= size; pos += width) {
+        const auto ch = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));   // NOLINT
+        // bytes >= 0x80 are negative and fail the range checks
+        const auto digit = _mm_and_si128(_mm_cmpgt_epi8(ch, digitLo), _mm_cmplt_epi8(ch, digitHi));
+        const auto lower = _mm_or_si128(ch, lowerBit);
+        const auto alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, alphaLo), _mm_cmplt_epi8(lower, alphaHi));
+        auto allowed = _mm_or_si128(digit, alpha);
+        allowed = _mm_or_si128(allowed, _mm_cmpeq_epi8(ch, _mm_set1_epi8('-')));
+        allowed = _mm_or_si128(allowed, _mm_cmpeq_epi8(ch, _mm_set1_epi8('_')));
+        allowed = _mm_or_si128(allowed, _mm_cmpeq_epi8(ch, _mm_set1_epi8('.')));
+        allowed = _mm_or_si128(allowed, _mm_cmpeq_epi8(ch, _mm_set1_epi8('~')));
+        allowed = _mm_or_si128(allowed, _mm_cmpeq_epi8(ch, slash));
+
+        const auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(allowed));
+        if (mask != 0xffffU) {
+            return pos + static_cast<std::size_t>(std::countr_one(mask));
+        }
     }
+    return pos;
+}
+
+#else
+
+std::size_t vectorAllowedPrefix(const char* /*data*/, std::size_t /*size*/, UriEscapeMode /*mode*/)
+{
+    return 0;
+}
 
-    in = tail(in, nameEnd + 1);
+#endif
 
-    const auto valueEnd = in.find_first_of("&#"sv);
-    const auto value = in.substr(0, valueEnd);
-    appendQueryParam(out, name, value);
+// Returns the length of the longest prefix of allowed symbols
+std::size_t allowedPrefix(std::string_view in, UriEscapeMode mode)
+{
+    auto pos = vectorAllowedPrefix(in.data(), in.size(), mode);
 
-    if (valueEnd == std::string_view::npos) {
-        return std::string_view{};
+    const auto& table = symbolTable(mode);
+    while (pos < in.size() && table[static_cast<std::uint8_t>(in[pos])] == SymbolClass::Allowed) {
+        ++pos;
     }
+    return pos;
+}
 
-    return tail(in, valueEnd + 1);
+std::string_view tail(std::string_view in, std::size_t offset)
+{
+    return offset < in.size() ? in.substr(offset) : std::string_view{};
 }
 
-std::string_view parseQuery(Uri::Query& out, std::string_view in)
+std::string_view parsePath(std::string& out, std::string_view in)
 {
-    auto strQuery = in.substr(0, in.find('#'));
-    const auto queryLen = strQuery.size();
+    const auto pathEnd = in.find_first_of("?#"sv);
+    uriUnescape(out, in.substr(0, pathEnd), UriEscapeMode::Path);
+    return tail(in, pathEnd);
+}
 
-    while (!strQuery.empty()) {
-        strQuery = parseQueryParam(out, strQuery);
+// Returns the reason if the string is malformed, `out` is left unchanged in that case
+const char* unescape(std::string& out, std::string_view in, UriEscapeMode mode)
+{
+    // the string is shrunk to the actual size at the end
+    const auto offset = out.size();
+    out.resize(offset + in.size());
+    auto* dst = out.data() + offset;
+
+    const auto& table = symbolTable(mode);
+    std::size_t pos = 0;
+    while (pos < in.size()) {
+        const auto allowed = allowedPrefix(tail(in, pos), mode);
+        std::copy_n(in.data() + pos, allowed, dst);
+        dst += allowed;
+        pos += allowed;
+
+        // decode the run of the escaped symbols
+        while (pos < in.size()) {
+            const auto cls = table[static_cast<std::uint8_t>(in[pos])];
+            if (cls == SymbolClass::Percent) {
+                if (in.size() - pos < 3) {
+                    out.resize(offset);
+                    return "Incomplete hex escape sequence";
+                }
+                const auto hi = hexDigits[static_cast<std::uint8_t>(in[pos + 1])];
+                const auto lo = hexDigits[static_cast<std::uint8_t>(in[pos + 2])];
+                if (hi == invalidHexDigit || lo == invalidHexDigit) {
+                    out.resize(offset);
+                    return "Invalid escape sequence";
+                }
+                *dst++ = static_cast<char>((hi << 4) | lo);
+                pos += 3;
+            } else if (cls == SymbolClass::Plus) {
+                *dst++ = ' ';
+                ++pos;
+            } else if (cls == SymbolClass::Allowed) {
+                break;
+            } else {
+                out.resize(offset);
+                return "Invalid symbol";
+            }
+        }
     }
 
-    return tail(in, queryLen);
+    out.resize(static_cast<std::size_t>(dst - out.data()));
+    return nullptr;
+}
+
+// Returns true if the string has symbols to unescape (or invalid ones, unescape() reports them)
+bool hasEscapes(std::string_view in, UriEscapeMode mode)
+{
+    return allowedPrefix(in, mode) < in.size();
+}
+
+std::string_view parseQuery(Uri::Query& out, std::string_view in)
+{
+    const auto strQuery = in.substr(0, in.find('#'));
+    out = Uri::Query::parse(strQuery);
+    return tail(in, strQuery.size());
 }
 
 void parseFragment(std::string& out, std::string_view in)
@@ -124,6 +278,206 @@ UriParseError::UriParseError(std::string_view msg)
   : std::runtime_error(fmt::format("UriParseError: {}", msg))
 {}
 
+UriQuery::UriQuery(std::initializer_list<Param> params)
+{
+    m_params.reserve(params.size());
+    for (const auto& [name, value] : params) {
+        this->add(name, value);
+    }
+}
+
+UriQuery UriQuery::parse(std::string_view encoded)
+{
+    UriQuery retval;
+    retval.m_buffer = encoded;
+    retval.m_encodedSize = static_cast<std::uint32_t>(encoded.size());
+    retval.m_parsed = encoded.empty();
+    return retval;
+}
+
+bool UriQuery::empty() const
+{
+    this->parseIfNeeded();
+    return m_params.empty();
+}
+
+std::size_t UriQuery::size() const
+{
+    this->parseIfNeeded();
+    return m_params.size();
+}
+
+UriQuery::Param UriQuery::operator[](std::size_t index) const
+{
+    this->parseIfNeeded();
+    const auto& [name, value] = m_params[index];
+    return {this->view(name), this->view(value)};
+}
+
+std::optional<std::string_view> UriQuery::find(std::string_view name) const
+{
+    this->parseIfNeeded();
+
+    if (m_params.size() < indexThreshold) {
+        for (const auto& [namePiece, valuePiece] : m_params) {
+            if (this->view(namePiece) == name) {
+                return this->view(valuePiece);
+            }
+        }
+        return std::nullopt;
+    }
+
+    if (m_index.empty()) {
+        this->buildIndex();
+    }
+
+    const auto mask = m_index.size() - 1;
+    for (auto pos = std::hash<std::string_view>{}(name)&mask;; pos = (pos + 1) & mask) {
+        const auto slot = m_index[pos];
+        if (slot == 0) {
+            return std::nullopt;
+        }
+        const auto& [namePiece, valuePiece] = m_params[slot - 1];
+        if (this->view(namePiece) == name) {
+            return this->view(valuePiece);
+        }
+    }
+}
+
+void UriQuery::add(std::string_view name, std::string_view value)
+{
+    this->parseIfNeeded();
+
+    const auto namePiece = this->append(name);
+    const auto valuePiece = this->append(value);
+    m_params.emplace_back(namePiece, valuePiece);
+
+    // the index will be rebuilt by the next lookup
+    m_index.clear();
+}
+
+UriQuery::Iterator UriQuery::begin() const
+{
+    return {this, 0};
+}
+
+UriQuery::Iterator UriQuery::end() const
+{
+    return {this, this->size()};
+}
+
+bool UriQuery::operator==(const UriQuery& other) const
+{
+    return std::equal(this->begin(), this->end(), other.begin(), other.end());
+}
+
+void UriQuery::parseIfNeeded() const
+{
+    if (const auto error = this->tryParse()) {
+        throw UriParseError(*error);
+    }
+}
+
+std::optional<std::string_view> UriQuery::tryParse() const
+{
+    if (m_parsed) {
+        return std::nullopt;
+    }
+
+    // Unescaped names and values are appended to the buffer and never exceed the encoded string,
+    // so `encoded` stays valid while parsing
+    m_buffer.reserve(2 * static_cast<std::size_t>(m_encodedSize));
+    const auto encoded = std::string_view(m_buffer).substr(0, m_encodedSize);
+
+    const char* error = nullptr;
+    const auto piece = [this, encoded, &error](std::string_view part) {
+        if (part.empty() || error != nullptr) {
+            return Piece{0, 0};
+        }
+        if (!hasEscapes(part, UriEscapeMode::Query)) {
+            const auto offset = static_cast<std::size_t>(part.data() - encoded.data());
+            return Piece{static_cast<std::uint32_t>(offset), static_cast<std::uint32_t>(part.size())};
+        }
+        const auto offset = m_buffer.size();
+        error = unescape(m_buffer, part, UriEscapeMode::Query);
+        return Piece{static_cast<std::uint32_t>(offset), static_cast<std::uint32_t>(m_buffer.size() - offset)};
+    };
+
+    std::vector<std::pair<Piece, Piece>> params;
+    params.reserve(static_cast<std::size_t>(std::count(encoded.begin(), encoded.end(), '&')) + 1);
+
+    auto in = encoded;
+    while (!in.empty() && error == nullptr) {
+        const auto nameEnd = in.find_first_of("=&"sv);
+        const auto name = in.substr(0, nameEnd);
+
+        std::string_view value;
+        if (nameEnd == std::string_view::npos) {
+            in = std::string_view{};
+        } else if (in[nameEnd] == '&') {
+            in = tail(in, nameEnd + 1);
+        } else {
+            in = tail(in, nameEnd + 1);
+            const auto valueEnd = in.find('&');
+            value = in.substr(0, valueEnd);
+            in = valueEnd == std::string_view::npos ? std::string_view{} : tail(in, valueEnd + 1);
+        }
+
+        if (name.empty()) {
+            // name is empty, ignore it
+            continue;
+        }
+
+        const auto namePiece = piece(name);
+        const auto valuePiece = piece(value);
+        params.emplace_back(namePiece, valuePiece);
+    }
+
+    if (error != nullptr) {
+        // the query stays unparsed, the next access reports it again
+        m_buffer.resize(m_encodedSize);
+        return error;
+    }
+
+    m_params = std::move(params);
+    m_parsed = true;
+    return std::nullopt;
+}
+
+void UriQuery::buildIndex() const
+{
+    // load factor <= 0.5
+    m_index.assign(std::bit_ceil(2 * m_params.size()), 0);
+
+    const auto mask = m_index.size() - 1;
+    for (std::size_t i = 0; i < m_params.size(); ++i) {
+        const auto name = this->view(m_params[i].first);
+        for (auto pos = std::hash<std::string_view>{}(name)&mask;; pos = (pos + 1) & mask) {
+            auto& slot = m_index[pos];
+            if (slot == 0) {
+                slot = static_cast<std::uint32_t>(i + 1);
+                break;
+            }
+            if (this->view(m_params[slot - 1].first) == name) {
+                // find() returns the first parameter with the name
+                break;
+            }
+        }
+    }
+}
+
+std::string_view UriQuery::view(Piece piece) const noexcept
+{
+    return std::string_view(m_buffer).substr(piece.offset, piece.size);
+}
+
+UriQuery::Piece UriQuery::append(std::string_view str)
+{
+    const auto offset = m_buffer.size();
+    m_buffer += str;
+    return {static_cast<std::uint32_t>(offset), static_cast<std::uint32_t>(str.size())};
+}
+
 bool Uri::isRelative() const noexcept
 {
     return this->host.empty();
@@ -224,19 +578,38 @@ Uri Uri::parse(std::string_view uri)
 
 void uriEscape(std::string& out, std::string_view in, UriEscapeMode mode)
 {
-    out.reserve(out.size() + in.size() + 3 * in.size() / 4);
-    for (const char ch : in) {
-        if (isAllowedSymbol(ch, mode)) {
-            out += ch;
-        } else if (ch == ' ' && mode == UriEscapeMode::Query) {
-            out.push_back('+');
-        } else {
-            constexpr auto hex = "0123456789abcdef"sv;
-            const auto b = static_cast<std::uint8_t>(ch);
-            const auto esc = std::array{'%', hex[b >> 4], hex[b & 0x0f]};
-            out.append(esc.data(), esc.size());
+    constexpr auto hex = "0123456789abcdef"sv;
+
+    // the worst case is 3 bytes per symbol, the string is shrunk to the actual size at the end
+    const auto offset = out.size();
+    out.resize(offset + 3 * in.size());
+    auto* dst = out.data() + offset;
+
+    const auto& table = symbolTable(mode);
+    std::size_t pos = 0;
+    while (pos < in.size()) {
+        const auto allowed = allowedPrefix(tail(in, pos), mode);
+        std::copy_n(in.data() + pos, allowed, dst);
+        dst += allowed;
+        pos += allowed;
+
+        // escape the run of the other symbols
+        for (; pos < in.size(); ++pos) {
+            const auto b = static_cast<std::uint8_t>(in[pos]);
+            if (table[b] == SymbolClass::Allowed) {
+                break;
+            }
+            if (b == ' ' && mode == UriEscapeMode::Query) {
+                *dst++ = '+';
+            } else {
+                *dst++ = '%';
+                *dst++ = hex[b >> 4];
+                *dst++ = hex[b & 0x0f];
+            }
         }
     }
+
+    out.resize(static_cast<std::size_t>(dst - out.data()));
 }
 
 std::string uriEscape(std::string_view in, UriEscapeMode mode)
@@ -248,35 +621,8 @@ std::string uriEscape(std::string_view in, UriEscapeMode mode)
 
 void uriUnescape(std::string& out, std::string_view in, UriEscapeMode mode)
 {
-    try {
-        out.reserve(out.size() + in.size());
-
-        for (auto it = in.begin(); it != in.end(); ++it) {
-            if (*it == '%') {
-                if (std::distance(it, in.end()) < 3) {
-                    throw UriParseError("Incomplete hex escape sequence");
-                }
-                const auto hi = *++it;
-                const auto lo = *++it;
-                const auto byte = nhope::fromHex(hi, lo);
-                out += static_cast<char>(byte);
-                continue;
-            }
-
-            if (*it == '+' && mode == UriEscapeMode::Query) {
-                out += ' ';
-                continue;
-            }
-
-            if (isAllowedSymbol(*it, mode)) {
-                out += *it;
-                continue;
-            }
-
-            throw UriParseError("Invalid symbol");
-        }
-    } catch (const nhope::HexParseError& ex) {
-        throw UriParseError("Invalid escape sequence");
+    if (const auto* error = unescape(out, in, mode)) {
+        throw UriParseError(error);
     }
 }
 
@@ -0,0 +1,114 @@
+#include <chrono>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "royalbed/client/circuit-breaker.h"
+
+namespace {
+
+using namespace royalbed::client;
+using namespace std::literals;
+
+void call(CircuitBreaker& breaker, bool failed)
+{
+    breaker.release(breaker.acquire(), failed);
+}
+
+}   // namespace
+
+TEST(CircuitBreaker, OpenOnFailureRate)   // NOLINT
+{
+    CircuitBreaker breaker({.windowSize = 10, .minimumCalls = 4, .failureRateThreshold = 0.5});
+
+    call(breaker, true);
+    call(breaker, true);
+    call(breaker, true);
+    EXPECT_EQ(breaker.metrics().state, CircuitState::Closed);
+
+    call(breaker, false);
+    EXPECT_EQ(breaker.metrics().state, CircuitState::Open);
+    EXPECT_THROW((void)breaker.acquire(), CircuitOpenError);   // NOLINT
+    EXPECT_THROW((void)breaker.acquire(), CircuitOpenError);   // NOLINT
+
+    const auto metrics = breaker.metrics();
+    EXPECT_EQ(metrics.rejectedCalls, 2);
+    EXPECT_EQ(metrics.openCount, 1);
+}
+
+TEST(CircuitBreaker, SlidingWindow)   // NOLINT
+{
+    CircuitBreaker breaker({.windowSize = 4, .minimumCalls = 4, .failureRateThreshold = 0.5});
+
+    // the old failures leave the window
+    call(breaker, true);
+    for (int i = 0; i < 10; ++i) {
+        call(breaker, false);
+    }
+    call(breaker, true);
+    EXPECT_EQ(breaker.metrics().state, CircuitState::Closed);
+    EXPECT_EQ(breaker.metrics().calls, 4);
+    EXPECT_EQ(breaker.metrics().failedCalls, 1);
+}
+
+TEST(CircuitBreaker, SlowCalls)   // NOLINT
+{
+    CircuitBreaker breaker({
+      .windowSize = 2,
+      .minimumCalls = 2,
+      .slowCallRateThreshold = 0.5,
+      .slowCallDuration = 10ms,
+    });
+
+    auto permit = breaker.acquire();
+    std::this_thread::sleep_for(20ms);
+    breaker.release(permit, false);
+    call(breaker, false);
+    EXPECT_EQ(breaker.metrics().state, CircuitState::Open);
+}
+
+TEST(CircuitBreaker, HalfOpen)   // NOLINT
+{
+    CircuitBreaker breaker({
+      .windowSize = 2,
+      .minimumCalls = 2,
+      .openDuration = 0ns,
+      .halfOpenCalls = 2,
+    });
+
+    call(breaker, true);
+    call(breaker, true);
+    EXPECT_EQ(breaker.metrics().state, CircuitState::Open);
+
+    // a failed trial opens the circuit again
+    call(breaker, true);
+    EXPECT_EQ(breaker.metrics().state, CircuitState::Open);
+    EXPECT_EQ(breaker.metrics().openCount, 2);
+
+    // no more trials than given until they are finished
+    const auto first = breaker.acquire();
+    const auto second = breaker.acquire();
+    EXPECT_EQ(breaker.metrics().state, CircuitState::HalfOpen);
+    EXPECT_THROW((void)breaker.acquire(), CircuitOpenError);   // NOLINT
+
+    breaker.release(first, false);
+    breaker.release(second, false);
+    EXPECT_EQ(breaker.metrics().state, CircuitState::Closed);
+}
+
+TEST(CircuitBreaker, StaleResults)   // NOLINT
+{
+    CircuitBreaker breaker({.windowSize = 2, .minimumCalls = 2, .openDuration = 0ns, .halfOpenCalls = 1});
+
+    // started while closed, finished while half-open
+    const auto stale = breaker.acquire();
+    call(breaker, true);
+    call(breaker, true);
+
+    const auto trial = breaker.acquire();
+    breaker.release(stale, true);
+    EXPECT_EQ(breaker.metrics().state, CircuitState::HalfOpen);
+
+    breaker.release(trial, false);
+    EXPECT_EQ(breaker.metrics().state, CircuitState::Closed);
+}
@@ -0,0 +1,513 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "fmt/core.h"
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nhope/async/thread-executor.h"
+#include "nhope/async/timer.h"
+#include "nhope/io/io-device.h"
+#include "nhope/io/string-reader.h"
+
+#include "royalbed/client/client-pool.h"
+#include "royalbed/server/http-status.h"
+#include "royalbed/server/router.h"
+
+#include "helpers/bytes.h"
+#include "helpers/invoke.h"
+#include "helpers/memory-server.h"
+
+namespace {
+
+using namespace royalbed;
+
+// The body of the response arrives in a second after its headers
+class LateBody final : public nhope::Reader
+{
+public:
+    static constexpr std::string_view content = "late";
+
+    explicit LateBody(nhope::AOContext& parent)
+      : m_aoCtx(parent)
+    {}
+
+    void read(gsl::span<std::uint8_t> buf, nhope::IOHandler handler) override
+    {
+        if (std::exchange(m_sent, true)) {
+            handler(nullptr, 0);
+            return;
+        }
+        nhope::setTimeout(m_aoCtx, std::chrono::seconds(1), [buf, handler](auto) {
+            const auto n = std::min(buf.size(), content.size());
+            std::copy_n(content.begin(), n, buf.begin());
+            handler(nullptr, n);
+        });
+    }
+
+private:
+    nhope::AOContext m_aoCtx;
+    bool m_sent = false;
+};
+
+// In-process server with the routes of the pool tests
+struct TestServer
+{
+    explicit TestServer(nhope::AOContext& aoCtx)
+      : backend(aoCtx, [this] {
+          return routes();
+      })
+    {}
+
+    server::Router routes()
+    {
+        auto router = server::Router();
+        router.get("/ping/:n", [](server::RequestContext& ctx) {
+            ctx.response.status = server::HttpStatus::Ok;
+            ctx.response.body = nhope::StringReader::create(ctx.aoCtx, std::string(ctx.rawPathParams.front().second));
+            return nhope::makeReadyFuture();
+        });
+        router.get("/large/:size", [](server::RequestContext& ctx) {
+            const auto size = std::stoul(std::string(ctx.rawPathParams.front().second));
+            ctx.response.status = server::HttpStatus::Ok;
+            ctx.response.body = nhope::StringReader::create(ctx.aoCtx, std::string(size, 'x'));
+            return nhope::makeReadyFuture();
+        });
+        // the first request is answered in a second, the rest at once
+        router.get("/slow-once", [this](server::RequestContext& ctx) {
+            ctx.response.status = server::HttpStatus::Ok;
+            if (slowOnceCount++ != 0) {
+                return nhope::makeReadyFuture();
+            }
+            nhope::Promise<void> promise;
+            auto future = promise.future();
+            nhope::setTimeout(ctx.aoCtx, std::chrono::seconds(1), [promise = std::move(promise)](auto) mutable {
+                promise.setValue();
+            });
+            return future;
+        });
+        router.get("/late-body", [](server::RequestContext& ctx) {
+            ctx.response.status = server::HttpStatus::Ok;
+            ctx.response.headers["Content-Length"] = std::to_string(LateBody::content.size());
+            ctx.response.body = std::make_unique<LateBody>(ctx.aoCtx);
+            return nhope::makeReadyFuture();
+        });
+        router.get("/close", [](server::RequestContext& ctx) {
+            ctx.response.status = server::HttpStatus::Ok;
+            ctx.response.headers["Connection"] = "close";
+            return nhope::makeReadyFuture();
+        });
+        return router;
+    }
+
+    client::ClientPoolParams poolParams()
+    {
+        return {.connect = backend.connector()};
+    }
+
+    std::atomic<int> slowOnceCount{0};
+    MemoryServer backend;
+};
+
+client::Request ping(int n)
+{
+    return {
+      .method = "GET",
+      .uri = {.host = "memory", .path = fmt::format("/ping/{}", n)},
+    };
+}
+
+client::Request slowOnce()
+{
+    return {.method = "GET", .uri = {.host = "memory", .path = "/slow-once"}};
+}
+
+client::Request lateBody()
+{
+    return {.method = "GET", .uri = {.host = "memory", .path = "/late-body"}};
+}
+
+std::string body(client::Response& resp)
+{
+    return asString(nhope::readAll(*resp.body).get());
+}
+
+}   // namespace
+
+TEST(ClientPool, ReuseConnection)   // NOLINT
+{
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    TestServer srv(serverCtx);
+    auto pool = client::ClientPool::create(clientCtx, srv.poolParams());
+
+    for (int i = 0; i < 5; ++i) {
+        auto resp = invoke(clientCtx, [&pool, i] {
+                        return pool->sendRequest(ping(i));
+                    }).get();
+        EXPECT_EQ(resp.status, client::HttpStatus::Ok);
+        EXPECT_EQ(body(resp), std::to_string(i));
+    }
+
+    EXPECT_EQ(srv.backend.connectCount, 1);
+    EXPECT_EQ(invoke(clientCtx,
+                     [&pool] {
+                         return pool->idleConnectionCount();
+                     }),
+              1);
+}
+
+TEST(ClientPool, MaxConnectionsPerHost)   // NOLINT
+{
+    constexpr int requestCount = 20;
+
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    TestServer srv(serverCtx);
+    auto params = srv.poolParams();
+    params.maxConnectionsPerHost = 2;
+    auto pool = client::ClientPool::create(clientCtx, std::move(params));
+
+    auto futures = invoke(clientCtx, [&pool] {
+        std::vector<nhope::Future<client::Response>> futures;
+        for (int i = 0; i < requestCount; ++i) {
+            futures.push_back(pool->sendRequest(ping(i)));
+        }
+        return futures;
+    });
+
+    for (int i = 0; i < requestCount; ++i) {
+        auto resp = futures[i].get();
+        EXPECT_EQ(body(resp), std::to_string(i));
+    }
+    EXPECT_EQ(srv.backend.connectCount, 2);
+}
+
+TEST(ClientPool, ConnectionClose)   // NOLINT
+{
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    TestServer srv(serverCtx);
+    auto pool = client::ClientPool::create(clientCtx, srv.poolParams());
+
+    const auto send = [&](client::Request request) {
+        return invoke(clientCtx, [&pool, &request] {
+                   return pool->sendRequest(std::move(request));
+               })
+          .get();
+    };
+
+    EXPECT_EQ(send({.method = "GET", .uri = {.host = "memory", .path = "/close"}}).status, client::HttpStatus::Ok);
+    EXPECT_EQ(send(ping(1)).status, client::HttpStatus::Ok);
+    EXPECT_EQ(srv.backend.connectCount, 2);
+}
+
+TEST(ClientPool, DeadIdleConnection)   // NOLINT
+{
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    TestServer srv(serverCtx);
+    auto pool = client::ClientPool::create(clientCtx, srv.poolParams());
+    const auto send = [&](int n) {
+        return invoke(clientCtx, [&pool, n] {
+                   return pool->sendRequest(ping(n));
+               })
+          .get();
+    };
+
+    auto first = send(1);
+    EXPECT_EQ(body(first), "1");
+
+    // the idle connection is closed by the server, the GET is sent again over a new one
+    invoke(serverCtx, [&srv] {
+        srv.backend.restart();
+    });
+    auto second = send(2);
+    EXPECT_EQ(body(second), "2");
+    EXPECT_EQ(srv.backend.connectCount, 2);
+}
+
+TEST(ClientPool, IdleTimeout)   // NOLINT
+{
+    constexpr auto idleTimeout = std::chrono::milliseconds(100);
+
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    TestServer srv(serverCtx);
+    auto params = srv.poolParams();
+    params.idleTimeout = idleTimeout;
+    auto pool = client::ClientPool::create(clientCtx, std::move(params));
+    const auto idleCount = [&] {
+        return invoke(clientCtx, [&pool] {
+            return pool->idleConnectionCount();
+        });
+    };
+
+    auto first = invoke(clientCtx, [&pool] {
+                     return pool->sendRequest(ping(1));
+                 }).get();
+    EXPECT_EQ(body(first), "1");
+    EXPECT_EQ(idleCount(), 1);
+
+    // the sweep closes the expired connection
+    std::this_thread::sleep_for(idleTimeout * 3);
+    EXPECT_EQ(idleCount(), 0);
+
+    auto second = invoke(clientCtx, [&pool] {
+                      return pool->sendRequest(ping(2));
+                  }).get();
+    EXPECT_EQ(body(second), "2");
+    EXPECT_EQ(srv.backend.connectCount, 2);
+
+    // the sweep cannot run while the client thread is busy, the connection expires when it is picked
+    auto third = invoke(clientCtx, [&pool, idleTimeout] {
+                     std::this_thread::sleep_for(idleTimeout * 2);
+                     return pool->sendRequest(ping(3));
+                 }).get();
+    EXPECT_EQ(body(third), "3");
+    EXPECT_EQ(srv.backend.connectCount, 3);
+    EXPECT_EQ(idleCount(), 1);
+}
+
+TEST(ClientPool, Pipelining)   // NOLINT
+{
+    constexpr int requestCount = 20;
+
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    TestServer srv(serverCtx);
+    auto params = srv.poolParams();
+    params.maxConnectionsPerHost = 1;
+    params.pipelineDepth = 4;
+    auto pool = client::ClientPool::create(clientCtx, std::move(params));
+
+    auto futures = invoke(clientCtx, [&pool] {
+        std::vector<nhope::Future<client::Response>> futures;
+        for (int i = 0; i < requestCount; ++i) {
+            futures.push_back(pool->sendRequest(ping(i)));
+        }
+        return futures;
+    });
+
+    for (int i = 0; i < requestCount; ++i) {
+        auto resp = futures[i].get();
+        EXPECT_EQ(body(resp), std::to_string(i));
+    }
+    EXPECT_EQ(srv.backend.connectCount, 1);
+}
+
+TEST(ClientPool, PipelineAfterClose)   // NOLINT
+{
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    TestServer srv(serverCtx);
+    auto params = srv.poolParams();
+    params.maxConnectionsPerHost = 1;
+    params.pipelineDepth = 4;
+    auto pool = client::ClientPool::create(clientCtx, std::move(params));
+
+    // the requests pipelined after "Connection: close" are sent again over a new connection
+    auto futures = invoke(clientCtx, [&pool] {
+        std::vector<nhope::Future<client::Response>> futures;
+        futures.push_back(pool->sendRequest({.method = "GET", .uri = {.host = "memory", .path = "/close"}}));
+        for (int i = 1; i < 4; ++i) {
+            futures.push_back(pool->sendRequest(ping(i)));
+        }
+        return futures;
+    });
+
+    EXPECT_EQ(futures[0].get().status, client::HttpStatus::Ok);
+    for (int i = 1; i < 4; ++i) {
+        auto resp = futures[i].get();
+        EXPECT_EQ(body(resp), std::to_string(i));
+    }
+    EXPECT_EQ(srv.backend.connectCount, 2);
+}
+
+TEST(ClientPool, StreamBody)   // NOLINT
+{
+    constexpr std::size_t bodySize = 1024 * 1024;
+
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    TestServer srv(serverCtx);
+    auto pool = client::ClientPool::create(clientCtx, srv.poolParams());
+    const auto open = [&](std::string path) {
+        return invoke(clientCtx, [&pool, &path] {
+                   return pool->openRequest({.method = "GET", .uri = {.host = "memory", .path = std::move(path)}});
+               })
+          .get();
+    };
+
+    // the connection goes back to the pool once the body is read to the end
+    auto large = open(fmt::format("/large/{}", bodySize));
+    EXPECT_EQ(body(large).size(), bodySize);
+    auto first = open("/ping/1");
+    EXPECT_EQ(body(first), "1");
+    EXPECT_EQ(srv.backend.connectCount, 1);
+
+    // the rest of a dropped body is in the socket, the connection is closed
+    open(fmt::format("/large/{}", bodySize));
+    auto second = open("/ping/2");
+    EXPECT_EQ(body(second), "2");
+    EXPECT_EQ(srv.backend.connectCount, 2);
+}
+
+TEST(ClientPool, RequestTimeout)   // NOLINT
+{
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    TestServer srv(serverCtx);
+    auto params = srv.poolParams();
+    params.requestTimeout = std::chrono::milliseconds(100);
+    auto pool = client::ClientPool::create(clientCtx, std::move(params));
+
+    auto future = invoke(clientCtx, [&pool] {
+        return pool->sendRequest(slowOnce());
+    });
+    try {
+        future.get();
+        FAIL() << "the request has not timed out";
+    } catch (const std::system_error& e) {
+        EXPECT_EQ(e.code(), std::errc::timed_out);
+    }
+
+    // the connection waiting for the late response is closed
+    auto resp = invoke(clientCtx, [&pool] {
+                    return pool->sendRequest(ping(1));
+                }).get();
+    EXPECT_EQ(body(resp), "1");
+    EXPECT_EQ(srv.backend.connectCount, 2);
+}
+
+TEST(ClientPool, RequestTimeoutBody)   // NOLINT
+{
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    TestServer srv(serverCtx);
+    auto params = srv.poolParams();
+    params.requestTimeout = std::chrono::milliseconds(100);
+    auto pool = client::ClientPool::create(clientCtx, std::move(params));
+
+    // the headers arrive at once, the body after the timeout
+    auto future = invoke(clientCtx, [&pool] {
+        return pool->sendRequest(lateBody());
+    });
+    try {
+        future.get();
+        FAIL() << "the request has not timed out";
+    } catch (const std::system_error& e) {
+        EXPECT_EQ(e.code(), std::errc::timed_out);
+    }
+
+    // the connection with the unread body is closed
+    auto resp = invoke(clientCtx, [&pool] {
+                    return pool->sendRequest(ping(1));
+                }).get();
+    EXPECT_EQ(body(resp), "1");
+    EXPECT_EQ(srv.backend.connectCount, 2);
+
+    // openRequest is done with the headers, the caller reads the body without the timeout
+    resp = invoke(clientCtx, [&pool] {
+               return pool->openRequest(lateBody());
+           }).get();
+    EXPECT_EQ(body(resp), LateBody::content);
+}
+
+TEST(ClientPool, HedgedRequest)   // NOLINT
+{
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    TestServer srv(serverCtx);
+    auto params = srv.poolParams();
+    params.hedgePercentile = 90;
+    auto pool = client::ClientPool::create(clientCtx, std::move(params));
+
+    // the latencies of the host are known after a few responses
+    for (int i = 0; i < 20; ++i) {
+        invoke(clientCtx, [&pool, i] {
+            return pool->sendRequest(ping(i));
+        }).get();
+    }
+
+    // the hedged copy is sent through a new connection and answered at once
+    auto resp = invoke(clientCtx, [&pool] {
+                    return pool->sendRequest(slowOnce());
+                }).get();
+    EXPECT_EQ(resp.status, client::HttpStatus::Ok);
+    EXPECT_EQ(srv.slowOnceCount, 2);
+    EXPECT_EQ(srv.backend.connectCount, 2);
+}
+
+TEST(ClientPool, RetryBudget)   // NOLINT
+{
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    TestServer srv(serverCtx);
+    auto params = srv.poolParams();
+    params.retryBudgetRatio = 0;
+    params.retryBudgetBurst = 0;
+    auto pool = client::ClientPool::create(clientCtx, std::move(params));
+    const auto send = [&](int n) {
+        return invoke(clientCtx, [&pool, n] {
+            return pool->sendRequest(ping(n));
+        });
+    };
+
+    auto first = send(1).get();
+    EXPECT_EQ(body(first), "1");
+
+    // no tokens, the GET is not sent again over a new connection
+    invoke(serverCtx, [&srv] {
+        srv.backend.restart();
+    });
+    EXPECT_ANY_THROW(send(2).get());   // NOLINT
+    EXPECT_EQ(srv.backend.connectCount, 1);
+}
@@ -0,0 +1,187 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nhope/async/thread-executor.h"
+
+#include "royalbed/client/endpoint.h"
+#include "royalbed/server/http-status.h"
+#include "royalbed/server/router.h"
+
+#include "helpers/invoke.h"
+#include "helpers/memory-server.h"
+
+namespace {
+
+using namespace std::literals;
+using namespace royalbed;
+
+// In-process replica answering /ping with the status
+struct Replica
+{
+    Replica(nhope::AOContext& aoCtx, int initialStatus)
+      : status(initialStatus)
+      , backend(aoCtx, [this] {
+          auto router = server::Router();
+          router.get("/ping", [this](server::RequestContext& ctx) {
+              ++requestCount;
+              ctx.response.status = status;
+              return nhope::makeReadyFuture();
+          });
+          return router;
+      })
+    {}
+
+    std::atomic<int> status;
+    std::atomic<int> requestCount{0};
+    MemoryServer backend;
+};
+
+// The endpoint connects to the replicas by the host name
+client::EndpointParams endpointParams(const std::map<std::string, Replica*>& replicas)
+{
+    client::EndpointParams params;
+    for (const auto& [host, replica] : replicas) {
+        params.targets.push_back({.host = host});
+    }
+    params.pool.connect = [replicas](nhope::AOContext& aoCtx, const std::string& host, std::uint16_t /*port*/) {
+        return nhope::makeReadyFuture<nhope::TcpSocketPtr>(replicas.at(host)->backend.connect(aoCtx));
+    };
+    return params;
+}
+
+int ping(nhope::AOContext& aoCtx, client::Endpoint& endpoint)
+{
+    return invoke(aoCtx, [&endpoint] {
+               return endpoint.sendRequest({.method = "GET", .uri = {.path = "/ping"}});
+           })
+      .get()
+      .status;
+}
+
+}   // namespace
+
+TEST(Endpoint, Balance)   // NOLINT
+{
+    constexpr int requestCount = 100;
+
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    Replica first(serverCtx, server::HttpStatus::Ok);
+    Replica second(serverCtx, server::HttpStatus::Ok);
+    auto endpoint = client::Endpoint::create(clientCtx, endpointParams({{"first", &first}, {"second", &second}}));
+
+    for (int i = 0; i < requestCount; ++i) {
+        EXPECT_EQ(ping(clientCtx, *endpoint), client::HttpStatus::Ok);
+    }
+    EXPECT_GT(first.requestCount, 0);
+    EXPECT_GT(second.requestCount, 0);
+    EXPECT_EQ(first.requestCount + second.requestCount, requestCount);
+}
+
+TEST(Endpoint, EjectFailingReplica)   // NOLINT
+{
+    constexpr int batchSize = 10;
+    constexpr int requestCount = 40;
+
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    Replica good(serverCtx, server::HttpStatus::Ok);
+    Replica bad(serverCtx, server::HttpStatus::ServiceUnavailable);
+    auto params = endpointParams({{"bad", &bad}, {"good", &good}});
+    params.ejectAfterFailures = 3;
+    auto endpoint = client::Endpoint::create(clientCtx, std::move(params));
+
+    // the requests in flight spread the batch over both replicas
+    auto batch = invoke(clientCtx, [&endpoint] {
+        std::vector<nhope::Future<client::Response>> futures;
+        for (int i = 0; i < batchSize; ++i) {
+            futures.push_back(endpoint->sendRequest({.method = "GET", .uri = {.path = "/ping"}}));
+        }
+        return futures;
+    });
+    int failed = 0;
+    for (auto& future : batch) {
+        failed += future.get().status != client::HttpStatus::Ok ? 1 : 0;
+    }
+    EXPECT_GE(failed, 3);
+    EXPECT_EQ(failed, bad.requestCount);
+
+    // the failing replica is ejected
+    for (int i = 0; i < requestCount; ++i) {
+        EXPECT_EQ(ping(clientCtx, *endpoint), client::HttpStatus::Ok);
+    }
+    EXPECT_EQ(failed, bad.requestCount);
+
+    const auto replicas = invoke(clientCtx, [&endpoint] {
+        return endpoint->replicas();
+    });
+    ASSERT_EQ(replicas.size(), 2U);
+    EXPECT_EQ(replicas[0].target.host, "bad");
+    EXPECT_TRUE(replicas[0].ejected);
+    EXPECT_FALSE(replicas[1].ejected);
+}
+
+TEST(Endpoint, CircuitBreaker)   // NOLINT
+{
+    constexpr std::size_t windowSize = 4;
+    constexpr auto openDuration = 100ms;
+
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    Replica replica(serverCtx, server::HttpStatus::ServiceUnavailable);
+    auto params = endpointParams({{"replica", &replica}});
+    params.circuitBreaker = client::CircuitBreakerParams{
+      .windowSize = windowSize,
+      .minimumCalls = windowSize,
+      .openDuration = openDuration,
+      .halfOpenCalls = 2,
+    };
+    auto endpoint = client::Endpoint::create(clientCtx, std::move(params));
+    const auto metrics = [&] {
+        return invoke(clientCtx, [&endpoint] {
+                   return endpoint->circuitBreakerMetrics();
+               })
+          .value();
+    };
+
+    for (std::size_t i = 0; i < windowSize; ++i) {
+        EXPECT_EQ(ping(clientCtx, *endpoint), client::HttpStatus::ServiceUnavailable);
+    }
+    EXPECT_EQ(metrics().state, client::CircuitState::Open);
+    EXPECT_EQ(metrics().openCount, 1U);
+
+    // the open circuit fails the call without sending it
+    EXPECT_THROW(ping(clientCtx, *endpoint), client::CircuitOpenError);   // NOLINT
+    EXPECT_EQ(replica.requestCount, static_cast<int>(windowSize));
+    EXPECT_EQ(metrics().rejectedCalls, 1U);
+
+    // the trial calls reach the recovered replica
+    replica.status = server::HttpStatus::Ok;
+    std::this_thread::sleep_for(openDuration);
+    EXPECT_EQ(ping(clientCtx, *endpoint), client::HttpStatus::Ok);
+    EXPECT_EQ(metrics().state, client::CircuitState::HalfOpen);
+    EXPECT_EQ(ping(clientCtx, *endpoint), client::HttpStatus::Ok);
+    EXPECT_EQ(metrics().state, client::CircuitState::Closed);
+    EXPECT_EQ(replica.requestCount, static_cast<int>(windowSize) + 2);
+}
@@ -59,6 +59,15 @@ TEST(Body, InvalidBody)   // NOLINT
     Request req;
     req.headers.emplace("Content-Type", "application/json");
     EXPECT_THROW(royalbed::common::parseBody<TestStruct>(req.headers, {1, 3, 3}), HttpError);   // NOLINT
+
+    const auto invalidJson = royalbed::common::tryParseBody<TestStruct>(req.headers, {1, 3, 3});
+    ASSERT_FALSE(invalidJson);
+    EXPECT_EQ(invalidJson.error().httpStatus(), HttpStatus::BadRequest);
+
+    const std::string raw = R"({"val1": "not int"})";
+    const auto invalidStruct = royalbed::common::tryParseBody<TestStruct>(req.headers, {raw.begin(), raw.end()});
+    ASSERT_FALSE(invalidStruct);
+    EXPECT_EQ(invalidStruct.error().httpStatus(), HttpStatus::BadRequest);
 }
 
 TEST(Body, InvalidContentType)   // NOLINT
@@ -70,4 +79,6 @@ TEST(Body, InvalidContentType)   // NOLINT
     Request req;
     req.headers.emplace("Content-Type", "application/jpeg");
     EXPECT_THROW(royalbed::common::extractBodyType(req.headers), HttpError);   // NOLINT
+    EXPECT_FALSE(royalbed::common::tryExtractBodyType(req.headers));
+    EXPECT_FALSE(royalbed::common::tryExtractBodyType(Headers{}));
 }
@@ -0,0 +1,199 @@
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nhope/async/thread-executor.h"
+
+#include "royalbed/common/completion-queue.h"
+
+using namespace royalbed::common;
+
+TEST(CompletionQueue, ManyProducers)   // NOLINT
+{
+    constexpr int producerCount = 4;
+    constexpr int completionCount = 10000;
+
+    nhope::ThreadExecutor th;
+    nhope::AOContext aoCtx(th);
+    auto queue = CompletionQueue::create(aoCtx);
+
+    // touched only in the AOContext thread
+    std::array<int, static_cast<std::size_t>(producerCount)> last{};
+    last.fill(-1);
+    bool ordered = true;
+    std::atomic<int> done = 0;
+
+    std::vector<std::thread> producers;
+    for (std::size_t p = 0; p < last.size(); ++p) {
+        producers.emplace_back([&, p] {
+            for (int i = 0; i < completionCount; ++i) {
+                queue->post([&, p, i] {
+                    ordered = ordered && last[p] < i;
+                    last[p] = i;
+                    ++done;
+                });
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    while (done != producerCount * completionCount) {
+        std::this_thread::yield();
+    }
+
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(queue->postedCount(), std::uint64_t{producerCount * completionCount});
+}
+
+TEST(CompletionQueue, Coalescing)   // NOLINT
+{
+    constexpr int completionCount = 100;
+
+    nhope::ThreadExecutor th;
+    nhope::AOContext aoCtx(th);
+    auto queue = CompletionQueue::create(aoCtx);
+
+    // the context is busy, so all the completions are collected into one batch
+    std::promise<void> release;
+    aoCtx.exec([released = release.get_future().share()] {
+        released.wait();
+    });
+
+    std::vector<int> order;
+    std::promise<void> done;
+    for (int i = 0; i < completionCount; ++i) {
+        queue->post([&order, &done, i] {
+            order.push_back(i);
+            if (i == completionCount - 1) {
+                done.set_value();
+            }
+        });
+    }
+    release.set_value();
+    done.get_future().wait();
+
+    EXPECT_EQ(queue->postedCount(), std::uint64_t{completionCount});
+    EXPECT_EQ(queue->wakeupCount(), 1U);
+    ASSERT_EQ(order.size(), std::size_t{completionCount});
+    for (int i = 0; i < completionCount; ++i) {
+        EXPECT_EQ(order[static_cast<std::size_t>(i)], i);
+    }
+}
+
+TEST(CompletionQueue, Dispatch)   // NOLINT
+{
+    nhope::ThreadExecutor th;
+    nhope::AOContext aoCtx(th);
+    auto queue = CompletionQueue::create(aoCtx);
+
+    // in a drain the work runs right away
+    std::promise<bool> inDrain;
+    queue->post([&] {
+        bool called = false;
+        queue->dispatch([&called] {
+            called = true;
+        });
+        inDrain.set_value(called);
+    });
+    EXPECT_TRUE(inDrain.get_future().get());
+
+    // outside it the work is scheduled into the context
+    std::promise<std::thread::id> thread;
+    queue->dispatch([&thread] {
+        thread.set_value(std::this_thread::get_id());
+    });
+    EXPECT_NE(thread.get_future().get(), std::this_thread::get_id());
+    EXPECT_FALSE(queue->draining());
+}
+
+TEST(CompletionQueue, ContinueWith)   // NOLINT
+{
+    nhope::ThreadExecutor th;
+    nhope::AOContext aoCtx(th);
+    auto queue = CompletionQueue::create(aoCtx);
+
+    nhope::Promise<void> promise;
+    std::atomic<bool> inDrain = false;
+    auto continued = queue->continueWith(promise.future(), [&] {
+        inDrain = queue->draining();
+    });
+    queue->post([&promise] {
+        promise.setValue();
+    });
+    continued.get();
+    EXPECT_TRUE(inDrain);
+    EXPECT_EQ(queue->wakeupCount(), 1U);
+
+    nhope::Promise<void> failed;
+    auto rejected = queue->continueWith(failed.future(), [] {
+        FAIL() << "must not be called";
+    });
+    queue->post([&failed] {
+        failed.setException(std::make_exception_ptr(std::runtime_error("failed")));
+    });
+    EXPECT_THROW(rejected.get(), std::runtime_error);   // NOLINT
+}
+
+// The owner (e.g. a session) may go away while its completions are in the batch
+TEST(CompletionQueue, Guard)   // NOLINT
+{
+    nhope::ThreadExecutor th;
+    nhope::AOContext aoCtx(th);
+    auto queue = CompletionQueue::create(aoCtx);
+
+    auto owner = std::make_unique<CompletionOwner>();
+    const auto guard = owner->guard();
+    std::atomic<int> called = 0;
+    std::promise<void> done;
+    queue->post([&] {
+        queue->post(guard, [&called] {
+            ++called;
+        });
+        // destroyed in the context of the queue before the drain gets to the completion
+        owner.reset();
+        queue->post([&done] {
+            done.set_value();
+        });
+    });
+    done.get_future().get();
+    EXPECT_EQ(called, 0);
+
+    CompletionOwner alive;
+    nhope::Promise<void> promise;
+    std::atomic<bool> continued = false;
+    auto future = queue->continueWith(alive.guard(), promise.future(), [&continued] {
+        continued = true;
+    });
+    queue->post([&promise] {
+        promise.setValue();
+    });
+    future.get();
+    EXPECT_TRUE(continued);
+}
+
+TEST(CompletionQueue, ClosedContext)   // NOLINT
+{
+    nhope::ThreadExecutor th;
+    auto aoCtx = std::make_unique<nhope::AOContext>(th);
+    auto queue = CompletionQueue::create(*aoCtx);
+    aoCtx.reset();
+
+    bool called = false;
+    queue->post([&called] {
+        called = true;
+    });
+    queue.reset();
+    EXPECT_FALSE(called);
+}
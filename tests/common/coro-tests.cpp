@@ -0,0 +1,149 @@
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nhope/async/thread-executor.h"
+
+#include "royalbed/common/coro.h"
+
+#include "helpers/alloc-counter.h"
+
+namespace {
+
+using namespace royalbed::common;
+
+nhope::Future<int> sum(nhope::AOContext& /*aoCtx*/, nhope::Future<int> a, nhope::Future<int> b)
+{
+    const int x = co_await std::move(a);
+    const int y = co_await std::move(b);
+    co_return x + y;
+}
+
+nhope::Future<void> fail(nhope::AOContext& /*aoCtx*/, nhope::Future<void> f)
+{
+    co_await std::move(f);
+    throw std::runtime_error("coro error");
+}
+
+nhope::Future<std::string> readyChain()
+{
+    const int n = co_await nhope::makeReadyFuture<int>(3);
+    co_return std::string(n, 'x');
+}
+
+nhope::Future<void> waitForever(nhope::AOContext& /*aoCtx*/, nhope::Future<void> f, std::shared_ptr<int> guard,
+                                bool& resumed)
+{
+    co_await std::move(f);
+    resumed = true;
+    *guard = 1;
+}
+
+}   // namespace
+
+TEST(Coro, value)   // NOLINT
+{
+    nhope::ThreadExecutor th;
+    nhope::AOContext aoCtx(th);
+
+    nhope::Promise<int> p;
+    auto f = sum(aoCtx, nhope::makeReadyFuture<int>(1), p.future());
+    p.setValue(2);
+    EXPECT_EQ(f.get(), 3);
+
+    EXPECT_EQ(readyChain().get(), "xxx");
+}
+
+TEST(Coro, exception)   // NOLINT
+{
+    nhope::ThreadExecutor th;
+    nhope::AOContext aoCtx(th);
+
+    EXPECT_THROW(fail(aoCtx, nhope::makeReadyFuture()).get(), std::runtime_error);
+
+    nhope::Promise<int> p;
+    auto f = sum(aoCtx, p.future(), nhope::makeReadyFuture<int>(1));
+    p.setException(std::make_exception_ptr(std::logic_error("awaited error")));
+    EXPECT_THROW(f.get(), std::logic_error);   // NOLINT
+}
+
+TEST(Coro, closedContext)   // NOLINT
+{
+    nhope::ThreadExecutor th;
+    auto aoCtx = std::make_unique<nhope::AOContext>(th);
+
+    nhope::Promise<void> p;
+    auto guard = std::make_shared<int>(0);
+    bool resumed = false;
+    waitForever(*aoCtx, p.future(), guard, resumed);
+
+    aoCtx.reset();
+    p.setValue();
+
+    // the suspended frame has been destroyed with its arguments
+    EXPECT_FALSE(resumed);
+    EXPECT_EQ(guard.use_count(), 1);
+    EXPECT_EQ(*guard, 0);
+}
+
+TEST(Coro, framePool)   // NOLINT
+{
+    constexpr std::size_t frameSize = 100;
+
+    auto pool = std::make_shared<FramePool>();
+    auto* ptr = pool->allocate(frameSize);
+    pool->deallocate(ptr, frameSize);
+    EXPECT_EQ(pool->allocate(frameSize), ptr);
+    pool->deallocate(ptr, frameSize);
+
+    const auto allocations = [](auto&& fn) {
+        const auto before = threadAllocationCount();
+        fn();
+        return threadAllocationCount() - before;
+    };
+    const auto chain = [] {
+        EXPECT_EQ(readyChain().get(), "xxx");
+    };
+
+    chain();
+    const auto plain = allocations(chain);
+    const FramePoolScope scope(pool);
+    chain();
+
+    // the frame of readyChain is the only allocation served by the pool
+    EXPECT_EQ(allocations(chain), plain - 1);
+}
+
+TEST(Coro, framePoolForeignThread)   // NOLINT
+{
+    constexpr std::size_t frameSize = 100;
+
+    const auto allocations = [](auto&& fn) {
+        const auto before = threadAllocationCount();
+        fn();
+        return threadAllocationCount() - before;
+    };
+
+    const FramePoolScope scope(std::make_shared<FramePool>());
+    auto* frame = detail::allocateFrame(frameSize);
+    detail::deallocateFrame(frame, frameSize);
+    EXPECT_EQ(allocations([&] {
+                  frame = detail::allocateFrame(frameSize);
+              }),
+              0);
+
+    // the pool is not thread-safe, a frame destroyed by another thread does not return to it
+    std::thread([frame] {
+        detail::deallocateFrame(frame, frameSize);
+    }).join();
+    EXPECT_EQ(allocations([&] {
+                  frame = detail::allocateFrame(frameSize);
+              }),
+              1);
+    detail::deallocateFrame(frame, frameSize);
+}
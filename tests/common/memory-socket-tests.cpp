@@ -0,0 +1,91 @@
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/thread-executor.h"
+#include "nhope/io/io-device.h"
+
+#include "royalbed/common/memory-socket.h"
+
+#include "helpers/bytes.h"
+
+namespace {
+
+using namespace std::literals;
+using namespace royalbed::common;
+
+std::string readSome(nhope::Reader& reader, std::size_t size)
+{
+    std::vector<std::uint8_t> buf(size);
+    std::promise<std::size_t> promise;
+    reader.read(buf, [&promise](std::exception_ptr err, std::size_t n) {
+        if (err) {
+            promise.set_exception(err);
+        } else {
+            promise.set_value(n);
+        }
+    });
+    buf.resize(promise.get_future().get());
+    return asString(buf);
+}
+
+}   // namespace
+
+TEST(MemorySocket, Transfer)   // NOLINT
+{
+    nhope::ThreadExecutor clientThread;
+    nhope::ThreadExecutor serverThread;
+    nhope::AOContext clientCtx(clientThread);
+    nhope::AOContext serverCtx(serverThread);
+
+    auto [client, server] = makeMemorySocketPair(clientCtx, serverCtx);
+
+    const std::string request(100000, 'x');
+    EXPECT_EQ(nhope::write(*client, asBytes(request)).get(), request.size());
+    nhope::write(*server, asBytes("pong")).get();
+    EXPECT_EQ(readSome(*client, 16), "pong");
+
+    client.reset();
+    EXPECT_EQ(asString(nhope::readAll(*server).get()), request);
+    EXPECT_THROW(nhope::write(*server, asBytes("lost")).get(), std::system_error);   // NOLINT
+}
+
+TEST(MemorySocket, Segmentation)   // NOLINT
+{
+    nhope::ThreadExecutor th;
+    nhope::AOContext aoCtx(th);
+
+    auto [first, second] = makeMemorySocketPair(aoCtx, aoCtx, {.maxSegmentSize = 3});
+
+    nhope::write(*first, asBytes("abcdefgh")).get();
+    EXPECT_EQ(readSome(*second, 16), "abc");
+    EXPECT_EQ(readSome(*second, 2), "de");
+    EXPECT_EQ(readSome(*second, 16), "f");
+    EXPECT_EQ(readSome(*second, 16), "gh");
+}
+
+TEST(MemorySocket, LatencyAndBandwidth)   // NOLINT
+{
+    constexpr auto latency = 50ms;
+    constexpr std::uint64_t bandwidth = 100000;   // 10 KB take 100ms
+
+    nhope::ThreadExecutor th;
+    nhope::AOContext aoCtx(th);
+
+    auto [first, second] = makeMemorySocketPair(aoCtx, aoCtx, {.latency = latency, .bandwidth = bandwidth});
+
+    const auto start = std::chrono::steady_clock::now();
+    nhope::write(*first, std::vector<std::uint8_t>(10000)).get();
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 100ms);
+
+    first.reset();
+    EXPECT_EQ(nhope::readAll(*second).get().size(), 10000U);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 150ms);
+}
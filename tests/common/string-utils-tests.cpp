@@ -1,6 +1,8 @@
+#include <cstdint>
 #include <functional>
 #include <limits>
 #include <string>
+#include <system_error>
 #include <type_traits>
 
 #include <gtest/gtest.h>
@@ -66,6 +68,40 @@ TEST(StringUtils, fromString)   // NOLINT
     checkFromString<unsigned long long>();
 }
 
+TEST(StringUtils, tryFromString)   // NOLINT
+{
+    enum class Color
+    {
+        Red,
+        Green,
+    };
+
+    double d{};
+    EXPECT_EQ(tryFromString(" +1.5e3\t", d), std::errc{});
+    EXPECT_EQ(d, 1500.0);
+    EXPECT_EQ(tryFromString("1.5x", d), std::errc::invalid_argument);
+    EXPECT_EQ(d, 1500.0);
+
+    bool b{};
+    EXPECT_EQ(tryFromString("true", b), std::errc{});
+    EXPECT_TRUE(b);
+    EXPECT_EQ(tryFromString("0", b), std::errc{});
+    EXPECT_FALSE(b);
+    EXPECT_EQ(tryFromString("yes", b), std::errc::invalid_argument);
+
+    Color color{};
+    EXPECT_EQ(tryFromString("1", color), std::errc{});
+    EXPECT_EQ(color, Color::Green);
+
+    std::uint8_t byte{};
+    EXPECT_EQ(tryFromString("256", byte), std::errc::result_out_of_range);
+    EXPECT_EQ(tryFromString("", byte), std::errc::invalid_argument);
+
+    EXPECT_EQ(fromString<double>("0.25"), 0.25);
+    EXPECT_TRUE(fromString<bool>("true"));
+    EXPECT_ANY_THROW(fromString<bool>("TRUE"));   // NOLINT
+}
+
 TEST(StringUtils, toLower)   // NOLINT
 {
     EXPECT_EQ(toLower("QwErtY"sv), "qwerty"sv);
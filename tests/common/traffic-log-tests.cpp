@@ -0,0 +1,93 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "royalbed/common/traffic-log.h"
+
+namespace {
+
+using namespace std::literals;
+using namespace royalbed::common;
+
+std::filesystem::path logPath(const std::string& name)
+{
+    return std::filesystem::temp_directory_path() / name;
+}
+
+}   // namespace
+
+TEST(TrafficLog, RoundTrip)   // NOLINT
+{
+    const auto path = logPath("traffic-log-round-trip");
+    {
+        TrafficLogWriter writer(path);
+        writer.write({
+          .time = 5ms,
+          .method = "PUT",
+          .target = "/api/vru/vru_1/sample-rate?force=1",
+          .headers = {{"Content-Type", "application/json"}, {"Content-Length", "21"}},
+          .body = R"({"sampleRate": 16000})",
+        });
+        writer.write({
+          .time = 1s,
+          .method = "POST",
+          .target = "/upload",
+          .headers = {{"Transfer-Encoding", "chunked"}},
+          .bodyCaptured = false,
+        });
+    }
+
+    TrafficLogReader reader(path);
+    const auto first = reader.next();
+    ASSERT_TRUE(first.has_value());
+    EXPECT_EQ(first->time, 5ms);
+    EXPECT_EQ(first->method, "PUT");
+    EXPECT_EQ(first->target, "/api/vru/vru_1/sample-rate?force=1");
+    EXPECT_EQ(first->headers.at("Content-Type"), "application/json");
+    EXPECT_EQ(first->headers.at("Content-Length"), "21");
+    EXPECT_TRUE(first->bodyCaptured);
+    EXPECT_EQ(first->body, R"({"sampleRate": 16000})");
+
+    const auto second = reader.next();
+    ASSERT_TRUE(second.has_value());
+    EXPECT_EQ(second->time, 1s);
+    EXPECT_EQ(second->method, "POST");
+    EXPECT_FALSE(second->bodyCaptured);
+    EXPECT_TRUE(second->body.empty());
+
+    EXPECT_FALSE(reader.next().has_value());
+    std::filesystem::remove(path);
+}
+
+TEST(TrafficLog, TruncatedTail)   // NOLINT
+{
+    const auto path = logPath("traffic-log-truncated");
+    {
+        TrafficLogWriter writer(path);
+        writer.write({.method = "GET", .target = "/first"});
+        writer.write({.method = "GET", .target = "/second"});
+    }
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+
+    TrafficLogReader reader(path);
+    const auto first = reader.next();
+    ASSERT_TRUE(first.has_value());
+    EXPECT_EQ(first->target, "/first");
+    EXPECT_FALSE(reader.next().has_value());
+    std::filesystem::remove(path);
+}
+
+TEST(TrafficLog, NotALog)   // NOLINT
+{
+    const auto path = logPath("traffic-log-invalid");
+    {
+        std::ofstream file(path);
+        file << "GET / HTTP/1.1\r\n\r\n";
+    }
+    EXPECT_THROW(TrafficLogReader{path}, std::runtime_error);   // NOLINT
+    std::filesystem::remove(path);
+}
@@ -1,3 +1,6 @@
+#include <string>
+
+#include <fmt/format.h>
 #include <gtest/gtest.h>
 
 #include "royalbed/common/uri.h"
@@ -34,6 +37,29 @@ TEST(Uri, uriUnescape)   // NOLINT
     EXPECT_THROW(uriUnescape("hello/"), UriParseError);     // NOLINT
 }
 
+TEST(Uri, escapeLongStrings)   // NOLINT
+{
+    // special symbols at every position of the vectorized blocks
+    const std::string safe(70, 'a');
+    for (std::size_t pos = 0; pos < safe.size(); ++pos) {
+        for (const char ch : {' ', '/', '\x80', '\xff', '@', '[', '`', '{'}) {
+            auto str = safe;
+            str[pos] = ch;
+
+            auto escaped = safe.substr(0, pos) + fmt::format("%{:02x}", static_cast<unsigned char>(ch));
+            escaped += safe.substr(pos + 1);
+            EXPECT_EQ(uriEscape(str), escaped);
+            EXPECT_EQ(uriUnescape(escaped), str);
+            EXPECT_THROW(uriUnescape(str), UriParseError);   // NOLINT
+        }
+    }
+
+    const std::string path = "/api/v1/some-resource_name/0123456789/~user/file.tar.gz";
+    EXPECT_EQ(uriEscape(path, UriEscapeMode::Path), path);
+    EXPECT_EQ(uriUnescape(path, UriEscapeMode::Path), path);
+    EXPECT_EQ(uriUnescape("%41%62" + path + "%2F%2f", UriEscapeMode::Path), "Ab" + path + "//");
+}
+
 TEST(Uri, toString_relative)   // NOLINT
 {
     {
@@ -129,3 +155,53 @@ TEST(Uri, parse)   // NOLINT
     EXPECT_EQ(uri.fragment, "fragment");
     EXPECT_FALSE(uri.isRelative());
 }
+
+TEST(Uri, query)   // NOLINT
+{
+    auto query = UriQuery::parse("a=1&b%20c=d+e&&f&g=");
+    EXPECT_EQ(query.size(), 4);
+    EXPECT_EQ(query, UriQuery({{"a", "1"}, {"b c", "d e"}, {"f", ""}, {"g", ""}}));
+
+    const auto copy = query;
+    EXPECT_EQ(copy.find("a"), "1");
+    EXPECT_EQ(copy.find("b c"), "d e");
+    EXPECT_EQ(copy.find("f"), "");
+    EXPECT_EQ(copy.find("x"), std::nullopt);
+
+    query.add("x", "y z");
+    EXPECT_EQ(query.size(), 5);
+    EXPECT_EQ(query[4].second, "y z");
+    EXPECT_EQ(copy.size(), 4);
+
+    // the query is parsed on the first access
+    const auto invalid = UriQuery::parse("a=%2");
+    const auto invalidCopy = invalid;
+    EXPECT_THROW((void)invalid.find("a"), UriParseError);       // NOLINT
+    EXPECT_THROW((void)invalidCopy.size(), UriParseError);      // NOLINT
+    EXPECT_THROW((void)UriQuery::parse("a=b/c").empty(), UriParseError);   // NOLINT
+
+    EXPECT_EQ(invalid.tryParse(), "Incomplete hex escape sequence");
+    EXPECT_EQ(UriQuery::parse("a%2g=b").tryParse(), "Invalid escape sequence");
+    EXPECT_EQ(UriQuery::parse("a=%41&b=c/d").tryParse(), "Invalid symbol");
+    EXPECT_EQ(UriQuery::parse("a=%41&b=c").tryParse(), std::nullopt);
+}
+
+TEST(Uri, largeQuery)   // NOLINT
+{
+    std::string encoded;
+    for (int i = 0; i < 40; ++i) {
+        encoded += fmt::format("p{}=v%20{}&", i, i);
+    }
+    encoded += "p7=duplicate";
+
+    auto query = UriQuery::parse(encoded);
+    EXPECT_EQ(query.size(), 41);
+    for (int i = 0; i < 40; ++i) {
+        EXPECT_EQ(query.find(fmt::format("p{}", i)), fmt::format("v {}", i));
+    }
+    EXPECT_EQ(query.find("p40"), std::nullopt);
+
+    query.add("p40", "last");
+    EXPECT_EQ(query.find("p40"), "last");
+    EXPECT_EQ(query.find("p7"), "v 7");
+}
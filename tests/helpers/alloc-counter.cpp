@@ -0,0 +1,65 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// relative to this file, so the benchmarks can compile it too
+#include "alloc-counter.h"
+
+namespace {
+
+std::atomic<std::uint64_t> allocationCounter{0};         // NOLINT
+thread_local std::uint64_t threadAllocationCounter = 0;   // NOLINT
+
+void* countedAlloc(std::size_t size)
+{
+    allocationCounter.fetch_add(1, std::memory_order_relaxed);
+    ++threadAllocationCounter;
+    if (void* ptr = std::malloc(size != 0 ? size : 1)) {   // NOLINT
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+}   // namespace
+
+std::uint64_t allocationCount() noexcept
+{
+    return allocationCounter.load(std::memory_order_relaxed);
+}
+
+std::uint64_t threadAllocationCount() noexcept
+{
+    return threadAllocationCounter;
+}
+
+void* operator new(std::size_t size)
+{
+    return countedAlloc(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return countedAlloc(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);   // NOLINT
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);   // NOLINT
+}
+
+void operator delete(void* ptr, std::size_t /*size*/) noexcept
+{
+    std::free(ptr);   // NOLINT
+}
+
+void operator delete[](void* ptr, std::size_t /*size*/) noexcept
+{
+    std::free(ptr);   // NOLINT
+}
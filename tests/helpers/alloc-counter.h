@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * The binary replaces the global operator new to count heap allocations.
+ * Shared by the tests and the benchmarks, benchmarks/alloc-counter.cpp compiles this implementation.
+ */
+
+// Allocations made by all threads, measure only while the other threads wait
+std::uint64_t allocationCount() noexcept;
+
+// Allocations made by the calling thread since it started
+std::uint64_t threadAllocationCount() noexcept;
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <future>
+#include <type_traits>
+
+#include "nhope/async/ao-context.h"
+
+// Calls fn in the thread of the context and waits for the result
+template<typename Fn>
+auto invoke(nhope::AOContext& aoCtx, Fn fn)
+{
+    std::promise<decltype(fn())> promise;
+    aoCtx.exec([&promise, &fn] {
+        if constexpr (std::is_void_v<decltype(fn())>) {
+            fn();
+            promise.set_value();
+        } else {
+            promise.set_value(fn());
+        }
+    });
+    return promise.get_future().get();
+}
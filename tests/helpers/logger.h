@@ -1,3 +1,5 @@
+#pragma once
+
 #include <memory>
 #include "spdlog/logger.h"
 #include "spdlog/sinks/null_sink.h"
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nhope/io/tcp.h"
+
+#include "royalbed/client/client-pool.h"
+#include "royalbed/server/listener.h"
+#include "royalbed/server/router.h"
+#include "royalbed/server/server.h"
+
+#include "helpers/logger.h"
+
+/**
+ * In-process server, the clients connect to it through a MemoryListener and the connections are counted.
+ * The router is made anew on every start.
+ */
+class MemoryServer final
+{
+public:
+    using RouterFactory = std::function<royalbed::server::Router()>;
+
+    MemoryServer(nhope::AOContext& aoCtx, RouterFactory makeRouter)
+      : m_aoCtx(aoCtx)
+      , m_makeRouter(std::move(makeRouter))
+      , m_listener(royalbed::server::MemoryListener::create(aoCtx))
+    {
+        start();
+    }
+
+    // Closes all the connections, called in the thread of the server context
+    void restart()
+    {
+        m_server.reset();
+        start();
+    }
+
+    // Opens the client end of a new connection in aoCtx
+    nhope::TcpSocketPtr connect(nhope::AOContext& aoCtx)
+    {
+        ++connectCount;
+        return m_listener->connect(aoCtx);
+    }
+
+    // Connects to the server whatever the host and port are
+    royalbed::client::Connector connector()
+    {
+        return [this](nhope::AOContext& aoCtx, const std::string& /*host*/, std::uint16_t /*port*/) {
+            return nhope::makeReadyFuture<nhope::TcpSocketPtr>(connect(aoCtx));
+        };
+    }
+
+    [[nodiscard]] const royalbed::server::MemoryListenerPtr& listener() const noexcept
+    {
+        return m_listener;
+    }
+
+    std::atomic<int> connectCount{0};
+
+private:
+    void start()
+    {
+        m_server = royalbed::server::Server::start(m_aoCtx, {
+                                                              .router = m_makeRouter(),
+                                                              .log = nullLogger(),
+                                                              .listener = m_listener,
+                                                            });
+    }
+
+    nhope::AOContext& m_aoCtx;
+    RouterFactory m_makeRouter;
+    royalbed::server::MemoryListenerPtr m_listener;
+    royalbed::server::ServerPtr m_server;
+};
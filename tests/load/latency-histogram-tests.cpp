@@ -0,0 +1,73 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include "load/latency-histogram.h"
+
+namespace {
+using namespace std::literals;
+using royalbed::load::LatencyHistogram;
+}   // namespace
+
+TEST(LatencyHistogram, ExactSmallValues)   // NOLINT
+{
+    for (std::uint64_t value = 0; value < LatencyHistogram::subBucketCount; ++value) {
+        EXPECT_EQ(LatencyHistogram::bucketIndex(value), value);
+        EXPECT_EQ(LatencyHistogram::bucketValue(LatencyHistogram::bucketIndex(value)), value);
+    }
+}
+
+TEST(LatencyHistogram, BucketBounds)   // NOLINT
+{
+    // the upper bound of a bucket belongs to it, the next value starts the next bucket
+    const auto lastIndex = LatencyHistogram::bucketIndex(LatencyHistogram::maxValue);
+    for (std::size_t index = 0; index < lastIndex; ++index) {
+        const auto bound = LatencyHistogram::bucketValue(index);
+        ASSERT_EQ(LatencyHistogram::bucketIndex(bound), index);
+        ASSERT_EQ(LatencyHistogram::bucketIndex(bound + 1), index + 1);
+    }
+}
+
+TEST(LatencyHistogram, RelativeError)   // NOLINT
+{
+    // every power of two and its neighbours, the worst case is the lower bound of a bucket
+    for (std::uint64_t power = LatencyHistogram::subBucketCount; power < LatencyHistogram::maxValue; power <<= 1) {
+        for (const auto value : {power - 1, power, power + 1, power + power / 3}) {
+            const auto reported = LatencyHistogram::bucketValue(LatencyHistogram::bucketIndex(value));
+            ASSERT_GE(reported, value);
+            ASSERT_LT(static_cast<double>(reported - value) / static_cast<double>(value), 0.01) << value;
+        }
+    }
+}
+
+TEST(LatencyHistogram, Percentile)   // NOLINT
+{
+    LatencyHistogram histogram;
+    EXPECT_EQ(histogram.percentile(50), 0ns);
+
+    for (int i = 1; i <= 100; ++i) {
+        histogram.record(std::chrono::nanoseconds(i));
+    }
+    EXPECT_EQ(histogram.count(), 100U);
+    EXPECT_EQ(histogram.percentile(0), 1ns);
+    EXPECT_EQ(histogram.percentile(50), 50ns);
+    EXPECT_EQ(histogram.percentile(99), 99ns);
+    EXPECT_EQ(histogram.percentile(100), 100ns);
+    EXPECT_EQ(histogram.mean(), 51ns);
+
+    // the reported value is the upper bound of the bucket, but not over the recorded maximum
+    LatencyHistogram large;
+    large.record(1'000'001ns);
+    large.record(3ms);
+    const auto median = large.percentile(50);
+    EXPECT_GE(median, 1'000'001ns);
+    EXPECT_LT(median, 1'010'000ns);
+    EXPECT_EQ(large.percentile(100), 3ms);
+
+    histogram.merge(large);
+    EXPECT_EQ(histogram.count(), 102U);
+    EXPECT_EQ(histogram.max(), 3ms);
+    EXPECT_EQ(histogram.min(), 1ns);
+}
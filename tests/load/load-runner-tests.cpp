@@ -0,0 +1,61 @@
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nhope/async/thread-executor.h"
+#include "nhope/async/timer.h"
+
+#include "royalbed/server/http-status.h"
+#include "royalbed/server/listener.h"
+#include "royalbed/server/router.h"
+#include "royalbed/server/server.h"
+
+#include "helpers/logger.h"
+#include "load/load-runner.h"
+
+namespace {
+using namespace std::literals;
+using namespace royalbed;
+}   // namespace
+
+// The server answers the first request in a second, the open loop misses the requests due meanwhile
+TEST(LoadRunner, OpenLoopStall)   // NOLINT
+{
+    nhope::ThreadExecutor serverThread;
+    nhope::AOContext serverCtx(serverThread);
+
+    auto router = server::Router();
+    router.get("/stall", [](server::RequestContext& ctx) {
+        ctx.response.status = server::HttpStatus::Ok;
+        nhope::Promise<void> promise;
+        auto future = promise.future();
+        nhope::setTimeout(ctx.aoCtx, 1s, [promise = std::move(promise)](auto) mutable {
+            promise.setValue();
+        });
+        return future;
+    });
+    auto listener = server::MemoryListener::create(serverCtx);
+    auto srv = server::Server::start(serverCtx, {
+                                                  .router = std::move(router),
+                                                  .log = nullLogger(),
+                                                  .listener = listener,
+                                                });
+
+    const auto report = load::runLoad({
+      .listener = listener,
+      .duration = 500ms,
+      .rate = 100,
+      .requests = {{.method = "GET", .target = "/stall"}},
+    });
+
+    EXPECT_EQ(report.requests, 1);
+    EXPECT_GT(report.missed, 40);
+
+    // the missed requests are in the latency, not only the answered one
+    EXPECT_EQ(report.latency.count(), report.requests + report.missed);
+    EXPECT_EQ(report.serviceTime.count(), report.requests);
+    EXPECT_GE(report.latency.percentile(50), 200ms);
+    EXPECT_GE(report.latency.max(), 1s);
+}
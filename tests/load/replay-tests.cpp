@@ -0,0 +1,78 @@
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nhope/async/thread-executor.h"
+#include "nhope/io/io-device.h"
+#include "nhope/io/string-reader.h"
+
+#include "royalbed/client/client-pool.h"
+#include "royalbed/common/traffic-log.h"
+#include "royalbed/server/http-status.h"
+#include "royalbed/server/router.h"
+#include "royalbed/server/traffic-capture.h"
+
+#include "helpers/invoke.h"
+#include "helpers/memory-server.h"
+#include "load/replay.h"
+
+namespace {
+using namespace royalbed;
+}   // namespace
+
+// A chunked body is captured decoded and replayed with its length
+TEST(Replay, ChunkedBody)   // NOLINT
+{
+    const auto path = std::filesystem::temp_directory_path() / "replay-chunked-body";
+    auto log = std::make_shared<common::TrafficLogWriter>(path);
+
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    std::atomic<int> received{0};
+    MemoryServer srv(serverCtx, [&log, &received] {
+        auto router = server::Router();
+        router.addMiddleware(server::captureTraffic({.log = log}));
+        router.post("/echo", [&received](server::RequestContext& ctx) {
+            return nhope::readAll(*ctx.request.body).then(ctx.aoCtx, [&ctx, &received](auto body) {
+                const bool decoded = std::string(body.begin(), body.end()) == "hello world";
+                ctx.response.status = decoded ? server::HttpStatus::Ok : server::HttpStatus::BadRequest;
+                ++received;
+            });
+        });
+        return router;
+    });
+
+    auto pool = client::ClientPool::create(clientCtx, {.connect = srv.connector()});
+    auto sent = invoke(clientCtx, [&] {
+        return pool->sendRequest({
+          .method = "POST",
+          .uri = {.host = "memory", .path = "/echo"},
+          .headers = {{"Transfer-Encoding", "chunked"}},
+          .body = nhope::StringReader::create(clientCtx, "5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n"),
+        });
+    });
+    EXPECT_EQ(sent.get().status, client::HttpStatus::Ok);
+    log.reset();
+
+    const auto requests = load::readTrafficLog(path);
+    ASSERT_EQ(requests.size(), 1);
+    EXPECT_TRUE(requests.front().bodyCaptured);
+    EXPECT_EQ(requests.front().body, "hello world");
+
+    const auto report = load::replayTraffic({.listener = srv.listener(), .speed = 0}, requests);
+    EXPECT_EQ(report.requests, 1);
+    EXPECT_EQ(report.errors, 0);
+    EXPECT_EQ(report.failedResponses, 0);
+    EXPECT_EQ(received, 2);
+    std::filesystem::remove(path);
+}
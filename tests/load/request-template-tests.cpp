@@ -0,0 +1,98 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "load/load-runner.h"
+#include "load/request-template.h"
+
+namespace {
+using namespace royalbed::load;
+using namespace royalbed::load::detail;
+
+const Target target{.host = "localhost", .port = 8080};
+
+}   // namespace
+
+TEST(RequestTemplate, ParseVariable)   // NOLINT
+{
+    const auto range = parseTemplateVariable("id=1..100");
+    EXPECT_EQ(range.name, "id");
+    EXPECT_TRUE(range.values.empty());
+    EXPECT_EQ(range.min, 1);
+    EXPECT_EQ(range.max, 100);
+
+    const auto list = parseTemplateVariable("name=a,b,c");
+    EXPECT_EQ(list.values, (std::vector<std::string>{"a", "b", "c"}));
+
+    // ".." in a value that is not a range of integers
+    EXPECT_EQ(parseTemplateVariable("v=a..b").values, std::vector<std::string>{"a..b"});
+    EXPECT_EQ(parseTemplateVariable("v=x,1..2").values, (std::vector<std::string>{"x", "1..2"}));
+
+    EXPECT_THROW(parseTemplateVariable("=a"), std::invalid_argument);      // NOLINT
+    EXPECT_THROW(parseTemplateVariable("name"), std::invalid_argument);    // NOLINT
+    EXPECT_THROW(parseTemplateVariable("n=5..1"), std::invalid_argument);   // NOLINT
+}
+
+TEST(RequestTemplate, InvalidPlaceholder)   // NOLINT
+{
+    const std::vector variables{parseTemplateVariable("id=1..10")};
+
+    const RequestTemplate unclosed{.method = "GET", .target = "/vru/{{id"};
+    EXPECT_THROW(CompiledTemplate(target, unclosed, variables), std::invalid_argument);   // NOLINT
+
+    const RequestTemplate unclosedBody{.method = "POST", .target = "/vru", .body = "{{id}} {{id"};
+    EXPECT_THROW(CompiledTemplate(target, unclosedBody, variables), std::invalid_argument);   // NOLINT
+
+    const RequestTemplate unknown{.method = "GET", .target = "/vru/{{name}}"};
+    EXPECT_THROW(CompiledTemplate(target, unknown, variables), std::invalid_argument);   // NOLINT
+}
+
+TEST(RequestTemplate, Variables)   // NOLINT
+{
+    const std::vector variables{
+      parseTemplateVariable("id=1..1000000"),
+      parseTemplateVariable("name=a..b"),
+    };
+    const RequestTemplate tmpl{
+      .method = "POST",
+      .target = "/vru/{{id}}",
+      .headers = {{"X-Name", "{{name}}"}},
+      .body = "{{id}}|{{id}}|{{conn}}|{{seq}}|{{name}}",
+    };
+    const CompiledTemplate compiled(target, tmpl, variables);
+
+    TemplateState state{.connection = 3, .seq = 7};
+    const auto request = compiled.make(state);
+    EXPECT_EQ(request->method, "POST");
+
+    // a variable used several times has the same value in all the places
+    const auto id = request->uri.toString().substr(std::string("/vru/").size());
+    EXPECT_EQ(request->body, id + "|" + id + "|3|7|a..b");
+    EXPECT_EQ(request->headers.at("X-Name"), "a..b");
+    EXPECT_EQ(request->headers.at("Content-Length"), std::to_string(request->body.size()));
+
+    ++state.seq;
+    EXPECT_NE(compiled.make(state), request);
+    EXPECT_EQ(compiled.make(state)->body.substr(id.size() * 2 + 2), "3|8|a..b");
+}
+
+TEST(RequestTemplate, WithoutPlaceholders)   // NOLINT
+{
+    const RequestTemplate tmpl{
+      .method = "GET",
+      .target = "/vru",
+      .headers = {{"Accept", "application/json"}},
+      .body = "{id} }}",
+    };
+    const CompiledTemplate compiled(target, tmpl, {parseTemplateVariable("id=1..10")});
+
+    // prepared once and shared by all the requests
+    TemplateState state{.connection = 1};
+    const auto request = compiled.make(state);
+    ++state.seq;
+    EXPECT_EQ(compiled.make(state), request);
+    EXPECT_EQ(request->body, "{id} }}");
+    EXPECT_EQ(request->headers.at("Host"), "localhost:8080");
+}
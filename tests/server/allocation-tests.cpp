@@ -0,0 +1,258 @@
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nhope/async/thread-executor.h"
+#include "nhope/io/string-writter.h"
+#include "spdlog/spdlog.h"
+
+#include "royalbed/common/body.h"
+#include "royalbed/common/coro.h"
+#include "royalbed/server/detail/session.h"
+#include "royalbed/server/detail/web-socket-frame.h"
+#include "royalbed/server/http-status.h"
+#include "royalbed/server/request-context.h"
+#include "royalbed/server/router.h"
+
+#include "helpers/alloc-counter.h"
+#include "helpers/iodevs.h"
+
+namespace {
+using namespace std::literals;
+using namespace royalbed::server;
+using namespace royalbed::server::detail;
+
+using StringWritterPtr = decltype(nhope::StringWritter::create(std::declval<nhope::AOContext&>()));
+
+/**
+ * Runs requests through detail::startSession over in-memory devices and counts the heap allocations
+ * made by the session thread from the start of the session to its end.
+ * A steady-state request must stay under the ceiling of its scenario and must not allocate more than
+ * the previous one, the cost of a header is bounded by the containers that keep it.
+ * The measured count is recorded as the "allocations" test property.
+ */
+class SessionAllocations
+  : public ::testing::Test
+  , public SessionCtx
+{
+protected:
+    // Each header takes at most a map node, its name and its value, the map rehashes log2(n) times
+    static constexpr std::uint64_t maxHeaderAllocations = 3;
+    static constexpr std::uint64_t maxRehashes = 8;
+
+    // Ceilings of a steady-state request. Lower them when allocations are removed from the path,
+    // a request over the ceiling is a regression of the hot path. They are not near zero: the session
+    // and its frames come from the connection frame pool, but Request, Response and Uri still allocate
+    static constexpr std::uint64_t maxGetAllocations = 96;
+    static constexpr std::uint64_t maxJsonPostAllocations = 192;
+    static constexpr std::uint64_t maxNotFoundAllocations = 128;
+    static constexpr std::uint64_t maxWebSocketFrameAllocations = 256;
+
+    // The first request warms the connection frame pool up, the second one is measured
+    std::uint64_t steadyStateAllocations(const std::string& request, std::uint64_t maxAllocations)
+    {
+        this->runSession(request);
+        const auto allocations = this->runSession(request);
+        RecordProperty("allocations", std::to_string(allocations));
+        EXPECT_LE(allocations, maxAllocations) << "allocations per request over the ceiling";
+
+        EXPECT_LE(this->runSession(request), allocations) << "allocations grow from request to request";
+        return allocations;
+    }
+
+    // The session and its coroutine frames allocate from the global heap
+    void disableFramePool() noexcept
+    {
+        m_framePool = nullptr;
+    }
+
+    static std::string extraHeaders(std::size_t count)
+    {
+        std::string headers;
+        for (std::size_t i = 0; i < count; ++i) {
+            headers += "X-Extra-" + std::to_string(i) + ": value\r\n";
+        }
+        return headers;
+    }
+
+    Router m_router;
+
+private:
+    std::uint64_t runSession(const std::string& request)
+    {
+        // the devices outlive the sessions, like the connection socket
+        auto& in = m_inputs.emplace_back(inputStream(m_aoCtx, request));
+        auto& out = m_outputs.emplace_back(nhope::StringWritter::create(m_aoCtx));
+
+        m_finished = {};
+        auto finished = m_finished.get_future();
+
+        m_aoCtx.exec([this, &in, &out] {
+            m_startCount = threadAllocationCount();
+            startSession(m_aoCtx, SessionParams{
+                                    .ctx = *this,
+                                    .in = *in,
+                                    .out = *out,
+                                    .log = m_log,
+                                    .framePool = m_framePool,
+                                  });
+        });
+
+        if (finished.wait_for(1s) != std::future_status::ready) {
+            ADD_FAILURE() << "session has not finished";
+            return UINT64_MAX;
+        }
+        m_lastResponse = out->takeContent();
+        return finished.get();
+    }
+
+    [[nodiscard]] const Router& router() const noexcept override
+    {
+        return m_router;
+    }
+
+    void sessionReceivedRequest(std::uint32_t /*sessionNum*/) noexcept override
+    {}
+
+    void sessionFinished(std::uint32_t /*sessionNum*/, bool /*keepAlive*/) noexcept override
+    {
+        const auto count = threadAllocationCount() - m_startCount;
+        m_finished.set_value(count);
+    }
+
+    bool sessionNeedClose() noexcept override
+    {
+        return false;
+    }
+
+    gsl::span<std::uint8_t> drainBuffer() override
+    {
+        return m_drainBuf;
+    }
+
+protected:
+    std::string m_lastResponse;
+
+private:
+    std::shared_ptr<spdlog::logger> m_log = std::make_shared<spdlog::logger>("allocations", spdlog::sinks_init_list{});
+    royalbed::common::FramePoolPtr m_framePool = std::make_shared<royalbed::common::FramePool>();
+    std::array<std::uint8_t, 4096> m_drainBuf{};
+
+    nhope::ThreadExecutor m_executor;
+    nhope::AOContext m_aoCtx{m_executor};
+
+    std::vector<nhope::PushbackReaderPtr> m_inputs;
+    std::vector<StringWritterPtr> m_outputs;
+
+    std::uint64_t m_startCount = 0;
+    std::promise<std::uint64_t> m_finished;
+};
+
+struct Point
+{
+    int x;
+    int y;
+};
+
+void from_json(const nlohmann::json& json, Point& p)
+{
+    json.at("x").get_to(p.x);
+    json.at("y").get_to(p.y);
+}
+
+void to_json(nlohmann::json& json, const Point& p)
+{
+    json = {{"x", p.x}, {"y", p.y}};
+}
+
+}   // namespace
+
+TEST_F(SessionAllocations, Get)   // NOLINT
+{
+    m_router.get("/ping", [](RequestContext& ctx) {
+        ctx.response.status = HttpStatus::Ok;
+        return nhope::makeReadyFuture();
+    });
+
+    const auto allocations =
+      steadyStateAllocations("GET /ping HTTP/1.1\r\nHost: localhost\r\n\r\n", maxGetAllocations);
+    EXPECT_NE(m_lastResponse.find("HTTP/1.1 200 OK\r\n"), std::string::npos);
+
+    constexpr std::size_t headerCount = 16;
+    const auto maxWithHeaders = allocations + headerCount * maxHeaderAllocations + maxRehashes;
+    steadyStateAllocations("GET /ping HTTP/1.1\r\nHost: localhost\r\n" + extraHeaders(headerCount) + "\r\n",
+                           maxWithHeaders);
+}
+
+TEST_F(SessionAllocations, FramePool)   // NOLINT
+{
+    m_router.get("/ping", [](RequestContext& ctx) {
+        ctx.response.status = HttpStatus::Ok;
+        return nhope::makeReadyFuture();
+    });
+
+    const auto request = "GET /ping HTTP/1.1\r\nHost: localhost\r\n\r\n"s;
+    const auto pooled = steadyStateAllocations(request, maxGetAllocations);
+    disableFramePool();
+    const auto unpooled = steadyStateAllocations(request, std::numeric_limits<std::uint64_t>::max());
+
+    // at least the session object and the frame of its coroutine are taken from the pool
+    constexpr std::uint64_t minPooledAllocations = 2;
+    EXPECT_GE(unpooled, pooled + minPooledAllocations);
+}
+
+TEST_F(SessionAllocations, JsonPost)   // NOLINT
+{
+    m_router.post("/point", [](const royalbed::common::Body<Point>& body) {
+        const auto& p = body.get();
+        return Point{p.y, p.x};
+    });
+
+    const auto body = R"({"x": 1, "y": 2})"s;
+    steadyStateAllocations(
+      "POST /point HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/json\r\nContent-Length: "
+      + std::to_string(body.size()) + "\r\n\r\n" + body,
+      maxJsonPostAllocations);
+    EXPECT_NE(m_lastResponse.find(R"({"x":2,"y":1})"), std::string::npos);
+}
+
+TEST_F(SessionAllocations, NotFound)   // NOLINT
+{
+    m_router.get("/ping", [](RequestContext& /*ctx*/) {
+        return nhope::makeReadyFuture();
+    });
+
+    steadyStateAllocations("GET /missing HTTP/1.1\r\nHost: localhost\r\n\r\n", maxNotFoundAllocations);
+    EXPECT_NE(m_lastResponse.find("HTTP/1.1 404 Not Found\r\n"), std::string::npos);
+}
+
+TEST_F(SessionAllocations, WebSocketFrame)   // NOLINT
+{
+    m_router.get("/ws", [](RequestContext& ctx) {
+        return ctx.webSocket->readFrame().then(ctx.aoCtx, [&ctx](std::vector<std::uint8_t> payload) {
+            return ctx.webSocket->writeFrame(payload);
+        });
+    });
+
+    const std::vector<std::uint8_t> payload{'h', 'e', 'l', 'l', 'o'};
+    constexpr std::uint32_t maskingKey = 0x12345678;
+    const auto frame = WebSocketFrameParser::createFrame(true, WebSocketFrame::TEXT, true, maskingKey, payload);
+
+    steadyStateAllocations("GET /ws HTTP/1.1\r\nHost: localhost\r\nConnection: Upgrade\r\n"
+                           "Upgrade: websocket\r\nSec-WebSocket-Version: 13\r\n"
+                           "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n\r\n"
+                           + std::string(frame.begin(), frame.end()),
+                           maxWebSocketFrameAllocations);
+    EXPECT_NE(m_lastResponse.find("HTTP/1.1 101"), std::string::npos);
+    EXPECT_NE(m_lastResponse.find("hello"), std::string::npos);
+}
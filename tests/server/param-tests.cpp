@@ -22,8 +22,27 @@ using namespace royalbed::server;
 
 const std::string maxIntStr = std::to_string(std::numeric_limits<int>::max()) + "1";
 
+// Has no default constructor
+struct Identifier
+{
+    explicit Identifier(std::string_view str)
+      : value(str)
+    {}
+
+    std::string value;
+};
+
 }   // namespace
 
+template<>
+Identifier royalbed::common::detail::fromString(std::string_view str)
+{
+    if (str.empty()) {
+        throw std::invalid_argument("empty identifier");
+    }
+    return Identifier(str);
+}
+
 TEST(Param, makeProps)   // NOLINT
 {
     constexpr auto testParam = "someTest"sv;
@@ -44,6 +63,16 @@ TEST(Param, makeProps)   // NOLINT
     }
 }
 
+TEST(Param, checkProperties)   // NOLINT
+{
+    static_assert(checkProperties<int>(42) == ParamError::None);
+    static_assert(checkProperties<int, Required, Min<1>, Max<3>>(2) == ParamError::None);
+    static_assert(checkProperties<int, Min<1>, Max<3>>(0) == ParamError::TooSmall);
+    static_assert(checkProperties<int, Min<1>, Max<3>>(4) == ParamError::TooBig);
+    static_assert(checkProperties<unsigned, Min<-1>>(0U) == ParamError::None);
+    static_assert(checkProperties<double, Max<1>>(1.5) == ParamError::TooBig);
+}
+
 TEST(Param, simple)   // NOLINT
 {
     constexpr auto testParam = "someTest"sv;
@@ -65,7 +94,7 @@ TEST(Param, simple)   // NOLINT
       .num = 1,
       .log = nullLogger(),
       .router = router,
-      .request = {.uri = Uri::parseRelative("/prefix/42/path2/?someTest2=fx")},
+      .request = {.uri = Uri::parseRelative("/prefix/42/path2/?someTest2=fx&ratio=0.5&flag=true")},
       .aoCtx = nhope::AOContext(aoCtx),
     };
     const auto res = router.route("GET", reqCtx.request.uri.path);
@@ -86,6 +115,11 @@ TEST(Param, simple)   // NOLINT
     EXPECT_EQ(param.get(), 42);
     EXPECT_EQ(defParam.get(), 1);
     EXPECT_EQ(qParam.get(), "fx");
+
+    EXPECT_EQ((QueryParam<double, "ratio", Max<1>>(reqCtx).get()), 0.5);
+    EXPECT_TRUE((QueryParam<bool, "flag">(reqCtx).get()));
+    //NOLINTNEXTLINE
+    EXPECT_THROW((QueryParam<int, "ratio">(reqCtx)), HttpError);
 }
 
 TEST(Param, invalid)   // NOLINT
@@ -131,3 +165,40 @@ TEST(Param, invalid)   // NOLINT
         EXPECT_THROW((PathParam<int, "someTest", Min<1>, Max<3>>(reqCtx)), HttpError);
     }
 }
+
+TEST(Param, notDefaultConstructible)   // NOLINT
+{
+    nhope::ThreadExecutor t;
+    nhope::AOContext aoCtx(t);
+    Router router;
+
+    RequestContext reqCtx{
+      .num = 1,
+      .log = nullLogger(),
+      .router = router,
+      .request = {.uri = Uri::parseRelative("/path?id=abc&empty=")},
+      .aoCtx = nhope::AOContext(aoCtx),
+    };
+
+    EXPECT_EQ((QueryParam<Identifier, "id">(reqCtx).get().value), "abc");
+    EXPECT_FALSE((QueryParam<Identifier, "empty">::tryMake(reqCtx)));
+}
+
+TEST(Param, malformedQuery)   // NOLINT
+{
+    nhope::ThreadExecutor t;
+    nhope::AOContext aoCtx(t);
+    Router router;
+
+    RequestContext reqCtx{
+      .num = 1,
+      .log = nullLogger(),
+      .router = router,
+      .request = {.uri = Uri::parseRelative("/path?id=%zz")},
+      .aoCtx = nhope::AOContext(aoCtx),
+    };
+
+    const auto param = QueryParam<std::string, "id">::tryMake(reqCtx);
+    ASSERT_FALSE(param);
+    EXPECT_EQ(param.error().httpStatus(), HttpStatus::BadRequest);
+}
@@ -0,0 +1,326 @@
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "fmt/core.h"
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nhope/async/thread-executor.h"
+#include "nhope/async/timer.h"
+#include "nhope/io/io-device.h"
+#include "nhope/io/string-reader.h"
+
+#include "royalbed/client/client-pool.h"
+#include "royalbed/server/http-status.h"
+#include "royalbed/server/proxy.h"
+#include "royalbed/server/router.h"
+
+#include "helpers/bytes.h"
+#include "helpers/invoke.h"
+#include "helpers/memory-server.h"
+
+namespace {
+
+using namespace royalbed;
+
+server::Router upstreamRouter()
+{
+    auto router = server::Router();
+    router.get("/legacy/hello", [](server::RequestContext& ctx) {
+        ctx.response.status = server::HttpStatus::Ok;
+        ctx.response.headers["Content-Length"] = "5";
+        ctx.response.headers["X-Legacy"] = "1";
+        ctx.response.headers["Keep-Alive"] = "timeout=5";
+        ctx.response.body = nhope::StringReader::create(ctx.aoCtx, "hello");
+        return nhope::makeReadyFuture();
+    });
+    router.post("/legacy/echo", [](server::RequestContext& ctx) {
+        ctx.response.status = server::HttpStatus::Ok;
+        if (const auto it = ctx.request.headers.find("Content-Length"); it != ctx.request.headers.end()) {
+            ctx.response.headers["Content-Length"] = it->second;
+        }
+        ctx.response.headers["X-Forwarded-Host"] = ctx.request.headers["X-Forwarded-Host"];
+        ctx.response.body = std::move(ctx.request.body);
+        return nhope::makeReadyFuture();
+    });
+    // answers before the body is read
+    router.post("/legacy/early", [](server::RequestContext& ctx) {
+        ctx.response.status = server::HttpStatus::Ok;
+        ctx.response.headers["Content-Length"] = "5";
+        ctx.response.body = nhope::StringReader::create(ctx.aoCtx, "early");
+        return nhope::makeReadyFuture();
+    });
+    router.get("/legacy/headers", [](server::RequestContext& ctx) {
+        ctx.response.status = server::HttpStatus::Ok;
+        for (const auto* name : {"X-Secret", "Keep-Alive", "X-Public"}) {
+            ctx.response.headers[fmt::format("X-Seen-{}", name)] = ctx.request.headers.contains(name) ? "1" : "0";
+        }
+        return nhope::makeReadyFuture();
+    });
+    // the length is unknown, the proxy chunks the body again
+    router.get("/legacy/chunked", [](server::RequestContext& ctx) {
+        ctx.response.status = server::HttpStatus::Ok;
+        ctx.response.headers["Transfer-Encoding"] = "chunked";
+        ctx.response.body = nhope::StringReader::create(ctx.aoCtx, "5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n");
+        return nhope::makeReadyFuture();
+    });
+    router.get("/legacy/slow", [](server::RequestContext& ctx) {
+        ctx.response.status = server::HttpStatus::Ok;
+        nhope::Promise<void> promise;
+        auto future = promise.future();
+        nhope::setTimeout(ctx.aoCtx, std::chrono::seconds(1), [promise = std::move(promise)](auto) mutable {
+            promise.setValue();
+        });
+        return future;
+    });
+    return router;
+}
+
+// client -> front server with the proxy -> upstream server, the proxy pool may live in a thread of its own
+struct ProxyChain
+{
+    explicit ProxyChain(nhope::AOContext& aoCtx, client::ClientPoolParams pool = {})
+      : ProxyChain(aoCtx, aoCtx, std::move(pool))
+    {}
+
+    ProxyChain(nhope::AOContext& aoCtx, nhope::AOContext& proxyCtx, client::ClientPoolParams pool = {})
+      : upstream(aoCtx, upstreamRouter)
+      , front(aoCtx, [this, &proxyCtx, pool = std::move(pool)]() mutable {
+          if (pool.connect == nullptr) {
+              pool.connect = upstream.connector();
+          }
+          auto router = server::Router();
+          router.setNotFoundHandler(server::proxyTo(
+            proxyCtx, {
+                        .upstream = client::Uri::parse("http://legacy:8080/legacy"),
+                        .pool = pool,
+                      }));
+          return router;
+      })
+    {}
+
+    client::ClientPoolParams clientParams()
+    {
+        return {.connect = front.connector()};
+    }
+
+    MemoryServer upstream;
+    MemoryServer front;
+};
+
+nhope::Future<client::Response> start(nhope::AOContext& aoCtx, client::ClientPool& pool, client::Request request)
+{
+    return invoke(aoCtx, [&pool, &request] {
+        return pool.sendRequest(std::move(request));
+    });
+}
+
+client::Response send(nhope::AOContext& aoCtx, client::ClientPool& pool, client::Request request)
+{
+    return start(aoCtx, pool, std::move(request)).get();
+}
+
+client::Request post(nhope::AOContext& aoCtx, std::string path, const std::string& content)
+{
+    return {
+      .method = "POST",
+      .uri = {.host = "front", .path = std::move(path)},
+      .headers = {{"Content-Length", std::to_string(content.size())}},
+      .body = nhope::StringReader::create(aoCtx, content),
+    };
+}
+
+}   // namespace
+
+TEST(Proxy, Get)   // NOLINT
+{
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    ProxyChain chain(serverCtx);
+    auto pool = client::ClientPool::create(clientCtx, chain.clientParams());
+
+    for (int i = 0; i < 3; ++i) {
+        auto resp = send(clientCtx, *pool, {.method = "GET", .uri = {.host = "front", .path = "/hello"}});
+        EXPECT_EQ(resp.status, client::HttpStatus::Ok);
+        EXPECT_EQ(asString(nhope::readAll(*resp.body).get()), "hello");
+        EXPECT_EQ(resp.headers["X-Legacy"], "1");
+
+        // hop-by-hop
+        EXPECT_FALSE(resp.headers.contains("Keep-Alive"));
+    }
+}
+
+TEST(Proxy, StreamBody)   // NOLINT
+{
+    constexpr std::size_t bodySize = 1024 * 1024;
+
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    ProxyChain chain(serverCtx);
+    auto pool = client::ClientPool::create(clientCtx, chain.clientParams());
+
+    const std::string content(bodySize, 'x');
+    auto resp = send(clientCtx, *pool,
+                     {
+                       .method = "POST",
+                       .uri = {.host = "front", .path = "/echo"},
+                       .headers = {{"Content-Length", std::to_string(content.size())}},
+                       .body = nhope::StringReader::create(clientCtx, content),
+                     });
+    EXPECT_EQ(resp.status, client::HttpStatus::Ok);
+    EXPECT_EQ(resp.headers["X-Forwarded-Host"], "front:80");
+    EXPECT_EQ(asString(nhope::readAll(*resp.body).get()), content);
+}
+
+TEST(Proxy, UpstreamDown)   // NOLINT
+{
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    ProxyChain chain(serverCtx, {.connect = [](nhope::AOContext& /*aoCtx*/, const std::string& /*host*/,
+                                               std::uint16_t /*port*/) -> nhope::Future<nhope::TcpSocketPtr> {
+                         throw std::system_error(std::make_error_code(std::errc::connection_refused));
+                     }});
+    auto pool = client::ClientPool::create(clientCtx, chain.clientParams());
+
+    auto resp = send(clientCtx, *pool, {.method = "GET", .uri = {.host = "front", .path = "/hello"}});
+    EXPECT_EQ(resp.status, client::HttpStatus::BadGateway);
+}
+
+TEST(Proxy, UpstreamTimeout)   // NOLINT
+{
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    ProxyChain chain(serverCtx, {.requestTimeout = std::chrono::milliseconds(100)});
+    auto pool = client::ClientPool::create(clientCtx, chain.clientParams());
+
+    auto resp = send(clientCtx, *pool, {.method = "GET", .uri = {.host = "front", .path = "/slow"}});
+    EXPECT_EQ(resp.status, client::HttpStatus::GatewayTimeout);
+}
+
+TEST(Proxy, RequestHopByHopHeaders)   // NOLINT
+{
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    ProxyChain chain(serverCtx);
+    auto pool = client::ClientPool::create(clientCtx, chain.clientParams());
+
+    auto resp = send(clientCtx, *pool,
+                     {
+                       .method = "GET",
+                       .uri = {.host = "front", .path = "/headers"},
+                       .headers = {{"Connection", "keep-alive, X-Secret"},
+                                   {"X-Secret", "1"},
+                                   {"Keep-Alive", "timeout=5"},
+                                   {"X-Public", "1"}},
+                     });
+    EXPECT_EQ(resp.status, client::HttpStatus::Ok);
+    EXPECT_EQ(resp.headers["X-Seen-X-Secret"], "0");
+    EXPECT_EQ(resp.headers["X-Seen-Keep-Alive"], "0");
+    EXPECT_EQ(resp.headers["X-Seen-X-Public"], "1");
+}
+
+TEST(Proxy, ChunkedBody)   // NOLINT
+{
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    ProxyChain chain(serverCtx);
+    auto pool = client::ClientPool::create(clientCtx, chain.clientParams());
+
+    for (int i = 0; i < 2; ++i) {
+        auto resp = send(clientCtx, *pool, {.method = "GET", .uri = {.host = "front", .path = "/chunked"}});
+        EXPECT_EQ(resp.status, client::HttpStatus::Ok);
+        EXPECT_EQ(resp.headers["Transfer-Encoding"], "chunked");
+        EXPECT_EQ(asString(nhope::readAll(*resp.body).get()), "hello world");
+    }
+}
+
+// The next request on the connection is read only behind the body the upstream has not waited for
+TEST(Proxy, EarlyResponse)   // NOLINT
+{
+    constexpr std::size_t drainedSize = 32 * 1024;
+    constexpr std::size_t largeSize = 1024 * 1024;
+
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    ProxyChain chain(serverCtx);
+    auto params = chain.clientParams();
+    params.maxConnectionsPerHost = 1;
+    auto pool = client::ClientPool::create(clientCtx, std::move(params));
+
+    for (const auto size : {drainedSize, largeSize}) {
+        auto resp = send(clientCtx, *pool, post(clientCtx, "/early", std::string(size, 'x')));
+        EXPECT_EQ(resp.status, client::HttpStatus::Ok);
+        EXPECT_EQ(asString(nhope::readAll(*resp.body).get()), "early");
+
+        resp = send(clientCtx, *pool, {.method = "GET", .uri = {.host = "front", .path = "/hello"}});
+        EXPECT_EQ(resp.status, client::HttpStatus::Ok);
+        EXPECT_EQ(asString(nhope::readAll(*resp.body).get()), "hello");
+
+        if (size == drainedSize) {
+            // the upstream has drained the body, so it has been forwarded whole and the client connection is kept
+            EXPECT_EQ(chain.front.connectCount, 1);
+        }
+    }
+}
+
+// The sessions and the proxy pool run in different threads, the bodies cross them both ways
+TEST(Proxy, PoolThread)   // NOLINT
+{
+    constexpr int requestCount = 8;
+    constexpr std::size_t bodySize = 256 * 1024;
+
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor proxyThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext proxyCtx(proxyThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    ProxyChain chain(serverCtx, proxyCtx);
+    auto pool = client::ClientPool::create(clientCtx, chain.clientParams());
+
+    std::vector<std::string> contents;
+    std::vector<nhope::Future<client::Response>> responses;
+    for (int i = 0; i < requestCount; ++i) {
+        contents.push_back(std::string(bodySize, static_cast<char>('a' + i)));
+        responses.push_back(start(clientCtx, *pool, post(clientCtx, "/echo", contents.back())));
+        responses.push_back(start(clientCtx, *pool, {.method = "GET", .uri = {.host = "front", .path = "/chunked"}}));
+    }
+    for (int i = 0; i < requestCount; ++i) {
+        auto echo = responses[2 * i].get();
+        EXPECT_EQ(echo.status, client::HttpStatus::Ok);
+        EXPECT_EQ(asString(nhope::readAll(*echo.body).get()), contents[i]);
+
+        auto chunked = responses[2 * i + 1].get();
+        EXPECT_EQ(chunked.status, client::HttpStatus::Ok);
+        EXPECT_EQ(asString(nhope::readAll(*chunked.body).get()), "hello world");
+    }
+}
@@ -3,6 +3,7 @@
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <type_traits>
 #include <typeinfo>
 #include <utility>
@@ -13,13 +14,16 @@
 #include "nhope/async/ao-context.h"
 #include "nhope/async/future.h"
 #include "nhope/async/thread-executor.h"
+#include "nhope/async/timer.h"
 #include "nhope/io/io-device.h"
 #include "nhope/io/string-reader.h"
 #include "nhope/utils/type.h"
 
 #include "nlohmann/json.hpp"
 #include "royalbed/common/body.h"
+#include "royalbed/common/coro.h"
 #include "royalbed/server/error.h"
+#include "royalbed/server/http-status.h"
 #include "royalbed/server/low-level-handler.h"
 #include "royalbed/server/middleware.h"
 #include "royalbed/server/request-context.h"
@@ -40,6 +44,17 @@ LowLevelHandler makeHandler(std::string_view status)
     };
 }
 
+// Settled by a timer of the context, a coroutine awaiting it really suspends
+nhope::Future<void> later(nhope::AOContext& aoCtx)
+{
+    auto promise = std::make_shared<nhope::Promise<void>>();
+    auto future = promise->future();
+    nhope::setTimeout(aoCtx, 10ms, [promise](auto) {
+        promise->setValue();
+    });
+    return future;
+}
+
 class HandlerTester
 {
     Router& m_router;
@@ -146,6 +161,13 @@ TEST(Router, ExtractParamsFromPath)   // NOLINT
         EXPECT_EQ(r.rawPathParams, etalon);
     }
 
+    {
+        const auto etalon = RawPathParams{{"a1", "1000"}, {"a2", "2000"}};
+
+        const auto r = router.route("GET", "//prefix/./1000/x/../path2/2000//aaaaa/");
+        EXPECT_EQ(r.rawPathParams, etalon);
+    }
+
     {
         const auto etalon = RawPathParams{{"b1", "3000"}, {"b2", "4000"}};
 
@@ -411,6 +433,45 @@ TEST(Router, HightLevelHandler)   // NOLINT
     }
 }
 
+TEST(Router, CoroutineHandler)   // NOLINT
+{
+    Router router;
+
+    using intP = PathParam<int, "val">;
+    router.get("/some/:val", [](const intP& p, RequestContext& ctx) -> nhope::Future<int> {
+        // the parameters live until the first suspension only
+        const int val = p.get();
+        co_await later(ctx.aoCtx);
+        co_return val + 2;
+    });
+
+    router.get("/low-level", [](RequestContext& ctx) -> nhope::Future<void> {
+        const auto thread = std::this_thread::get_id();
+        co_await later(ctx.aoCtx);
+        EXPECT_EQ(std::this_thread::get_id(), thread);
+        ctx.response.statusMessage = "resumed";
+    });
+
+    nhope::ThreadExecutor th;
+
+    RequestContext ctx{
+      .num = 1,
+      .router = router,
+      .rawPathParams = {{"val", "40"}},
+      .aoCtx = nhope::AOContext(th),
+    };
+    {
+        router.route("GET", "/some/40").handler(ctx).get();
+        const auto body = nhope::readAll(*ctx.response.body).get();
+        const auto json = nlohmann::json::parse(body.begin(), body.end());
+        EXPECT_EQ(json.get<int>(), 42);
+    }
+    {
+        router.route("GET", "/low-level").handler(ctx).get();
+        EXPECT_EQ(ctx.response.statusMessage, "resumed");
+    }
+}
+
 TEST(Router, BodyHandler)   // NOLINT
 {
     Router router;
@@ -467,3 +528,47 @@ TEST(Router, ExceptionHandler)   // NOLINT
     test.check("GET", "/some", "FAIL");
     test.check("GET", "/", "FAIL");
 }
+
+TEST(Router, BadRequestErrorChannel)   // NOLINT
+{
+    using intP = PathParam<int, "val">;
+
+    Router router;
+    router.get("/some/:val", [](const intP& p) {
+        return p.get();
+    });
+    router.post("/some/", [](const royalbed::common::Body<int>& body) {
+        return body.get();
+    });
+
+    nhope::ThreadExecutor th;
+    RequestContext ctx{
+      .num = 1,
+      .router = router,
+      .rawPathParams = {{"val", "forty"}},
+      .aoCtx = nhope::AOContext(th),
+    };
+
+    router.route("GET", "/some/forty").handler(ctx).get();
+    EXPECT_EQ(ctx.response.status, HttpStatus::BadRequest);
+    EXPECT_FALSE(ctx.error.has_value());
+
+    // there is no Content-Type header
+    ctx.response = {};
+    router.route("POST", "/some").handler(ctx).get();
+    EXPECT_EQ(ctx.response.status, HttpStatus::BadRequest);
+
+    // a user exception handler still gets HttpError
+    router.setExceptionHandler([](RequestContext& ctx, std::exception_ptr e) {
+        try {
+            std::rethrow_exception(std::move(e));
+        } catch (const HttpError& err) {
+            ctx.response.status = err.httpStatus();
+            ctx.response.statusMessage = "FAIL";
+        }
+    });
+    ctx.response = {};
+    router.route("GET", "/some/forty").handler(ctx).get();
+    EXPECT_EQ(ctx.response.status, HttpStatus::BadRequest);
+    EXPECT_EQ(ctx.response.statusMessage, "FAIL");
+}
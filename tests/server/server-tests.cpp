@@ -20,6 +20,7 @@
 #include "royalbed/client/detail/send-request.h"
 
 #include "royalbed/server/http-status.h"
+#include "royalbed/server/listener.h"
 #include "royalbed/server/server.h"
 #include "royalbed/server/router.h"
 
@@ -86,3 +87,41 @@ TEST(Server, Echo)   // NOLINT
         EXPECT_EQ(send(data), data);
     }
 }
+
+TEST(Server, MemoryListener)   // NOLINT
+{
+    nhope::ThreadExecutor serverThread;
+    nhope::ThreadExecutor clientThread;
+    nhope::AOContext serverCtx(serverThread);
+    nhope::AOContext clientCtx(clientThread);
+
+    auto router = Router();
+    router.get("/ping/:n", [](RequestContext& ctx) {
+        ctx.response.status = HttpStatus::Ok;
+        ctx.response.body = nhope::StringReader::create(ctx.aoCtx, std::string(ctx.rawPathParams.front().second));
+        return nhope::makeReadyFuture();
+    });
+
+    auto listener = MemoryListener::create(serverCtx, {.maxSegmentSize = 7});
+    auto srv = Server::start(serverCtx, {
+                                          .router = std::move(router),
+                                          .log = nullLogger(),
+                                          .listener = listener,
+                                        });
+
+    // keep-alive requests over one connection, every read gets at most 7 bytes
+    auto sock = listener->connect(clientCtx);
+    auto reader = nhope::PushbackReader::create(clientCtx, *sock);
+    for (int i = 0; i < 3; ++i) {
+        auto resp = client::detail::makeRequest(clientCtx,
+                                                {
+                                                  .method = "GET",
+                                                  .uri = {.path = fmt::format("/ping/{}", i)},
+                                                  .headers = {{"Host", "memory"}},
+                                                },
+                                                *sock, *reader)
+                      .get();
+        EXPECT_EQ(resp.status, HttpStatus::Ok);
+        EXPECT_EQ(asString(nhope::readAll(*resp.body).get()), std::to_string(i));
+    }
+}
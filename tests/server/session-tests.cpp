@@ -1,3 +1,5 @@
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <stdexcept>
@@ -15,14 +17,18 @@
 #include "nhope/async/async-invoke.h"
 #include "nhope/async/future.h"
 #include "nhope/async/thread-executor.h"
+#include "nhope/async/timer.h"
 #include "nhope/io/io-device.h"
 
 #include "nhope/io/string-writter.h"
 
+#include "royalbed/common/coro.h"
+#include "royalbed/server/detail/receive-request.h"
 #include "royalbed/server/detail/session.h"
 #include "royalbed/server/error.h"
 #include "royalbed/server/http-status.h"
 #include "royalbed/server/request-context.h"
+#include "royalbed/server/response.h"
 #include "royalbed/server/router.h"
 
 #include "helpers/iodevs.h"
@@ -33,6 +39,17 @@ using namespace std::literals;
 using namespace royalbed::server;
 using namespace royalbed::server::detail;
 
+// Settled by a timer of the context, a coroutine awaiting it really suspends
+nhope::Future<void> later(nhope::AOContext& aoCtx)
+{
+    auto promise = std::make_shared<nhope::Promise<void>>();
+    auto future = promise->future();
+    nhope::setTimeout(aoCtx, 10ms, [promise](auto) {
+        promise->setValue();
+    });
+    return future;
+}
+
 class TestSessionCtx final : public SessionCtx
 {
 public:
@@ -48,8 +65,9 @@ public:
     void sessionReceivedRequest(std::uint32_t /*sessionNum*/) noexcept override
     {}
 
-    void sessionFinished(std::uint32_t /*sessionNum*/, bool /*success*/) noexcept override
+    void sessionFinished(std::uint32_t /*sessionNum*/, bool keepAlive) noexcept override
     {
+        m_keepAlive = keepAlive;
         m_event.set();
     }
 
@@ -58,14 +76,26 @@ public:
         return false;
     }
 
+    gsl::span<std::uint8_t> drainBuffer() override
+    {
+        return m_drainBuf;
+    }
+
     bool wait(std::chrono::nanoseconds timeout)
     {
         return m_event.waitFor(timeout);
     }
 
+    [[nodiscard]] bool keepAlive() const noexcept
+    {
+        return m_keepAlive;
+    }
+
 private:
     Router m_router;
+    std::array<std::uint8_t, 4096> m_drainBuf{};
     nhope::Event m_event;
+    std::atomic<bool> m_keepAlive{};
 };
 
 }   // namespace
@@ -143,6 +173,56 @@ TEST(Session, OnlyMiddlewares)   // NOLINT
     EXPECT_EQ(handlerCounter, 0);
 }
 
+TEST(Session, SyncMiddlewares)   // NOLINT
+{
+    auto router = Router();
+    std::atomic<int> middlewareCounter = 0;
+    router.addMiddleware([&](RequestContext& /*ctx*/) {
+        ++middlewareCounter;
+        return true;
+    });
+
+    router.addMiddleware([&](RequestContext& ctx) {
+        ++middlewareCounter;
+        return nhope::makeReadyFuture<bool>(ctx.request.uri.path == "/path");
+    });
+
+    router.addMiddleware([&](RequestContext& ctx) -> bool {
+        ++middlewareCounter;
+        if (ctx.request.method == "POST") {
+            throw HttpError(HttpStatus::Forbidden);
+        }
+        return true;
+    });
+
+    std::atomic<int> handlerCounter = 0;
+    router.post("/path", [&](RequestContext& /*ctx*/) {
+        ++handlerCounter;
+        return nhope::makeReadyFuture();
+    });
+
+    auto executor = nhope::ThreadExecutor();
+    auto aoCtx = nhope::AOContext(executor);
+    TestSessionCtx testSessionCtx(std::move(router));
+
+    auto in = inputStream(aoCtx, "POST /path HTTP/1.1\r\n\r\n");
+    auto out = nhope::StringWritter::create(aoCtx);
+
+    startSession(aoCtx, SessionParams{
+                          .ctx = testSessionCtx,
+                          .in = *in,
+                          .out = *out,
+                          .log = nullLogger(),
+                        });
+
+    EXPECT_TRUE(testSessionCtx.wait(1s));
+
+    const auto response = out->takeContent();
+    EXPECT_TRUE(response.find("HTTP/1.1 403 Forbidden\r\n") != std::string::npos);
+    EXPECT_EQ(middlewareCounter, 3);
+    EXPECT_EQ(handlerCounter, 0);
+}
+
 TEST(Session, MiddlewaresAndHandler)   // NOLINT
 {
     auto router = Router();
@@ -183,6 +263,42 @@ TEST(Session, MiddlewaresAndHandler)   // NOLINT
     EXPECT_EQ(handlerCounter, 1);
 }
 
+TEST(Session, CoroutineMiddlewareAndHandler)   // NOLINT
+{
+    auto router = Router();
+    router.addMiddleware([](RequestContext& ctx) -> nhope::Future<bool> {
+        co_await later(ctx.aoCtx);
+        ctx.response.headers["X-Middleware"] = "1";
+        co_return true;
+    });
+
+    router.get("/path", [](RequestContext& ctx) -> nhope::Future<void> {
+        EXPECT_EQ(ctx.response.headers["X-Middleware"], "1");
+        co_await later(ctx.aoCtx);
+        ctx.response.status = HttpStatus::Accepted;
+    });
+
+    auto executor = nhope::ThreadExecutor();
+    auto aoCtx = nhope::AOContext(executor);
+    TestSessionCtx testSessionCtx(std::move(router));
+
+    auto in = inputStream(aoCtx, "GET /path HTTP/1.1\r\nConnection: close\r\n\r\n");
+    auto out = nhope::StringWritter::create(aoCtx);
+
+    startSession(aoCtx, SessionParams{
+                          .ctx = testSessionCtx,
+                          .in = *in,
+                          .out = *out,
+                          .log = nullLogger(),
+                        });
+
+    EXPECT_TRUE(testSessionCtx.wait(1s));
+
+    const auto response = out->takeContent();
+    EXPECT_TRUE(response.find("HTTP/1.1 202 Accepted\r\n") != std::string::npos);
+    EXPECT_TRUE(response.find("X-Middleware: 1\r\n") != std::string::npos);
+}
+
 TEST(Session, ExceptionInHandler)   // NOLINT
 {
     auto router = Router();
@@ -296,3 +412,246 @@ TEST(Session, NoContent)   // NOLINT
     const auto response = out->takeContent();
     EXPECT_TRUE(response.find("HTTP/1.1 204 No Content\r\n") != std::string::npos);
 }
+
+TEST(Session, ExpectContinue)   // NOLINT
+{
+    auto router = Router();
+    router.post("/path", [](RequestContext& ctx) {
+        return nhope::readAll(*ctx.request.body).then(ctx.aoCtx, [&ctx](auto body) {
+            EXPECT_EQ(std::string(body.begin(), body.end()), "body");
+            ctx.response.status = HttpStatus::Ok;
+        });
+    });
+
+    auto executor = nhope::ThreadExecutor();
+    auto aoCtx = nhope::AOContext(executor);
+    TestSessionCtx testSessionCtx(std::move(router));
+
+    auto in = inputStream(aoCtx, "POST /path HTTP/1.1\r\n"
+                                 "Expect: 100-continue\r\n"
+                                 "Content-Length: 4\r\n"
+                                 "Connection: close\r\n"
+                                 "\r\n"
+                                 "body");
+    auto out = nhope::StringWritter::create(aoCtx);
+    startSession(aoCtx, SessionParams{
+                          .ctx = testSessionCtx,
+                          .in = *in,
+                          .out = *out,
+                          .log = nullLogger(),
+                        });
+
+    EXPECT_TRUE(testSessionCtx.wait(1s));
+
+    const auto response = out->takeContent();
+    EXPECT_TRUE(response.starts_with("HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 200 OK\r\n"));
+}
+
+TEST(Session, ExpectContinueEcho)   // NOLINT
+{
+    auto router = Router();
+    router.post("/echo", [](RequestContext& ctx) {
+        ctx.response.status = HttpStatus::Ok;
+        ctx.response.headers["Content-Length"] = ctx.request.headers["Content-Length"];
+        ctx.response.body = std::move(ctx.request.body);
+        return nhope::makeReadyFuture();
+    });
+
+    auto executor = nhope::ThreadExecutor();
+    auto aoCtx = nhope::AOContext(executor);
+    TestSessionCtx testSessionCtx(std::move(router));
+
+    auto in = inputStream(aoCtx, "POST /echo HTTP/1.1\r\n"
+                                 "Expect: 100-continue\r\n"
+                                 "Content-Length: 4\r\n"
+                                 "\r\n"
+                                 "body");
+    auto out = nhope::StringWritter::create(aoCtx);
+    startSession(aoCtx, SessionParams{
+                          .ctx = testSessionCtx,
+                          .in = *in,
+                          .out = *out,
+                          .log = nullLogger(),
+                        });
+
+    EXPECT_TRUE(testSessionCtx.wait(1s));
+    EXPECT_TRUE(testSessionCtx.keepAlive());
+
+    // the interim response goes before the final head, not into the body
+    const auto response = out->takeContent();
+    EXPECT_TRUE(response.starts_with("HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 200 OK\r\n"));
+    EXPECT_TRUE(response.ends_with("\r\n\r\nbody"));
+    EXPECT_EQ(response.find("100 Continue", 1), std::string::npos);
+}
+
+TEST(Session, ExpectContinueRejectedByMiddleware)   // NOLINT
+{
+    auto router = Router();
+    router.addMiddleware([](RequestContext& ctx) {
+        ctx.response = royalbed::common::makePlainTextResponse(ctx.aoCtx, HttpStatus::Unauthorized, "unauthorized");
+        return nhope::makeReadyFuture<bool>(false);
+    });
+    router.post("/path", [](RequestContext& ctx) {
+        return nhope::readAll(*ctx.request.body).then([](auto) {});
+    });
+
+    auto executor = nhope::ThreadExecutor();
+    auto aoCtx = nhope::AOContext(executor);
+    TestSessionCtx testSessionCtx(std::move(router));
+
+    auto in = inputStream(aoCtx, "POST /path HTTP/1.1\r\n"
+                                 "Expect: 100-continue\r\n"
+                                 "Content-Length: 4\r\n"
+                                 "\r\n");
+    auto out = nhope::StringWritter::create(aoCtx);
+    startSession(aoCtx, SessionParams{
+                          .ctx = testSessionCtx,
+                          .in = *in,
+                          .out = *out,
+                          .log = nullLogger(),
+                        });
+
+    EXPECT_TRUE(testSessionCtx.wait(1s));
+
+    const auto response = out->takeContent();
+    EXPECT_TRUE(response.starts_with("HTTP/1.1 401 Unauthorized\r\n"));
+    EXPECT_TRUE(response.find("Connection: close\r\n") != std::string::npos);
+}
+
+TEST(Session, ExpectationFailed)   // NOLINT
+{
+    auto router = Router();
+    router.post("/path", [](RequestContext& /*ctx*/) {
+        return nhope::makeReadyFuture();
+    });
+
+    auto executor = nhope::ThreadExecutor();
+    auto aoCtx = nhope::AOContext(executor);
+    TestSessionCtx testSessionCtx(std::move(router));
+
+    auto in = inputStream(aoCtx, "POST /path HTTP/1.1\r\nExpect: something\r\nConnection: close\r\n\r\n");
+    auto out = nhope::StringWritter::create(aoCtx);
+    startSession(aoCtx, SessionParams{
+                          .ctx = testSessionCtx,
+                          .in = *in,
+                          .out = *out,
+                          .log = nullLogger(),
+                        });
+
+    EXPECT_TRUE(testSessionCtx.wait(1s));
+
+    const auto response = out->takeContent();
+    EXPECT_TRUE(response.starts_with("HTTP/1.1 417 Expectation Failed\r\n"));
+}
+
+TEST(Session, DrainUnreadBody)   // NOLINT
+{
+    auto router = Router();
+    router.post("/path", [](RequestContext& ctx) {
+        ctx.response.status = HttpStatus::NoContent;
+        return nhope::makeReadyFuture();
+    });
+
+    auto executor = nhope::ThreadExecutor();
+    auto aoCtx = nhope::AOContext(executor);
+    TestSessionCtx testSessionCtx(std::move(router));
+
+    auto in = inputStream(aoCtx, "POST /path HTTP/1.1\r\nContent-Length: 10\r\n\r\n1234567890"
+                                 "GET /next HTTP/1.1\r\n\r\n");
+    auto out = nhope::StringWritter::create(aoCtx);
+    startSession(aoCtx, SessionParams{
+                          .ctx = testSessionCtx,
+                          .in = *in,
+                          .out = *out,
+                          .log = nullLogger(),
+                          .maxDrainBodySize = 10,
+                        });
+
+    EXPECT_TRUE(testSessionCtx.wait(1s));
+    EXPECT_TRUE(testSessionCtx.keepAlive());
+
+    // the next request must start right after the drained body
+    const auto next = receiveRequest(aoCtx, *in).get();
+    EXPECT_EQ(next.uri.path, "/next");
+}
+
+TEST(Session, DrainUnreadBodyLimit)   // NOLINT
+{
+    auto router = Router();
+    router.post("/path", [](RequestContext& ctx) {
+        ctx.response.status = HttpStatus::NoContent;
+        return nhope::makeReadyFuture();
+    });
+
+    auto executor = nhope::ThreadExecutor();
+    auto aoCtx = nhope::AOContext(executor);
+    TestSessionCtx testSessionCtx(std::move(router));
+
+    auto in = inputStream(aoCtx, "POST /path HTTP/1.1\r\nContent-Length: 10\r\n\r\n1234567890");
+    auto out = nhope::StringWritter::create(aoCtx);
+    startSession(aoCtx, SessionParams{
+                          .ctx = testSessionCtx,
+                          .in = *in,
+                          .out = *out,
+                          .log = nullLogger(),
+                          .maxDrainBodySize = 4,
+                        });
+
+    EXPECT_TRUE(testSessionCtx.wait(1s));
+    EXPECT_FALSE(testSessionCtx.keepAlive());
+}
+
+TEST(Session, DrainUnreadBodyDeclaredTooLarge)   // NOLINT
+{
+    auto router = Router();
+    router.post("/path", [](RequestContext& ctx) {
+        ctx.response.status = HttpStatus::NoContent;
+        return nhope::makeReadyFuture();
+    });
+
+    auto executor = nhope::ThreadExecutor();
+    auto aoCtx = nhope::AOContext(executor);
+    TestSessionCtx testSessionCtx(std::move(router));
+
+    auto in = inputStream(aoCtx, "POST /path HTTP/1.1\r\nContent-Length: 100000\r\n\r\n1234567890");
+    auto out = nhope::StringWritter::create(aoCtx);
+    startSession(aoCtx, SessionParams{
+                          .ctx = testSessionCtx,
+                          .in = *in,
+                          .out = *out,
+                          .log = nullLogger(),
+                          .maxDrainBodySize = 1024,
+                        });
+
+    EXPECT_TRUE(testSessionCtx.wait(1s));
+    EXPECT_FALSE(testSessionCtx.keepAlive());
+
+    // the body is not read at all
+    const auto rest = nhope::readAll(*in).get();
+    EXPECT_EQ(std::string(rest.begin(), rest.end()), "1234567890");
+}
+
+TEST(Session, MalformedRequestClosesConnection)   // NOLINT
+{
+    auto router = Router();
+
+    auto executor = nhope::ThreadExecutor();
+    auto aoCtx = nhope::AOContext(executor);
+    TestSessionCtx testSessionCtx(std::move(router));
+
+    auto in = inputStream(aoCtx, "GET /path HTTP/1.1\r\nBroken header\r\n\r\nGET /path HTTP/1.1\r\n\r\n");
+    auto out = nhope::StringWritter::create(aoCtx);
+    startSession(aoCtx, SessionParams{
+                          .ctx = testSessionCtx,
+                          .in = *in,
+                          .out = *out,
+                          .log = nullLogger(),
+                        });
+
+    EXPECT_TRUE(testSessionCtx.wait(1s));
+    EXPECT_FALSE(testSessionCtx.keepAlive());
+
+    const auto response = out->takeContent();
+    EXPECT_TRUE(response.find("HTTP/1.1 400 Bad Request\r\n") != std::string::npos);
+    EXPECT_TRUE(response.find("Connection: close\r\n") != std::string::npos);
+}
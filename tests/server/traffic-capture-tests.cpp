@@ -0,0 +1,158 @@
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/event.h"
+#include "nhope/async/future.h"
+#include "nhope/async/thread-executor.h"
+#include "nhope/io/io-device.h"
+#include "nhope/io/string-writter.h"
+
+#include "royalbed/common/traffic-log.h"
+#include "royalbed/server/detail/session.h"
+#include "royalbed/server/http-status.h"
+#include "royalbed/server/request-context.h"
+#include "royalbed/server/router.h"
+#include "royalbed/server/traffic-capture.h"
+
+#include "helpers/iodevs.h"
+#include "helpers/logger.h"
+
+namespace {
+using namespace std::literals;
+using namespace royalbed::server;
+using namespace royalbed::server::detail;
+using royalbed::common::TrafficLogReader;
+using royalbed::common::TrafficLogWriter;
+
+class CaptureSessionCtx final : public SessionCtx
+{
+public:
+    explicit CaptureSessionCtx(Router&& router)
+      : m_router(std::move(router))
+    {}
+
+    [[nodiscard]] const Router& router() const noexcept override
+    {
+        return m_router;
+    }
+
+    void sessionReceivedRequest(std::uint32_t /*sessionNum*/) noexcept override
+    {}
+
+    void sessionFinished(std::uint32_t /*sessionNum*/, bool /*keepAlive*/) noexcept override
+    {
+        m_event.set();
+    }
+
+    bool sessionNeedClose() noexcept override
+    {
+        return false;
+    }
+
+    gsl::span<std::uint8_t> drainBuffer() override
+    {
+        return m_drainBuf;
+    }
+
+    bool wait(std::chrono::nanoseconds timeout)
+    {
+        return m_event.waitFor(timeout);
+    }
+
+private:
+    Router m_router;
+    std::array<std::uint8_t, 4096> m_drainBuf{};
+    nhope::Event m_event;
+};
+
+// Runs one request through a session with the capture middleware, returns the response
+std::string runSession(Router&& router, const std::string& request)
+{
+    auto executor = nhope::ThreadExecutor();
+    auto aoCtx = nhope::AOContext(executor);
+    CaptureSessionCtx sessionCtx(std::move(router));
+
+    auto in = inputStream(aoCtx, request);
+    auto out = nhope::StringWritter::create(aoCtx);
+    startSession(aoCtx, SessionParams{
+                          .ctx = sessionCtx,
+                          .in = *in,
+                          .out = *out,
+                          .log = nullLogger(),
+                        });
+
+    EXPECT_TRUE(sessionCtx.wait(1s));
+    return out->takeContent();
+}
+
+}   // namespace
+
+TEST(TrafficCapture, Body)   // NOLINT
+{
+    const auto path = std::filesystem::temp_directory_path() / "traffic-capture-body";
+    auto log = std::make_shared<TrafficLogWriter>(path);
+
+    auto router = Router();
+    router.addMiddleware(captureTraffic({.log = log}));
+    router.post("/echo", [](RequestContext& ctx) {
+        return nhope::readAll(*ctx.request.body).then(ctx.aoCtx, [&ctx](auto body) {
+            EXPECT_EQ(std::string(body.begin(), body.end()), "hello");
+            ctx.response.status = HttpStatus::Ok;
+        });
+    });
+
+    const auto response = runSession(std::move(router), "POST /echo?x=1 HTTP/1.1\r\n"
+                                                        "Content-Length: 5\r\n"
+                                                        "Connection: close\r\n"
+                                                        "\r\n"
+                                                        "hello");
+    EXPECT_TRUE(response.starts_with("HTTP/1.1 200 OK\r\n"));
+    log.reset();
+
+    TrafficLogReader reader(path);
+    const auto captured = reader.next();
+    ASSERT_TRUE(captured.has_value());
+    EXPECT_EQ(captured->method, "POST");
+    EXPECT_EQ(captured->target, "/echo?x=1");
+    EXPECT_TRUE(captured->bodyCaptured);
+    EXPECT_EQ(captured->body, "hello");
+    EXPECT_FALSE(reader.next().has_value());
+    std::filesystem::remove(path);
+}
+
+TEST(TrafficCapture, ExpectContinueRejected)   // NOLINT
+{
+    const auto path = std::filesystem::temp_directory_path() / "traffic-capture-expect-continue";
+    auto log = std::make_shared<TrafficLogWriter>(path);
+
+    // the handler rejects the request without reading the body, the capture must not ask the client for it
+    auto router = Router();
+    router.addMiddleware(captureTraffic({.log = log}));
+    router.post("/upload", [](RequestContext& ctx) {
+        ctx.response.status = HttpStatus::RequestEntityTooLarge;
+        return nhope::makeReadyFuture();
+    });
+
+    const auto response = runSession(std::move(router), "POST /upload HTTP/1.1\r\n"
+                                                        "Expect: 100-continue\r\n"
+                                                        "Content-Length: 4\r\n"
+                                                        "\r\n");
+    EXPECT_TRUE(response.starts_with("HTTP/1.1 413 Request Entity Too Large\r\n"));
+    EXPECT_EQ(response.find("100 Continue"), std::string::npos);
+    log.reset();
+
+    TrafficLogReader reader(path);
+    const auto captured = reader.next();
+    ASSERT_TRUE(captured.has_value());
+    EXPECT_EQ(captured->target, "/upload");
+    EXPECT_FALSE(captured->bodyCaptured);
+    EXPECT_TRUE(captured->body.empty());
+    std::filesystem::remove(path);
+}
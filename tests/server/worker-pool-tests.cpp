@@ -0,0 +1,234 @@
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <memory>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nhope/async/thread-executor.h"
+#include "nhope/io/io-device.h"
+#include "nhope/io/string-reader.h"
+
+#include "nlohmann/json.hpp"
+#include "royalbed/common/body.h"
+#include "royalbed/common/completion-queue.h"
+#include "royalbed/server/param.h"
+#include "royalbed/server/request-context.h"
+#include "royalbed/server/router.h"
+#include "royalbed/server/worker-pool.h"
+
+namespace {
+using namespace std::literals;
+using namespace royalbed::server;
+}   // namespace
+
+TEST(WorkerPool, Stats)   // NOLINT
+{
+    auto pool = WorkerPool::create({.threadCount = 1, .maxQueueSize = 1});
+
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::atomic<int> done = 0;
+
+    // the first task occupies the only worker, the second one waits in the queue
+    EXPECT_TRUE(pool->post([released, &done] {
+        released.wait();
+        ++done;
+    }));
+    while (pool->stats().activeTasks == 0) {
+        std::this_thread::yield();
+    }
+    EXPECT_TRUE(pool->post([&done] {
+        ++done;
+    }));
+    EXPECT_FALSE(pool->post([] {}));
+
+    auto stats = pool->stats();
+    EXPECT_EQ(stats.queueDepth, 1);
+    EXPECT_EQ(stats.activeTasks, 1);
+    EXPECT_EQ(stats.rejectedTasks, 1);
+
+    std::this_thread::sleep_for(10ms);
+    release.set_value();
+    while (done != 2) {
+        std::this_thread::yield();
+    }
+    while (pool->stats().completedTasks != 2) {
+        std::this_thread::yield();
+    }
+
+    stats = pool->stats();
+    EXPECT_EQ(stats.queueDepth, 0);
+    EXPECT_GE(stats.maxWaitTime, 10ms);
+    EXPECT_GE(stats.totalWaitTime, stats.maxWaitTime);
+}
+
+TEST(WorkerPool, OffloadHandler)   // NOLINT
+{
+    auto pool = WorkerPool::create({.threadCount = 2});
+    const auto ioThread = std::this_thread::get_id();
+
+    using ValP = PathParam<int, "val">;
+    Router router;
+    router.get("/twice/:val", offload(pool, [ioThread](const ValP& p) {
+                   EXPECT_NE(std::this_thread::get_id(), ioThread);
+                   return p.get() * 2;
+               }));
+    router.get("/fail", offload(pool, [] {
+                   throw HttpError(HttpStatus::Conflict);
+               }));
+
+    nhope::ThreadExecutor th;
+    RequestContext ctx{
+      .num = 1,
+      .router = router,
+      .rawPathParams = {{"val", "21"}},
+      .aoCtx = nhope::AOContext(th),
+    };
+
+    router.route("GET", "/twice/21").handler(ctx).get();
+    const auto body = nhope::readAll(*ctx.response.body).get();
+    const auto json = nlohmann::json::parse(body.begin(), body.end());
+    EXPECT_EQ(json.get<int>(), 42);
+
+    router.route("GET", "/fail").handler(ctx).get();
+    EXPECT_EQ(ctx.response.status, HttpStatus::Conflict);
+
+    while (pool->stats().completedTasks != 2) {
+        std::this_thread::yield();
+    }
+}
+
+TEST(WorkerPool, OffloadBodyHandler)   // NOLINT
+{
+    auto pool = WorkerPool::create({.threadCount = 1});
+
+    Router router;
+    router.post("/inc", offload(pool, [](const royalbed::common::Body<int>& body) {
+                    return body.get() + 1;
+                }));
+
+    nhope::ThreadExecutor th;
+    nhope::AOContext ao(th);
+    Request req;
+    req.body = nhope::StringReader::create(ao, "41");
+    req.headers.emplace("Content-type", "application/json");
+
+    RequestContext ctx{
+      .num = 1,
+      .router = router,
+      .request = std::move(req),
+      .aoCtx = nhope::AOContext(th),
+    };
+    router.route("POST", "/inc").handler(ctx).get();
+    const auto body = nhope::readAll(*ctx.response.body).get();
+    const auto json = nlohmann::json::parse(body.begin(), body.end());
+    EXPECT_EQ(json.get<int>(), 42);
+}
+
+TEST(WorkerPool, OffloadQueueFull)   // NOLINT
+{
+    auto pool = WorkerPool::create({.threadCount = 1, .maxQueueSize = 1});
+
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    EXPECT_TRUE(pool->post([released] {
+        released.wait();
+    }));
+    while (pool->stats().activeTasks == 0) {
+        std::this_thread::yield();
+    }
+    EXPECT_TRUE(pool->post([] {}));
+
+    std::atomic<bool> called = false;
+    Router router;
+    router.get("/heavy", offload(pool, [&called] {
+                   called = true;
+               }));
+
+    nhope::ThreadExecutor th;
+    RequestContext ctx{
+      .num = 1,
+      .router = router,
+      .aoCtx = nhope::AOContext(th),
+    };
+
+    // the rejection is an error response, not an exception
+    auto handled = router.route("GET", "/heavy").handler(ctx);
+    EXPECT_TRUE(handled.isReady());
+    EXPECT_NO_THROW(handled.get());   // NOLINT
+    EXPECT_EQ(ctx.response.status, HttpStatus::ServiceUnavailable);
+    EXPECT_FALSE(ctx.error.has_value());
+
+    release.set_value();
+    while (pool->stats().completedTasks != 2) {
+        std::this_thread::yield();
+    }
+    EXPECT_FALSE(called);
+}
+
+TEST(WorkerPool, OffloadCompletionQueue)   // NOLINT
+{
+    auto pool = WorkerPool::create({.threadCount = 2});
+
+    Router router;
+    router.get("/value", offload(pool, [] {
+                   return 42;
+               }));
+    router.get("/fail", offload(pool, [] {
+                   throw HttpError(HttpStatus::Conflict);
+               }));
+
+    // the exception handler is the continuation of the route, it runs right in the drain of the queue
+    std::atomic<bool> continuedInDrain = false;
+    router.setExceptionHandler([&continuedInDrain](RequestContext& ctx, std::exception_ptr /*e*/) {
+        continuedInDrain = ctx.completions->draining();
+        ctx.response.status = HttpStatus::Conflict;
+    });
+
+    // the queue of the IO context is shared by its sessions
+    nhope::ThreadExecutor th;
+    nhope::AOContext ioCtx(th);
+    const auto queue = royalbed::common::CompletionQueue::create(ioCtx);
+    const auto makeCtx = [&] {
+        return std::make_unique<RequestContext>(RequestContext{
+          .num = 1,
+          .router = router,
+          .completions = queue,
+          .aoCtx = nhope::AOContext(th),
+        });
+    };
+    auto first = makeCtx();
+    auto second = makeCtx();
+    auto closed = makeCtx();
+
+    // the IO thread is busy while the workers finish, their results come in one batch
+    std::promise<void> release;
+    ioCtx.exec([gate = release.get_future().share()] {
+        gate.wait();
+    });
+    auto value = router.route("GET", "/value").handler(*first);
+    auto fail = router.route("GET", "/fail").handler(*second);
+    auto dropped = router.route("GET", "/value").handler(*closed);
+    while (pool->stats().completedTasks != 3) {
+        std::this_thread::yield();
+    }
+    // the session is gone before its result is delivered, the completion must not touch its context
+    closed.reset();
+    release.set_value();
+
+    value.get();
+    const auto body = nhope::readAll(*first->response.body).get();
+    EXPECT_EQ(nlohmann::json::parse(body.begin(), body.end()).get<int>(), 42);
+
+    fail.get();
+    EXPECT_EQ(second->response.status, HttpStatus::Conflict);
+    EXPECT_TRUE(continuedInDrain);
+
+    EXPECT_EQ(queue->postedCount(), 3U);
+    EXPECT_EQ(queue->wakeupCount(), 1U);
+}
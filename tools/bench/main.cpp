@@ -0,0 +1,191 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "fmt/core.h"
+#include "spdlog/spdlog.h"
+
+#include "load/load-runner.h"
+
+/**
+ * HTTP load generator over keep-alive connections.
+ *
+ *     royalbed-bench URL [--method M] [--header "Name: value"]... [--body TEXT | --body-file FILE]
+ *                    [--requests FILE] [--var name=a,b,c | --var name=1..100]...
+ *                    [--connections K] [--threads M] [--pipeline N] [--rate RPS] [--duration SECONDS]
+ *
+ * URL is http://host[:port]/path?query. The path, the header values and the body may contain
+ * {{name}} placeholders of the --var variables and of the built-in {{conn}} and {{seq}}.
+ * --requests gives a request mix instead of a single request: a line per request
+ * "METHOD /path?query [BODY]", the empty lines and the lines starting with # are skipped.
+ * Without --rate every connection sends as fast as the server answers (closed loop).
+ */
+
+namespace {
+
+using namespace std::literals;
+using namespace royalbed;
+
+constexpr std::uint16_t defaultPort = 80;
+
+const auto usage = "usage: royalbed-bench URL [--method M] [--header \"Name: value\"]... "
+                   "[--body TEXT | --body-file FILE] [--requests FILE] [--var name=a,b,c | --var name=1..100]... "
+                   "[--connections K] [--threads M] [--pipeline N] [--rate RPS] [--duration SECONDS]";
+
+std::string readFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error(fmt::format("unable to open {}", path));
+    }
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+// Splits http://host[:port]/target, the target is kept as is since it may contain placeholders
+void parseUrl(std::string_view url, load::LoadParams& params, std::string& target)
+{
+    constexpr auto scheme = "http://"sv;
+    if (!url.starts_with(scheme)) {
+        throw std::invalid_argument(fmt::format("{} is not an http:// URL", url));
+    }
+    url.remove_prefix(scheme.size());
+
+    const auto slash = url.find('/');
+    const auto authority = url.substr(0, slash);
+    target = slash == std::string_view::npos ? "/" : std::string(url.substr(slash));
+
+    const auto colon = authority.rfind(':');
+    params.host = authority.substr(0, colon);
+    params.port = defaultPort;
+    if (colon != std::string_view::npos) {
+        params.port = static_cast<std::uint16_t>(std::stoul(std::string(authority.substr(colon + 1))));
+    }
+    if (params.host.empty()) {
+        throw std::invalid_argument(fmt::format("no host in http://{}", url));
+    }
+}
+
+std::vector<load::RequestTemplate> readRequests(const std::string& path, const common::Headers& headers)
+{
+    std::vector<load::RequestTemplate> requests;
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error(fmt::format("unable to open {}", path));
+    }
+    for (std::string line; std::getline(file, line);) {
+        if (line.empty() || line.starts_with('#')) {
+            continue;
+        }
+        const auto methodEnd = line.find(' ');
+        if (methodEnd == std::string::npos) {
+            throw std::invalid_argument(fmt::format("no target in the request \"{}\"", line));
+        }
+        const auto targetEnd = line.find(' ', methodEnd + 1);
+        requests.push_back({
+          .method = line.substr(0, methodEnd),
+          .target = line.substr(methodEnd + 1, targetEnd - methodEnd - 1),
+          .headers = headers,
+          .body = targetEnd == std::string::npos ? std::string() : line.substr(targetEnd + 1),
+        });
+    }
+    if (requests.empty()) {
+        throw std::invalid_argument(fmt::format("no requests in {}", path));
+    }
+    return requests;
+}
+
+load::LoadParams parseOptions(int argc, char** argv)
+{
+    load::LoadParams params{.threadCount = 1, .connectionCount = 1};
+
+    std::string url;
+    load::RequestTemplate request{.method = "GET"};
+    std::string requestsFile;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view name = argv[i];
+        if (!name.starts_with("--")) {
+            url = name;
+            continue;
+        }
+        if (i + 1 == argc) {
+            throw std::invalid_argument(fmt::format("no value for {}", name));
+        }
+        const std::string value = argv[++i];
+        if (name == "--method") {
+            request.method = value;
+        } else if (name == "--header") {
+            const auto colon = value.find(':');
+            if (colon == std::string::npos) {
+                throw std::invalid_argument(fmt::format("header \"{}\" is not \"Name: value\"", value));
+            }
+            const auto valueBegin = value.find_first_not_of(' ', colon + 1);
+            request.headers[value.substr(0, colon)] =
+              valueBegin == std::string::npos ? std::string() : value.substr(valueBegin);
+        } else if (name == "--body") {
+            request.body = value;
+        } else if (name == "--body-file") {
+            request.body = readFile(value);
+        } else if (name == "--requests") {
+            requestsFile = value;
+        } else if (name == "--var") {
+            params.variables.push_back(load::parseTemplateVariable(value));
+        } else if (name == "--connections") {
+            params.connectionCount = std::stoul(value);
+        } else if (name == "--threads") {
+            params.threadCount = std::stoul(value);
+        } else if (name == "--pipeline") {
+            params.pipelineDepth = std::stoul(value);
+        } else if (name == "--rate") {
+            params.rate = std::stod(value);
+        } else if (name == "--duration") {
+            params.duration = std::chrono::seconds(std::stoul(value));
+        } else {
+            throw std::invalid_argument(fmt::format("unknown option {}", name));
+        }
+    }
+    if (url.empty()) {
+        throw std::invalid_argument(usage);
+    }
+    if (params.connectionCount == 0 || params.pipelineDepth == 0) {
+        throw std::invalid_argument("--connections and --pipeline must be positive");
+    }
+
+    parseUrl(url, params, request.target);
+    if (requestsFile.empty()) {
+        params.requests.push_back(std::move(request));
+    } else {
+        params.requests = readRequests(requestsFile, request.headers);
+    }
+    return params;
+}
+
+}   // namespace
+
+int main(int argc, char** argv)
+{
+    try {
+        const auto params = parseOptions(argc, argv);
+        fmt::print("{}:{}  {} requests in the mix, {} threads, {} connections, pipeline {}, ", params.host,
+                   params.port, params.requests.size(), params.threadCount, params.connectionCount,
+                   params.pipelineDepth);
+        if (params.rate > 0) {
+            fmt::print("{:.1f} req/s", params.rate);
+        } else {
+            fmt::print("closed loop");
+        }
+        fmt::print(", {} s\n", std::chrono::duration_cast<std::chrono::seconds>(params.duration).count());
+
+        load::printReport(load::runLoad(params));
+        return EXIT_SUCCESS;
+    } catch (const std::exception& e) {
+        spdlog::error("{0}", e.what());
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "fmt/core.h"
+
+#include "nhope/async/ao-context.h"
+#include "nhope/async/future.h"
+#include "nhope/async/thread-executor.h"
+#include "nhope/async/timer.h"
+#include "nhope/io/io-device.h"
+#include "nhope/io/pushback-reader.h"
+#include "nhope/io/string-reader.h"
+#include "nhope/io/tcp.h"
+
+#include "royalbed/client/detail/receive-response.h"
+#include "royalbed/client/detail/send-request.h"
+#include "royalbed/common/coro.h"
+#include "royalbed/common/http-status.h"
+#include "royalbed/common/request.h"
+#include "royalbed/common/uri.h"
+
+#include "load/connection.h"
+
+namespace royalbed::load::detail {
+
+namespace {
+
+using namespace std::literals;
+
+constexpr auto reconnectDelay = 10ms;
+
+common::Request makeRequest(nhope::AOContext& aoCtx, const PreparedRequest& req)
+{
+    return common::Request{
+      .method = req.method,
+      .uri = req.uri,
+      .headers = req.headers,
+      .body = req.body.empty() ? nullptr : nhope::StringReader::create(aoCtx, req.body),
+    };
+}
+
+bool closedByServer(const common::Response& response)
+{
+    const auto it = response.headers.find("Connection");
+    return it != response.headers.end() && it->second == "close";
+}
+
+nhope::Future<void> sleepUntil(nhope::AOContext& aoCtx, Clock::time_point time)
+{
+    auto promise = std::make_shared<nhope::Promise<void>>();
+    auto future = promise->future();
+    const auto timeout = std::chrono::duration_cast<std::chrono::nanoseconds>(time - Clock::now());
+    nhope::setTimeout(aoCtx, std::max(timeout, 0ns), [promise](auto) {
+        promise->setValue();
+    });
+    return future;
+}
+
+nhope::Future<nhope::TcpSocketPtr> connect(nhope::AOContext& aoCtx, const Target& target)
+{
+    if (target.listener != nullptr) {
+        return nhope::makeReadyFuture<nhope::TcpSocketPtr>(target.listener->connect(aoCtx));
+    }
+    return nhope::TcpSocket::connect(aoCtx, target.host, target.port);
+}
+
+struct InFlight
+{
+    ScheduledRequest scheduled;
+    Clock::time_point sent;
+};
+
+nhope::Future<void> runConnection(nhope::AOContext& aoCtx, const Target& target, std::size_t pipelineDepth,
+                                  ConnectionPlan& plan, LoadReport& report)
+{
+    nhope::TcpSocketPtr sock;
+    nhope::PushbackReaderPtr reader;
+
+    // Taken from the plan (or returned by a closed connection) and not sent yet
+    std::deque<ScheduledRequest> queue;
+    std::deque<InFlight> inFlight;
+    std::uint64_t taken = 0;
+    bool planDone = false;
+
+    const auto takeNext = [&] {
+        if (!planDone && queue.empty()) {
+            if (auto scheduled = plan.next(taken)) {
+                ++taken;
+                queue.push_back(std::move(*scheduled));
+            } else {
+                planDone = true;
+            }
+        }
+    };
+
+    for (takeNext(); !queue.empty() || !inFlight.empty(); takeNext()) {
+        bool failed = false;
+        try {
+            if (inFlight.empty() && queue.front().time > Clock::now()) {
+                co_await sleepUntil(aoCtx, queue.front().time);
+            }
+            if (sock == nullptr) {
+                sock = co_await connect(aoCtx, target);
+                reader = nhope::PushbackReader::create(aoCtx, *sock);
+            }
+
+            while (!queue.empty() && inFlight.size() < pipelineDepth && queue.front().time <= Clock::now()) {
+                auto& sending = inFlight.emplace_back(InFlight{std::move(queue.front()), Clock::now()});
+                queue.pop_front();
+                co_await client::detail::sendRequest(aoCtx, makeRequest(aoCtx, *sending.scheduled.request), *sock);
+                if (inFlight.size() < pipelineDepth) {
+                    takeNext();
+                }
+            }
+            if (inFlight.empty()) {
+                continue;
+            }
+
+            auto response = co_await client::detail::receiveResponse(aoCtx, *reader);
+            if (response.body != nullptr) {
+                co_await nhope::readAll(*response.body);
+            }
+            const auto finish = Clock::now();
+
+            const auto done = std::move(inFlight.front());
+            inFlight.pop_front();
+            ++report.requests;
+            if (response.status >= common::HttpStatus::BadRequest) {
+                ++report.failedResponses;
+            }
+            report.serviceTime.record(finish - done.sent);
+            report.latency.record(finish - std::min(done.scheduled.time, done.sent));
+
+            if (closedByServer(response)) {
+                // the server has not read the requests pipelined after this one
+                while (!inFlight.empty()) {
+                    queue.push_front(std::move(inFlight.back().scheduled));
+                    inFlight.pop_back();
+                }
+                reader.reset();
+                sock.reset();
+            }
+        } catch (...) {
+            failed = true;
+        }
+
+        if (failed) {
+            if (inFlight.empty()) {
+                // the connection has failed, the request is dropped
+                queue.pop_front();
+                ++report.errors;
+            }
+            report.errors += inFlight.size();
+            inFlight.clear();
+            reader.reset();
+            sock.reset();
+            co_await sleepUntil(aoCtx, Clock::now() + reconnectDelay);
+        }
+    }
+
+    plan.finish(taken, report);
+}
+
+/**
+ * Client thread with its share of the connections.
+ */
+class LoadThread final
+{
+public:
+    void start(const Target& target, std::size_t pipelineDepth, std::vector<ConnectionPlanPtr> plans)
+    {
+        m_plans = std::move(plans);
+        m_running = m_plans.size();
+        if (m_running == 0) {
+            m_done.set_value();
+            return;
+        }
+
+        m_aoCtx.exec([this, &target, pipelineDepth] {
+            for (auto& plan : m_plans) {
+                runConnection(m_aoCtx, target, pipelineDepth, *plan, m_report)
+                  .then(m_aoCtx,
+                        [this] {
+                            connectionFinished();
+                        })
+                  .fail(m_aoCtx, [this](auto) {
+                      ++m_report.errors;
+                      connectionFinished();
+                  });
+            }
+        });
+    }
+
+    void wait(std::optional<Clock::time_point> deadline)
+    {
+        auto done = m_done.get_future();
+        if (!deadline.has_value() || done.wait_until(*deadline) == std::future_status::ready) {
+            done.wait();
+            return;
+        }
+
+        m_aoCtx.exec([this] {
+            if (m_running == 0) {
+                return;
+            }
+            m_report.errors += m_running;
+            m_running = 0;
+            m_done.set_value();
+            m_aoCtx.close();
+        });
+        done.wait();
+    }
+
+    // Valid after wait()
+    [[nodiscard]] const LoadReport& report() const noexcept
+    {
+        return m_report;
+    }
+
+private:
+    void connectionFinished()
+    {
+        if (m_running > 0 && --m_running == 0) {
+            m_done.set_value();
+        }
+    }
+
+    nhope::ThreadExecutor m_executor;
+    nhope::AOContext m_aoCtx{m_executor};
+
+    // Touched only in m_aoCtx
+    std::vector<ConnectionPlanPtr> m_plans;
+    LoadReport m_report;
+    std::size_t m_running{};
+
+    std::promise<void> m_done;
+};
+
+}   // namespace
+
+PreparedRequest prepareRequest(const Target& target, std::string method, std::string_view requestTarget,
+                               common::Headers headers, std::string body)
+{
+    PreparedRequest req{
+      .method = std::move(method),
+      .uri = common::Uri::parseRelative(requestTarget),
+      .headers = std::move(headers),
+      .body = std::move(body),
+    };
+    if (req.headers.find("Host") == req.headers.end()) {
+        req.headers["Host"] = target.listener != nullptr ? "memory" : fmt::format("{}:{}", target.host, target.port);
+    }
+    if (!req.body.empty() && req.headers.find("Content-Length") == req.headers.end()) {
+        req.headers["Content-Length"] = std::to_string(req.body.size());
+    }
+    return req;
+}
+
+LoadReport runConnections(const Target& target, std::size_t threadCount, std::size_t pipelineDepth,
+                          std::vector<ConnectionPlanPtr> plans, std::optional<Clock::time_point> deadline)
+{
+    pipelineDepth = std::max<std::size_t>(pipelineDepth, 1);
+    threadCount = std::clamp<std::size_t>(threadCount, 1, std::max<std::size_t>(plans.size(), 1));
+    const auto start = Clock::now();
+
+    std::vector<std::unique_ptr<LoadThread>> threads;
+    for (std::size_t t = 0; t < threadCount; ++t) {
+        std::vector<ConnectionPlanPtr> threadPlans;
+        for (auto i = t; i < plans.size(); i += threadCount) {
+            threadPlans.push_back(std::move(plans[i]));
+        }
+        threads.emplace_back(std::make_unique<LoadThread>())->start(target, pipelineDepth, std::move(threadPlans));
+    }
+
+    LoadReport report;
+    for (auto& thread : threads) {
+        thread->wait(deadline);
+    }
+    report.elapsed = Clock::now() - start;
+
+    for (const auto& thread : threads) {
+        const auto& part = thread->report();
+        report.requests += part.requests;
+        report.errors += part.errors;
+        report.failedResponses += part.failedResponses;
+        report.missed += part.missed;
+        report.latency.merge(part.latency);
+        report.serviceTime.merge(part.serviceTime);
+    }
+    return report;
+}
+
+}   // namespace royalbed::load::detail
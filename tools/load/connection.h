@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "royalbed/common/headers.h"
+#include "royalbed/common/uri.h"
+#include "royalbed/server/listener.h"
+
+#include "load/load-runner.h"
+
+namespace royalbed::load::detail {
+
+using Clock = std::chrono::steady_clock;
+
+struct Target
+{
+    std::string host;
+    std::uint16_t port{};
+
+    // In-process server, host and port are not used
+    server::MemoryListenerPtr listener;
+};
+
+struct PreparedRequest
+{
+    std::string method;
+    common::Uri uri;
+    common::Headers headers;
+    std::string body;
+};
+
+// Parses the target and adds Host and Content-Length if they are missing
+PreparedRequest prepareRequest(const Target& target, std::string method, std::string_view requestTarget,
+                               common::Headers headers, std::string body);
+
+using PreparedRequestPtr = std::shared_ptr<const PreparedRequest>;
+
+struct ScheduledRequest
+{
+    PreparedRequestPtr request;
+    Clock::time_point time;
+};
+
+/**
+ * What a connection sends and when. Called only in the thread of the connection.
+ */
+class ConnectionPlan
+{
+public:
+    virtual ~ConnectionPlan() = default;
+
+    // The n-th request of the connection, std::nullopt when the connection is done.
+    // With pipelining it is called before the responses to the previous requests are received
+    virtual std::optional<ScheduledRequest> next(std::uint64_t n) = 0;
+
+    // Called once after the last request with the number of the requests taken from the plan
+    virtual void finish(std::uint64_t /*taken*/, LoadReport& /*report*/)
+    {}
+};
+
+using ConnectionPlanPtr = std::unique_ptr<ConnectionPlan>;
+
+/**
+ * Runs one keep-alive connection per plan, the connections are distributed between threadCount threads.
+ * Up to pipelineDepth requests are sent on a connection without waiting for the responses. The requests
+ * sent after a response with "Connection: close" are sent again on a new connection.
+ * The requests in flight at the deadline are dropped and counted as errors.
+ */
+LoadReport runConnections(const Target& target, std::size_t threadCount, std::size_t pipelineDepth,
+                          std::vector<ConnectionPlanPtr> plans, std::optional<Clock::time_point> deadline);
+
+}   // namespace royalbed::load::detail
@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "load/latency-histogram.h"
+
+namespace royalbed::load {
+
+namespace {
+
+constexpr std::uint64_t halfCount = LatencyHistogram::subBucketCount / 2;
+constexpr int subBucketBits = std::bit_width(LatencyHistogram::subBucketCount - 1);
+
+}   // namespace
+
+LatencyHistogram::LatencyHistogram()
+  : m_counts(bucketIndex(maxValue) + 1)
+{}
+
+void LatencyHistogram::record(std::chrono::nanoseconds value)
+{
+    const auto ns = std::min(static_cast<std::uint64_t>(std::max(value.count(), std::int64_t{0})), maxValue);
+    ++m_counts[bucketIndex(ns)];
+    ++m_count;
+    m_min = std::min(m_min, ns);
+    m_max = std::max(m_max, ns);
+    m_sum += static_cast<long double>(ns);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+    for (std::size_t i = 0; i < m_counts.size(); ++i) {
+        m_counts[i] += other.m_counts[i];
+    }
+    m_count += other.m_count;
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+    m_sum += other.m_sum;
+}
+
+std::uint64_t LatencyHistogram::count() const noexcept
+{
+    return m_count;
+}
+
+std::chrono::nanoseconds LatencyHistogram::min() const noexcept
+{
+    return std::chrono::nanoseconds(m_count == 0 ? 0 : m_min);
+}
+
+std::chrono::nanoseconds LatencyHistogram::max() const noexcept
+{
+    return std::chrono::nanoseconds(m_max);
+}
+
+std::chrono::nanoseconds LatencyHistogram::mean() const noexcept
+{
+    if (m_count == 0) {
+        return {};
+    }
+    return std::chrono::nanoseconds(std::llround(m_sum / static_cast<long double>(m_count)));
+}
+
+std::chrono::nanoseconds LatencyHistogram::percentile(double percent) const noexcept
+{
+    if (m_count == 0) {
+        return {};
+    }
+
+    const auto rank = std::max<std::uint64_t>(
+      1, static_cast<std::uint64_t>(std::ceil(std::clamp(percent, 0.0, 100.0) / 100.0 * static_cast<double>(m_count))));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < m_counts.size(); ++i) {
+        seen += m_counts[i];
+        if (seen >= rank) {
+            // the bucket bound can not be outside of the recorded range
+            return std::chrono::nanoseconds(std::clamp(bucketValue(i), m_min, m_max));
+        }
+    }
+    return std::chrono::nanoseconds(m_max);
+}
+
+std::size_t LatencyHistogram::bucketIndex(std::uint64_t value) noexcept
+{
+    if (value < subBucketCount) {
+        return static_cast<std::size_t>(value);
+    }
+    // the value is in [halfCount, subBucketCount) << shift
+    const auto shift = std::bit_width(value) - subBucketBits;
+    return static_cast<std::size_t>(subBucketCount + (shift - 1) * halfCount + ((value >> shift) - halfCount));
+}
+
+std::uint64_t LatencyHistogram::bucketValue(std::size_t index) noexcept
+{
+    if (index < subBucketCount) {
+        return index;
+    }
+    const auto shift = (index - subBucketCount) / halfCount + 1;
+    const auto sub = (index - subBucketCount) % halfCount + halfCount;
+    // the upper bound of the bucket
+    return ((sub + 1) << shift) - 1;
+}
+
+}   // namespace royalbed::load
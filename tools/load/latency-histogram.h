@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace royalbed::load {
+
+/**
+ * Log-linear latency histogram with a fixed relative error: 2 / subBucketCount, i.e. below 0.8%.
+ * Values below subBucketCount nanoseconds are exact, every next power of two is split into
+ * subBucketCount / 2 equal buckets. Values over maxValue are counted as maxValue.
+ * Not thread-safe: every thread records into its own histogram, the results are merged.
+ */
+class LatencyHistogram final
+{
+public:
+    LatencyHistogram();
+
+    void record(std::chrono::nanoseconds value);
+    void merge(const LatencyHistogram& other);
+
+    [[nodiscard]] std::uint64_t count() const noexcept;
+    [[nodiscard]] std::chrono::nanoseconds min() const noexcept;
+    [[nodiscard]] std::chrono::nanoseconds max() const noexcept;
+    [[nodiscard]] std::chrono::nanoseconds mean() const noexcept;
+
+    // Value not exceeded by the given percent of the records, percent is in [0, 100]
+    [[nodiscard]] std::chrono::nanoseconds percentile(double percent) const noexcept;
+
+    static constexpr std::uint64_t subBucketCount{256};
+    static constexpr std::uint64_t maxValue{std::uint64_t{1} << 40};   // ~18 minutes
+
+    // The bucket of the value and the upper bound of the bucket, percentiles report it
+    [[nodiscard]] static std::size_t bucketIndex(std::uint64_t value) noexcept;
+    [[nodiscard]] static std::uint64_t bucketValue(std::size_t index) noexcept;
+
+private:
+
+    std::vector<std::uint64_t> m_counts;
+    std::uint64_t m_count{};
+    std::uint64_t m_min{UINT64_MAX};
+    std::uint64_t m_max{};
+    long double m_sum{};
+};
+
+}   // namespace royalbed::load
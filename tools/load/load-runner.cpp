@@ -0,0 +1,186 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "fmt/core.h"
+
+#include "load/connection.h"
+#include "load/load-runner.h"
+#include "load/request-template.h"
+
+namespace royalbed::load {
+
+namespace {
+
+using namespace std::literals;
+using detail::Clock;
+using detail::CompiledTemplate;
+using detail::ConnectionPlan;
+using detail::PreparedRequestPtr;
+using detail::ScheduledRequest;
+using detail::TemplateState;
+
+// Time given to the requests in flight after the end of the run
+constexpr auto drainTimeout = 10s;
+
+// Every connection goes through the mix from its own offset
+class MixCursor
+{
+public:
+    MixCursor(const std::vector<CompiledTemplate>& requests, std::size_t connection)
+      : m_requests(requests)
+      , m_next(connection)
+      , m_state{.connection = connection, .seq = 0, .random = std::minstd_rand(connection + 1)}
+    {}
+
+    PreparedRequestPtr next()
+    {
+        auto request = m_requests[m_next++ % m_requests.size()].make(m_state);
+        ++m_state.seq;
+        return request;
+    }
+
+private:
+    const std::vector<CompiledTemplate>& m_requests;
+    std::size_t m_next;
+    TemplateState m_state;
+};
+
+// The next request is sent as soon as the response to the previous one is received
+class ClosedLoopPlan final : public ConnectionPlan
+{
+public:
+    ClosedLoopPlan(const std::vector<CompiledTemplate>& requests, std::size_t index, Clock::time_point end)
+      : m_cursor(requests, index)
+      , m_end(end)
+    {}
+
+    std::optional<ScheduledRequest> next(std::uint64_t /*n*/) override
+    {
+        const auto now = Clock::now();
+        if (now >= m_end) {
+            return std::nullopt;
+        }
+        return ScheduledRequest{m_cursor.next(), now};
+    }
+
+private:
+    MixCursor m_cursor;
+    const Clock::time_point m_end;
+};
+
+// The requests are sent at start + offset + n * interval, whatever the responses are
+class OpenLoopPlan final : public ConnectionPlan
+{
+public:
+    OpenLoopPlan(const std::vector<CompiledTemplate>& requests, std::size_t index, Clock::time_point start,
+                 Clock::time_point end, Clock::duration interval, Clock::duration offset)
+      : m_cursor(requests, index)
+      , m_first(start + offset)
+      , m_end(end)
+      , m_interval(interval)
+    {}
+
+    std::optional<ScheduledRequest> next(std::uint64_t n) override
+    {
+        const auto time = m_first + static_cast<Clock::rep>(n) * m_interval;
+        if (time >= m_end || Clock::now() >= m_end) {
+            return std::nullopt;
+        }
+        return ScheduledRequest{m_cursor.next(), time};
+    }
+
+    // The requests never sent are answered at the end of the run at the earliest: they are recorded with that
+    // latency, otherwise a stalled server would drop out of the percentiles exactly when they matter
+    void finish(std::uint64_t taken, LoadReport& report) override
+    {
+        const auto window = m_end - m_first;
+        const auto slots = static_cast<std::uint64_t>((window + m_interval - Clock::duration(1)) / m_interval);
+        for (auto n = taken; n < slots; ++n) {
+            report.latency.record(m_end - (m_first + static_cast<Clock::rep>(n) * m_interval));
+            ++report.missed;
+        }
+    }
+
+private:
+    MixCursor m_cursor;
+    const Clock::time_point m_first;
+    const Clock::time_point m_end;
+    const Clock::duration m_interval;
+};
+
+}   // namespace
+
+double LoadReport::throughput() const noexcept
+{
+    const auto seconds = std::chrono::duration<double>(elapsed).count();
+    return seconds > 0 ? static_cast<double>(requests) / seconds : 0;
+}
+
+LoadReport runLoad(const LoadParams& params)
+{
+    if (params.requests.empty()) {
+        throw std::invalid_argument("request mix is empty");
+    }
+
+    const detail::Target target{.host = params.host, .port = params.port, .listener = params.listener};
+    std::vector<CompiledTemplate> requests;
+    requests.reserve(params.requests.size());
+    for (const auto& tmpl : params.requests) {
+        requests.emplace_back(target, tmpl, params.variables);
+    }
+
+    const auto start = Clock::now();
+    const auto end = start + std::chrono::duration_cast<Clock::duration>(params.duration);
+    Clock::duration interval{};
+    if (params.rate > 0) {
+        const auto perConnection = params.rate / static_cast<double>(params.connectionCount);
+        interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1 / perConnection));
+    }
+
+    std::vector<detail::ConnectionPlanPtr> plans;
+    for (std::size_t i = 0; i < params.connectionCount; ++i) {
+        if (interval > Clock::duration::zero()) {
+            // the connections are shifted within the interval, so the requests are spread evenly
+            const auto offset =
+              interval * static_cast<Clock::rep>(i) / static_cast<Clock::rep>(params.connectionCount);
+            plans.push_back(std::make_unique<OpenLoopPlan>(requests, i, start, end, interval, offset));
+        } else {
+            plans.push_back(std::make_unique<ClosedLoopPlan>(requests, i, end));
+        }
+    }
+
+    return detail::runConnections(target, params.threadCount, params.pipelineDepth, std::move(plans),
+                                  end + drainTimeout);
+}
+
+void printReport(const LoadReport& report)
+{
+    const auto us = [](std::chrono::nanoseconds value) {
+        return std::chrono::duration<double, std::micro>(value).count();
+    };
+    const auto printHistogram = [&us](std::string_view title, const LatencyHistogram& histogram) {
+        fmt::print("{} (us):\n", title);
+        fmt::print("  min {:.1f}  mean {:.1f}  max {:.1f}\n", us(histogram.min()), us(histogram.mean()),
+                   us(histogram.max()));
+        for (const double percent : {50.0, 75.0, 90.0, 99.0, 99.9, 99.99}) {
+            fmt::print("  p{:<6} {:>12.1f}\n", percent, us(histogram.percentile(percent)));
+        }
+    };
+
+    fmt::print("requests: {}  errors: {}  4xx/5xx: {}  missed: {}\n", report.requests, report.errors,
+               report.failedResponses, report.missed);
+    fmt::print("elapsed: {:.2f} s  throughput: {:.1f} req/s\n", std::chrono::duration<double>(report.elapsed).count(),
+               report.throughput());
+    printHistogram("latency from the scheduled time", report.latency);
+    printHistogram("service time", report.serviceTime);
+}
+
+}   // namespace royalbed::load
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "royalbed/common/headers.h"
+#include "royalbed/server/listener.h"
+
+#include "load/latency-histogram.h"
+
+namespace royalbed::load {
+
+/**
+ * The target, the header values and the body may contain {{name}} placeholders, they are replaced
+ * for every request by the values of the variables. Built-in variables: {{conn}} - index of the connection,
+ * {{seq}} - number of the request in the connection.
+ */
+struct RequestTemplate
+{
+    std::string method;
+
+    // Path with the query, e.g. "/api/vru/vru_{{id}}?verbose=true"
+    std::string target;
+
+    common::Headers headers;
+    std::string body;
+};
+
+/**
+ * Value of a {{name}} placeholder, picked at random for every request:
+ * one of the values or, if there are none, an integer from [min, max].
+ * A variable used several times in a request has the same value in all the places.
+ */
+struct TemplateVariable
+{
+    std::string name;
+    std::vector<std::string> values{};
+    std::int64_t min{};
+    std::int64_t max{};
+};
+
+// "name=a,b,c" or "name=1..100"
+TemplateVariable parseTemplateVariable(std::string_view spec);
+
+struct LoadParams
+{
+    std::string host;
+    std::uint16_t port;
+
+    // In-process server: the connections are opened through the listener, host and port are not used
+    server::MemoryListenerPtr listener;
+
+    // Client threads, the connections are distributed between them evenly
+    std::size_t threadCount{1};
+
+    // Keep-alive connections. A connection closed by the server is reopened
+    std::size_t connectionCount{1};
+
+    std::chrono::nanoseconds duration{std::chrono::seconds(10)};
+
+    // Requests per second over all the connections.
+    // 0 - closed loop: every connection sends the next request as soon as it gets the response
+    double rate{};
+
+    // Requests sent on a connection before waiting for the first response (HTTP pipelining).
+    // While a connection waits for the oldest response it does not send, so in the open loop
+    // a deep pipeline delays the requests that become due meanwhile (the latency shows it)
+    std::size_t pipelineDepth{1};
+
+    // Request mix, every connection goes through it in turn starting from its own offset
+    std::vector<RequestTemplate> requests;
+
+    // Variables of the placeholders in the requests
+    std::vector<TemplateVariable> variables;
+};
+
+struct LoadReport
+{
+    std::uint64_t requests{};
+    std::uint64_t errors{};
+
+    // Responses with status >= 400
+    std::uint64_t failedResponses{};
+
+    // Open loop only: requests scheduled within the run but not sent before its end.
+    // They are in latency with the time from the schedule to the end of the run
+    std::uint64_t missed{};
+
+    std::chrono::nanoseconds elapsed{};
+
+    // From the moment the request was scheduled to the response. In the open loop it includes
+    // the time the request waited for its connection, so stalls are not hidden (coordinated omission).
+    // In the closed loop it is the same as serviceTime
+    LatencyHistogram latency;
+
+    // From the moment the request was sent to the response
+    LatencyHistogram serviceTime;
+
+    [[nodiscard]] double throughput() const noexcept;
+};
+
+/**
+ * Runs the load and blocks until it is over.
+ */
+LoadReport runLoad(const LoadParams& params);
+
+void printReport(const LoadReport& report);
+
+}   // namespace royalbed::load
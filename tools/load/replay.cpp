@@ -0,0 +1,129 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "royalbed/common/traffic-log.h"
+
+#include "load/connection.h"
+#include "load/replay.h"
+
+namespace royalbed::load {
+
+namespace {
+
+using namespace std::literals;
+using detail::Clock;
+using detail::PreparedRequest;
+using detail::ScheduledRequest;
+
+// Time given to the requests in flight after the last scheduled one
+constexpr auto drainTimeout = 10s;
+
+struct ReplayRequest
+{
+    detail::PreparedRequestPtr request;
+    Clock::duration time;
+};
+
+// Connection index takes the requests index, index + connectionCount, ...
+class ReplayPlan final : public detail::ConnectionPlan
+{
+public:
+    ReplayPlan(const std::vector<ReplayRequest>& requests, std::size_t index, std::size_t connectionCount,
+               Clock::time_point start, bool scheduled)
+      : m_requests(requests)
+      , m_index(index)
+      , m_connectionCount(connectionCount)
+      , m_start(start)
+      , m_scheduled(scheduled)
+    {}
+
+    std::optional<ScheduledRequest> next(std::uint64_t n) override
+    {
+        const auto i = m_index + n * m_connectionCount;
+        if (i >= m_requests.size()) {
+            return std::nullopt;
+        }
+        const auto& req = m_requests[i];
+        return ScheduledRequest{req.request, m_scheduled ? m_start + req.time : Clock::now()};
+    }
+
+private:
+    const std::vector<ReplayRequest>& m_requests;
+    const std::size_t m_index;
+    const std::size_t m_connectionCount;
+    const Clock::time_point m_start;
+    const bool m_scheduled;
+};
+
+common::Headers replayHeaders(const common::CapturedRequest& captured)
+{
+    auto headers = captured.headers;
+    // the replay keeps its own connections alive
+    headers.erase("Connection");
+    headers.erase("Keep-Alive");
+    // the captured body is decoded, prepareRequest() sends it with its own length
+    headers.erase("Content-Length");
+    headers.erase("Transfer-Encoding");
+    return headers;
+}
+
+}   // namespace
+
+std::vector<common::CapturedRequest> readTrafficLog(const std::filesystem::path& path)
+{
+    common::TrafficLogReader reader(path);
+    std::vector<common::CapturedRequest> requests;
+    while (auto request = reader.next()) {
+        requests.push_back(std::move(*request));
+    }
+    return requests;
+}
+
+LoadReport replayTraffic(const ReplayParams& params, const std::vector<common::CapturedRequest>& requests)
+{
+    if (params.speed < 0) {
+        throw std::invalid_argument("replay speed must not be negative");
+    }
+
+    const detail::Target target{.host = params.host, .port = params.port, .listener = params.listener};
+    const bool scheduled = params.speed > 0;
+
+    std::vector<ReplayRequest> replayRequests;
+    replayRequests.reserve(requests.size());
+    Clock::duration last{};
+    for (const auto& captured : requests) {
+        auto time = Clock::duration{};
+        if (scheduled) {
+            time = std::chrono::duration_cast<Clock::duration>(
+              std::chrono::duration<double, std::nano>(static_cast<double>(captured.time.count()) / params.speed));
+        }
+        last = std::max(last, time);
+        replayRequests.push_back({
+          .request = std::make_shared<const PreparedRequest>(detail::prepareRequest(
+            target, captured.method, captured.target, replayHeaders(captured), captured.body)),
+          .time = time,
+        });
+    }
+
+    const auto connectionCount = std::max<std::size_t>(params.connectionCount, 1);
+    const auto start = Clock::now();
+    std::vector<detail::ConnectionPlanPtr> plans;
+    for (std::size_t i = 0; i < connectionCount; ++i) {
+        plans.push_back(std::make_unique<ReplayPlan>(replayRequests, i, connectionCount, start, scheduled));
+    }
+
+    std::optional<Clock::time_point> deadline;
+    if (scheduled) {
+        deadline = start + last + drainTimeout;
+    }
+    return detail::runConnections(target, params.threadCount, 1, std::move(plans), deadline);
+}
+
+}   // namespace royalbed::load
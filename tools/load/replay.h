@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "royalbed/common/traffic-log.h"
+#include "royalbed/server/listener.h"
+
+#include "load/load-runner.h"
+
+namespace royalbed::load {
+
+struct ReplayParams
+{
+    std::string host;
+    std::uint16_t port{};
+
+    // In-process server: the connections are opened through the listener, host and port are not used
+    server::MemoryListenerPtr listener;
+
+    std::size_t threadCount{1};
+
+    // The requests are given to the connections in turn
+    std::size_t connectionCount{1};
+
+    // 1 - the captured rate, 2 - twice as fast, 0 - as fast as possible (closed loop)
+    double speed{1};
+};
+
+std::vector<common::CapturedRequest> readTrafficLog(const std::filesystem::path& path);
+
+/**
+ * Sends the captured requests at their captured times scaled by the speed. The latency is measured
+ * from the scheduled time, like in the open loop of runLoad().
+ */
+LoadReport replayTraffic(const ReplayParams& params, const std::vector<common::CapturedRequest>& requests);
+
+}   // namespace royalbed::load
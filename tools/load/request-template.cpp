@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "fmt/core.h"
+
+#include "load/request-template.h"
+
+namespace royalbed::load {
+
+namespace detail {
+
+namespace {
+
+using namespace std::literals;
+
+constexpr auto placeholderBegin = "{{"sv;
+constexpr auto placeholderEnd = "}}"sv;
+constexpr auto rangeSeparator = ".."sv;
+
+bool parseInteger(std::string_view str, std::int64_t& value)
+{
+    const auto* end = str.data() + str.size();
+    const auto [ptr, ec] = std::from_chars(str.data(), end, value);
+    return !str.empty() && ec == std::errc() && ptr == end;
+}
+
+}   // namespace
+
+CompiledTemplate::CompiledTemplate(const Target& target, const RequestTemplate& tmpl,
+                                   const std::vector<TemplateVariable>& variables)
+  : m_server(target)
+  , m_variables(variables)
+  , m_method(tmpl.method)
+{
+    // the built-in variables go after the given ones
+    m_variables.push_back({.name = "conn"});
+    m_variables.push_back({.name = "seq"});
+
+    m_requestTarget = compile(tmpl.target);
+    for (const auto& [name, value] : tmpl.headers) {
+        m_headers.emplace_back(name, compile(value));
+    }
+    m_body = compile(tmpl.body);
+
+    if (m_used.empty()) {
+        m_prepared = std::make_shared<const PreparedRequest>(
+          prepareRequest(m_server, m_method, tmpl.target, tmpl.headers, tmpl.body));
+    }
+}
+
+PreparedRequestPtr CompiledTemplate::make(TemplateState& state) const
+{
+    if (m_prepared != nullptr) {
+        return m_prepared;
+    }
+
+    std::vector<std::string> values(m_variables.size());
+    for (const auto variable : m_used) {
+        values[variable] = value(variable, state);
+    }
+
+    common::Headers headers;
+    for (const auto& [name, text] : m_headers) {
+        headers[name] = render(text, values);
+    }
+    return std::make_shared<const PreparedRequest>(prepareRequest(
+      m_server, m_method, render(m_requestTarget, values), std::move(headers), render(m_body, values)));
+}
+
+CompiledTemplate::Text CompiledTemplate::compile(const std::string& text)
+{
+    Text parts;
+    std::string_view rest = text;
+    while (!rest.empty()) {
+        const auto begin = rest.find(placeholderBegin);
+        if (begin != 0) {
+            parts.push_back({.literal = std::string(rest.substr(0, begin))});
+            if (begin == std::string_view::npos) {
+                break;
+            }
+            rest.remove_prefix(begin);
+        }
+
+        const auto end = rest.find(placeholderEnd, placeholderBegin.size());
+        if (end == std::string_view::npos) {
+            throw std::invalid_argument(fmt::format("unclosed placeholder in \"{}\"", text));
+        }
+        const auto name = rest.substr(placeholderBegin.size(), end - placeholderBegin.size());
+        const auto it = std::find_if(m_variables.begin(), m_variables.end(), [name](const auto& variable) {
+            return variable.name == name;
+        });
+        if (it == m_variables.end()) {
+            throw std::invalid_argument(fmt::format("unknown template variable \"{}\"", name));
+        }
+
+        const auto variable = static_cast<std::size_t>(it - m_variables.begin());
+        parts.push_back({.literal = {}, .variable = variable});
+        if (std::find(m_used.begin(), m_used.end(), variable) == m_used.end()) {
+            m_used.push_back(variable);
+        }
+        rest.remove_prefix(end + placeholderEnd.size());
+    }
+    return parts;
+}
+
+std::string CompiledTemplate::render(const Text& text, const std::vector<std::string>& values) const
+{
+    std::string out;
+    for (const auto& part : text) {
+        out += part.variable == noVariable ? part.literal : values[part.variable];
+    }
+    return out;
+}
+
+std::string CompiledTemplate::value(std::size_t variable, TemplateState& state) const
+{
+    const auto builtin = m_variables.size() - 2;
+    if (variable == builtin) {
+        return std::to_string(state.connection);
+    }
+    if (variable == builtin + 1) {
+        return std::to_string(state.seq);
+    }
+
+    const auto& var = m_variables[variable];
+    if (!var.values.empty()) {
+        std::uniform_int_distribution<std::size_t> index(0, var.values.size() - 1);
+        return var.values[index(state.random)];
+    }
+    std::uniform_int_distribution<std::int64_t> number(var.min, var.max);
+    return std::to_string(number(state.random));
+}
+
+}   // namespace detail
+
+TemplateVariable parseTemplateVariable(std::string_view spec)
+{
+    const auto eq = spec.find('=');
+    if (eq == 0 || eq == std::string_view::npos) {
+        throw std::invalid_argument(fmt::format("template variable \"{}\" is not name=values", spec));
+    }
+
+    TemplateVariable variable{.name = std::string(spec.substr(0, eq))};
+    const auto values = spec.substr(eq + 1);
+
+    if (const auto sep = values.find(detail::rangeSeparator); sep != std::string_view::npos) {
+        if (detail::parseInteger(values.substr(0, sep), variable.min) &&
+            detail::parseInteger(values.substr(sep + detail::rangeSeparator.size()), variable.max)) {
+            if (variable.min > variable.max) {
+                throw std::invalid_argument(fmt::format("empty range of template variable \"{}\"", variable.name));
+            }
+            return variable;
+        }
+    }
+
+    std::size_t pos = 0;
+    for (auto comma = values.find(','); comma != std::string_view::npos; comma = values.find(',', pos)) {
+        variable.values.emplace_back(values.substr(pos, comma - pos));
+        pos = comma + 1;
+    }
+    variable.values.emplace_back(values.substr(pos));
+    return variable;
+}
+
+}   // namespace royalbed::load
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "load/connection.h"
+#include "load/load-runner.h"
+
+namespace royalbed::load::detail {
+
+// Per-connection state of the placeholders
+struct TemplateState
+{
+    std::size_t connection{};
+    std::uint64_t seq{};
+    std::minstd_rand random;
+};
+
+/**
+ * RequestTemplate with the placeholders resolved to the variables.
+ * A template without placeholders is prepared once and shared by all the requests.
+ */
+class CompiledTemplate final
+{
+public:
+    // Throws std::invalid_argument on an unknown variable or an unclosed placeholder
+    CompiledTemplate(const Target& target, const RequestTemplate& tmpl, const std::vector<TemplateVariable>& variables);
+
+    [[nodiscard]] PreparedRequestPtr make(TemplateState& state) const;
+
+private:
+    static constexpr auto noVariable = std::numeric_limits<std::size_t>::max();
+
+    struct Part
+    {
+        std::string literal;
+
+        // Index of the variable the part is replaced with, noVariable for a literal
+        std::size_t variable{noVariable};
+    };
+    using Text = std::vector<Part>;
+
+    Text compile(const std::string& text);
+    [[nodiscard]] std::string render(const Text& text, const std::vector<std::string>& values) const;
+    [[nodiscard]] std::string value(std::size_t variable, TemplateState& state) const;
+
+    Target m_server;
+    std::vector<TemplateVariable> m_variables;
+
+    std::string m_method;
+    Text m_requestTarget;
+    std::vector<std::pair<std::string, Text>> m_headers;
+    Text m_body;
+
+    // Variables found in the template
+    std::vector<std::size_t> m_used;
+
+    PreparedRequestPtr m_prepared;
+};
+
+}   // namespace royalbed::load::detail
@@ -0,0 +1,82 @@
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "fmt/core.h"
+#include "spdlog/spdlog.h"
+
+#include "load/load-runner.h"
+#include "load/replay.h"
+
+/**
+ * Replays a traffic log recorded by server::captureTraffic against a server over TCP.
+ *
+ *     royalbed-replay LOG [--host HOST] [--port PORT] [--speed X] [--connections K] [--threads M]
+ *
+ * --speed scales the captured rate: 2 replays twice as fast, 0 sends as fast as possible.
+ */
+
+namespace {
+
+using namespace royalbed;
+
+constexpr std::uint16_t defaultPort = 8080;
+
+struct Options
+{
+    std::string log;
+    load::ReplayParams params{.host = "127.0.0.1", .port = defaultPort};
+};
+
+Options parseOptions(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view name = argv[i];
+        if (!name.starts_with("--")) {
+            options.log = name;
+            continue;
+        }
+        if (i + 1 == argc) {
+            throw std::invalid_argument(fmt::format("no value for {}", name));
+        }
+        const std::string value = argv[++i];
+        if (name == "--host") {
+            options.params.host = value;
+        } else if (name == "--port") {
+            options.params.port = static_cast<std::uint16_t>(std::stoul(value));
+        } else if (name == "--speed") {
+            options.params.speed = std::stod(value);
+        } else if (name == "--connections") {
+            options.params.connectionCount = std::stoul(value);
+        } else if (name == "--threads") {
+            options.params.threadCount = std::stoul(value);
+        } else {
+            throw std::invalid_argument(fmt::format("unknown option {}", name));
+        }
+    }
+    if (options.log.empty()) {
+        throw std::invalid_argument("usage: royalbed-replay LOG [--host HOST] [--port PORT] [--speed X] "
+                                    "[--connections K] [--threads M]");
+    }
+    return options;
+}
+
+}   // namespace
+
+int main(int argc, char** argv)
+{
+    try {
+        const auto options = parseOptions(argc, argv);
+        const auto requests = load::readTrafficLog(options.log);
+        fmt::print("replaying {} requests to {}:{} at x{}\n", requests.size(), options.params.host,
+                   options.params.port, options.params.speed);
+        load::printReport(load::replayTraffic(options.params, requests));
+        return EXIT_SUCCESS;
+    } catch (const std::exception& e) {
+        spdlog::error("{0}", e.what());
+        return EXIT_FAILURE;
+    }
+}